@@ -20,6 +20,7 @@
 #include <util/check.h>
 
 #include <cmath>
+#include <limits>
 #include <optional>
 
 /** Over how many buckets entries with tried addresses from a single group (/16 for IPv4) are spread */
@@ -43,14 +44,14 @@ static constexpr size_t ADDRMAN_SET_TRIED_COLLISION_SIZE{10};
 /** The maximum time we'll spend trying to resolve a tried table collision, in seconds */
 static constexpr int64_t ADDRMAN_TEST_WINDOW{40*60}; // 40 minutes
 
-int AddrInfo::GetTriedBucket(const uint256& nKey, const std::vector<bool>& asmap) const
+int AddrInfo::GetTriedBucket(const uint256& nKey, const CompiledASMap& asmap) const
 {
     uint64_t hash1 = (CHashWriter(SER_GETHASH, 0) << nKey << GetKey()).GetCheapHash();
     uint64_t hash2 = (CHashWriter(SER_GETHASH, 0) << nKey << GetGroup(asmap) << (hash1 % ADDRMAN_TRIED_BUCKETS_PER_GROUP)).GetCheapHash();
     return hash2 % ADDRMAN_TRIED_BUCKET_COUNT;
 }
 
-int AddrInfo::GetNewBucket(const uint256& nKey, const CNetAddr& src, const std::vector<bool>& asmap) const
+int AddrInfo::GetNewBucket(const uint256& nKey, const CNetAddr& src, const CompiledASMap& asmap) const
 {
     std::vector<unsigned char> vchSourceGroupKey = src.GetGroup(asmap);
     uint64_t hash1 = (CHashWriter(SER_GETHASH, 0) << nKey << GetGroup(asmap) << vchSourceGroupKey).GetCheapHash();
@@ -103,7 +104,8 @@ AddrManImpl::AddrManImpl(std::vector<bool>&& asmap, bool deterministic, int32_t
     : insecure_rand{deterministic}
     , nKey{deterministic ? uint256{1} : insecure_rand.rand256()}
     , m_consistency_check_ratio{consistency_check_ratio}
-    , m_asmap{std::move(asmap)}
+    , m_asmap{asmap}
+    , m_asmap_checksum{asmap.empty() ? uint256{} : SerializeHash(asmap)}
 {
     for (auto& bucket : vvNew) {
         for (auto& entry : bucket) {
@@ -150,13 +152,18 @@ void AddrManImpl::Serialize(Stream& s_) const
      *   * number of elements
      *   * for each element: index in the serialized "all new addresses"
      * * asmap checksum
+     * * (since V5) number of "tried" buckets and bucket size
+     * * (since V5) for each tried address: its bucket and position in the bucket
+     * * (since V5) for each element of the new buckets: its position in the bucket
      *
      * 2**30 is xorred with the number of buckets to make addrman deserializer v0 detect it
      * as incompatible. This is necessary because it did not check the version number on
      * deserialization.
      *
      * vvNew, vvTried, mapInfo, mapAddr and vRandom are never encoded explicitly;
-     * they are instead reconstructed from the other information.
+     * they are instead reconstructed from the other information. Bucket positions
+     * are stored so that, when nothing affecting bucketing changed, they do not
+     * have to be recomputed (which hashes every entry several times) on load.
      *
      * This format is more complex, but significantly smaller (at most 1.5 MiB), and supports
      * changes to the ADDRMAN_ parameters without breaking the on-disk structure.
@@ -173,7 +180,7 @@ void AddrManImpl::Serialize(Stream& s_) const
 
     // Increment `lowest_compatible` iff a newly introduced format is incompatible with
     // the previous one.
-    static constexpr uint8_t lowest_compatible = Format::V4_MULTIPORT;
+    static constexpr uint8_t lowest_compatible = Format::V5_BUCKET_POSITIONS;
     s << static_cast<uint8_t>(INCOMPATIBILITY_BASE + lowest_compatible);
 
     s << nKey;
@@ -193,15 +200,20 @@ void AddrManImpl::Serialize(Stream& s_) const
             nIds++;
         }
     }
-    nIds = 0;
-    for (const auto& entry : mapInfo) {
-        const AddrInfo& info = entry.second;
-        if (info.fInTried) {
-            assert(nIds != nTried); // this means nTried was wrong, oh ow
-            s << info;
-            nIds++;
+    // Write the tried addresses in table order, so that their positions can be
+    // written without recomputing them.
+    std::vector<std::pair<uint16_t, uint8_t>> tried_positions;
+    tried_positions.reserve(nTried);
+    for (int bucket = 0; bucket < ADDRMAN_TRIED_BUCKET_COUNT; bucket++) {
+        for (int i = 0; i < ADDRMAN_BUCKET_SIZE; i++) {
+            if (vvTried[bucket][i] != -1) {
+                assert(tried_positions.size() != size_t(nTried)); // this means nTried was wrong, oh ow
+                s << mapInfo.at(vvTried[bucket][i]);
+                tried_positions.emplace_back(bucket, i);
+            }
         }
     }
+    std::vector<uint8_t> new_positions;
     for (int bucket = 0; bucket < ADDRMAN_NEW_BUCKET_COUNT; bucket++) {
         int nSize = 0;
         for (int i = 0; i < ADDRMAN_BUCKET_SIZE; i++) {
@@ -213,16 +225,23 @@ void AddrManImpl::Serialize(Stream& s_) const
             if (vvNew[bucket][i] != -1) {
                 int nIndex = mapUnkIds[vvNew[bucket][i]];
                 s << nIndex;
+                new_positions.push_back(i);
             }
         }
     }
     // Store asmap checksum after bucket entries so that it
     // can be ignored by older clients for backward compatibility.
-    uint256 asmap_checksum;
-    if (m_asmap.size() != 0) {
-        asmap_checksum = SerializeHash(m_asmap);
+    s << m_asmap_checksum;
+
+    static_assert(ADDRMAN_TRIED_BUCKET_COUNT <= std::numeric_limits<uint16_t>::max() + 1);
+    static_assert(ADDRMAN_BUCKET_SIZE <= std::numeric_limits<uint8_t>::max() + 1);
+    s << int{ADDRMAN_TRIED_BUCKET_COUNT} << int{ADDRMAN_BUCKET_SIZE};
+    for (const auto& [bucket, position] : tried_positions) {
+        s << bucket << position;
+    }
+    for (const uint8_t position : new_positions) {
+        s << position;
     }
-    s << asmap_checksum;
 }
 
 template <typename Stream>
@@ -293,31 +312,18 @@ void AddrManImpl::Unserialize(Stream& s_)
     }
     nIdCount = nNew;
 
-    // Deserialize entries from the tried table.
-    int nLost = 0;
-    for (int n = 0; n < nTried; n++) {
-        AddrInfo info;
+    // Deserialize entries from the tried table. They are only added to the
+    // table below, once it is known whether their stored positions can be used.
+    std::vector<AddrInfo> tried_entries(nTried);
+    for (AddrInfo& info : tried_entries) {
         s >> info;
-        int nKBucket = info.GetTriedBucket(nKey, m_asmap);
-        int nKBucketPos = info.GetBucketPosition(nKey, false, nKBucket);
-        if (info.IsValid()
-                && vvTried[nKBucket][nKBucketPos] == -1) {
-            info.nRandomPos = vRandom.size();
-            info.fInTried = true;
-            vRandom.push_back(nIdCount);
-            mapInfo[nIdCount] = info;
-            mapAddr[info] = nIdCount;
-            vvTried[nKBucket][nKBucketPos] = nIdCount;
-            nIdCount++;
-        } else {
-            nLost++;
-        }
     }
-    nTried -= nLost;
 
     // Store positions in the new table buckets to apply later (if possible).
     // An entry may appear in up to ADDRMAN_NEW_BUCKETS_PER_ADDRESS buckets,
     // so we store all bucket-entry_index pairs to iterate through later.
+    // Entries with an out-of-range index are kept (and skipped later) so that
+    // they line up with the stored bucket positions.
     std::vector<std::pair<int, int>> bucket_entries;
 
     for (int bucket = 0; bucket < nUBuckets; ++bucket) {
@@ -326,33 +332,77 @@ void AddrManImpl::Unserialize(Stream& s_)
         for (int n = 0; n < num_entries; ++n) {
             int entry_index{0};
             s >> entry_index;
-            if (entry_index >= 0 && entry_index < nNew) {
-                bucket_entries.emplace_back(bucket, entry_index);
-            }
+            bucket_entries.emplace_back(bucket, entry_index);
         }
     }
 
     // If the bucket count and asmap checksum haven't changed, then attempt
     // to restore the entries to the buckets/positions they were in before
     // serialization.
-    uint256 supplied_asmap_checksum;
-    if (m_asmap.size() != 0) {
-        supplied_asmap_checksum = SerializeHash(m_asmap);
-    }
     uint256 serialized_asmap_checksum;
     if (format >= Format::V2_ASMAP) {
         s >> serialized_asmap_checksum;
     }
     const bool restore_bucketing{nUBuckets == ADDRMAN_NEW_BUCKET_COUNT &&
-        serialized_asmap_checksum == supplied_asmap_checksum};
+        serialized_asmap_checksum == m_asmap_checksum};
 
     if (!restore_bucketing) {
         LogPrint(BCLog::ADDRMAN, "Bucketing method was updated, re-bucketing addrman entries from disk\n");
     }
 
-    for (auto bucket_entry : bucket_entries) {
-        int bucket{bucket_entry.first};
-        const int entry_index{bucket_entry.second};
+    // Since V5 the positions of all entries are stored as well. They are only
+    // valid if the bucketing has not changed (nKey is part of the file), and
+    // are range-checked below, so that a position can only ever be rejected.
+    std::vector<std::pair<uint16_t, uint8_t>> tried_positions;
+    std::vector<uint8_t> new_positions;
+    if (format >= Format::V5_BUCKET_POSITIONS) {
+        int tried_bucket_count{0}, bucket_size{0};
+        s >> tried_bucket_count >> bucket_size;
+        tried_positions.resize(tried_entries.size());
+        for (auto& [bucket, position] : tried_positions) {
+            s >> bucket >> position;
+        }
+        new_positions.resize(bucket_entries.size());
+        for (uint8_t& position : new_positions) {
+            s >> position;
+        }
+        if (!restore_bucketing || tried_bucket_count != ADDRMAN_TRIED_BUCKET_COUNT || bucket_size != ADDRMAN_BUCKET_SIZE) {
+            tried_positions.clear();
+            new_positions.clear();
+        }
+    }
+
+    int nLost = 0;
+    for (size_t n = 0; n < tried_entries.size(); ++n) {
+        AddrInfo& info = tried_entries[n];
+        int nKBucket, nKBucketPos;
+        if (!tried_positions.empty() && tried_positions[n].first < ADDRMAN_TRIED_BUCKET_COUNT &&
+            tried_positions[n].second < ADDRMAN_BUCKET_SIZE) {
+            nKBucket = tried_positions[n].first;
+            nKBucketPos = tried_positions[n].second;
+        } else {
+            nKBucket = info.GetTriedBucket(nKey, m_asmap);
+            nKBucketPos = info.GetBucketPosition(nKey, false, nKBucket);
+        }
+        if (info.IsValid()
+                && vvTried[nKBucket][nKBucketPos] == -1) {
+            info.nRandomPos = vRandom.size();
+            info.fInTried = true;
+            vRandom.push_back(nIdCount);
+            mapInfo[nIdCount] = info;
+            mapAddr[info] = nIdCount;
+            vvTried[nKBucket][nKBucketPos] = nIdCount;
+            nIdCount++;
+        } else {
+            nLost++;
+        }
+    }
+    nTried -= nLost;
+
+    for (size_t n = 0; n < bucket_entries.size(); ++n) {
+        int bucket{bucket_entries[n].first};
+        const int entry_index{bucket_entries[n].second};
+        if (entry_index < 0 || entry_index >= nNew) continue;
         AddrInfo& info = mapInfo[entry_index];
 
         // Don't store the entry in the new bucket if it's not a valid address for our addrman
@@ -363,7 +413,9 @@ void AddrManImpl::Unserialize(Stream& s_)
         // this bucket_entry.
         if (info.nRefCount >= ADDRMAN_NEW_BUCKETS_PER_ADDRESS) continue;
 
-        int bucket_position = info.GetBucketPosition(nKey, true, bucket);
+        int bucket_position = !new_positions.empty() && new_positions[n] < ADDRMAN_BUCKET_SIZE ?
+                                  new_positions[n] :
+                                  info.GetBucketPosition(nKey, true, bucket);
         if (restore_bucketing && vvNew[bucket][bucket_position] == -1) {
             // Bucketing has not changed, using existing bucket positions for the new table
             vvNew[bucket][bucket_position] = entry_index;
@@ -1154,7 +1206,7 @@ std::optional<AddressPosition> AddrManImpl::FindAddressEntry(const CAddress& add
     return entry;
 }
 
-const std::vector<bool>& AddrManImpl::GetAsmap() const
+const CompiledASMap& AddrManImpl::GetAsmap() const
 {
     return m_asmap;
 }
@@ -1235,7 +1287,7 @@ void AddrMan::SetServices(const CService& addr, ServiceFlags nServices)
     m_impl->SetServices(addr, nServices);
 }
 
-const std::vector<bool>& AddrMan::GetAsmap() const
+const CompiledASMap& AddrMan::GetAsmap() const
 {
     return m_impl->GetAsmap();
 }
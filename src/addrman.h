@@ -172,7 +172,7 @@ public:
     //! Update an entry's service bits.
     void SetServices(const CService& addr, ServiceFlags nServices);
 
-    const std::vector<bool>& GetAsmap() const;
+    const CompiledASMap& GetAsmap() const;
 
     /** Test-only function
      * Find the address record in AddrMan and return information about its
@@ -12,6 +12,7 @@
 #include <serialize.h>
 #include <sync.h>
 #include <uint256.h>
+#include <util/asmap.h>
 
 #include <cstdint>
 #include <optional>
@@ -76,13 +77,13 @@ public:
     }
 
     //! Calculate in which "tried" bucket this entry belongs
-    int GetTriedBucket(const uint256 &nKey, const std::vector<bool> &asmap) const;
+    int GetTriedBucket(const uint256 &nKey, const CompiledASMap& asmap) const;
 
     //! Calculate in which "new" bucket this entry belongs, given a certain source
-    int GetNewBucket(const uint256 &nKey, const CNetAddr& src, const std::vector<bool> &asmap) const;
+    int GetNewBucket(const uint256 &nKey, const CNetAddr& src, const CompiledASMap& asmap) const;
 
     //! Calculate in which "new" bucket this entry belongs, using its default source
-    int GetNewBucket(const uint256 &nKey, const std::vector<bool> &asmap) const
+    int GetNewBucket(const uint256 &nKey, const CompiledASMap& asmap) const
     {
         return GetNewBucket(nKey, source, asmap);
     }
@@ -140,7 +141,7 @@ public:
     std::optional<AddressPosition> FindAddressEntry(const CAddress& addr)
         EXCLUSIVE_LOCKS_REQUIRED(!cs);
 
-    const std::vector<bool>& GetAsmap() const;
+    const CompiledASMap& GetAsmap() const;
 
     friend class AddrManDeterministic;
 
@@ -161,6 +162,7 @@ private:
         V2_ASMAP = 2,         //!< for files including asmap version
         V3_BIP155 = 3,        //!< same as V2_ASMAP plus addresses are in BIP155 format
         V4_MULTIPORT = 4,     //!< adds support for multiple ports per IP
+        V5_BUCKET_POSITIONS = 5, //!< same as V4_MULTIPORT plus bucket positions of all entries
     };
 
     //! The maximum format this software knows it can unserialize. Also, we always serialize
@@ -168,7 +170,7 @@ private:
     //! The format (first byte in the serialized stream) can be higher than this and
     //! still this software may be able to unserialize the file - if the second byte
     //! (see `lowest_compatible` in `Unserialize()`) is less or equal to this.
-    static constexpr Format FILE_FORMAT = Format::V4_MULTIPORT;
+    static constexpr Format FILE_FORMAT = Format::V5_BUCKET_POSITIONS;
 
     //! The initial value of a field that is incremented every time an incompatible format
     //! change is made (such that old software versions would not be able to parse and
@@ -226,7 +228,12 @@ private:
     //
     // If a new asmap was provided, the existing records
     // would be re-bucketed accordingly.
-    const std::vector<bool> m_asmap;
+    //
+    // The mapping is compiled for fast lookups when AddrMan is created.
+    const CompiledASMap m_asmap;
+
+    //! Hash of the asmap, or null if no asmap was provided. Stored in peers.dat to detect a changed asmap.
+    const uint256 m_asmap_checksum;
 
     //! Find an entry.
     AddrInfo* Find(const CService& addr, int* pnId = nullptr) EXCLUSIVE_LOCKS_REQUIRED(cs);
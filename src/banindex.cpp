@@ -0,0 +1,243 @@
+// Copyright (c) 2022 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <banindex.h>
+
+#include <crypto/siphash.h>
+#include <random.h>
+
+#include <algorithm>
+#include <limits>
+
+namespace {
+
+using Key = std::array<uint8_t, ADDR_IPV6_SIZE>;
+
+bool GetBit(const Key& key, unsigned int pos)
+{
+    return (key[pos / 8] >> (7 - pos % 8)) & 1;
+}
+
+/** Number of leading bits a and b have in common, capped at max_bits. */
+unsigned int CommonPrefixLen(const Key& a, const Key& b, unsigned int max_bits)
+{
+    unsigned int len = 0;
+    for (size_t i = 0; i < a.size() && len < max_bits; ++i) {
+        const uint8_t diff = a[i] ^ b[i];
+        if (diff == 0) {
+            len += 8;
+            continue;
+        }
+        for (uint8_t mask = 0x80; (diff & mask) == 0; mask >>= 1) ++len;
+        break;
+    }
+    return std::min(len, max_bits);
+}
+
+/** Copy of key with all bits from position len onwards cleared. */
+Key Truncate(const Key& key, unsigned int len)
+{
+    Key ret{};
+    for (size_t i = 0; i < ret.size() && len > 0; ++i) {
+        const unsigned int bits = std::min(len, 8u);
+        ret[i] = key[i] & (uint8_t)(0xFF << (8 - bits));
+        len -= bits;
+    }
+    return ret;
+}
+
+} // namespace
+
+BanIndex::AddrHasher::AddrHasher()
+    : m_salt_k0{GetRand(std::numeric_limits<uint64_t>::max())},
+      m_salt_k1{GetRand(std::numeric_limits<uint64_t>::max())}
+{
+}
+
+size_t BanIndex::AddrHasher::operator()(const CNetAddr& addr) const noexcept
+{
+    CSipHasher hasher(m_salt_k0, m_salt_k1);
+    hasher.Write(addr.m_net);
+    hasher.Write(addr.m_addr.data(), addr.m_addr.size());
+    return static_cast<size_t>(hasher.Finalize());
+}
+
+BanIndex::Key BanIndex::SubNetKey(const CSubNet& sub_net, uint8_t& prefix_len)
+{
+    const CNetAddr& network = sub_net.network;
+    Key key{};
+    std::copy(network.m_addr.begin(), network.m_addr.end(), key.begin());
+    prefix_len = 0;
+    for (size_t i = 0; i < network.m_addr.size(); ++i) {
+        for (uint8_t mask = 0x80; mask != 0 && (sub_net.netmask[i] & mask); mask >>= 1) ++prefix_len;
+    }
+    return key;
+}
+
+std::unique_ptr<BanIndex::Node>* BanIndex::Root(Network net)
+{
+    switch (net) {
+    case NET_IPV4: return &m_ipv4_root;
+    case NET_IPV6: return &m_ipv6_root;
+    default: return nullptr;
+    }
+}
+
+const std::unique_ptr<BanIndex::Node>* BanIndex::Root(Network net) const
+{
+    return const_cast<BanIndex*>(this)->Root(net);
+}
+
+void BanIndex::Insert(const CSubNet& sub_net, int64_t ban_until)
+{
+    if (!sub_net.IsValid()) return;
+
+    const CNetAddr& network = sub_net.network;
+    std::unique_ptr<Node>* slot = Root(network.m_net);
+    if (slot == nullptr) {
+        auto [it, inserted] = m_hosts.try_emplace(network, Entry{sub_net, ban_until});
+        if (inserted) {
+            ++m_size;
+        } else {
+            it->second.ban_until = ban_until;
+        }
+        return;
+    }
+
+    uint8_t key_len;
+    const Key key{SubNetKey(sub_net, key_len)};
+
+    while (true) {
+        if (!*slot) {
+            auto leaf = std::make_unique<Node>();
+            leaf->m_prefix = key;
+            leaf->m_prefix_len = key_len;
+            leaf->m_entry = Entry{sub_net, ban_until};
+            *slot = std::move(leaf);
+            ++m_size;
+            return;
+        }
+        const unsigned int common = CommonPrefixLen((*slot)->m_prefix, key, std::min((*slot)->m_prefix_len, key_len));
+        if (common < (*slot)->m_prefix_len) {
+            // The existing node is more specific than what we share with it, so
+            // split off a new parent for the common part of both prefixes.
+            auto parent = std::make_unique<Node>();
+            parent->m_prefix = Truncate(key, common);
+            parent->m_prefix_len = common;
+            const bool bit = GetBit((*slot)->m_prefix, common);
+            parent->m_children[bit] = std::move(*slot);
+            *slot = std::move(parent);
+        }
+        Node& node = **slot;
+        if (node.m_prefix_len == key_len) {
+            if (!node.m_entry) ++m_size;
+            node.m_entry = Entry{sub_net, ban_until};
+            return;
+        }
+        slot = &node.m_children[GetBit(key, node.m_prefix_len)];
+    }
+}
+
+bool BanIndex::EraseFromTrie(std::unique_ptr<Node>& slot, const Key& key, uint8_t key_len)
+{
+    Node* node = slot.get();
+    if (!node || node->m_prefix_len > key_len ||
+        CommonPrefixLen(node->m_prefix, key, node->m_prefix_len) < node->m_prefix_len) {
+        return false;
+    }
+
+    if (node->m_prefix_len == key_len) {
+        if (!node->m_entry) return false;
+        node->m_entry.reset();
+    } else if (!EraseFromTrie(node->m_children[GetBit(key, node->m_prefix_len)], key, key_len)) {
+        return false;
+    }
+
+    // Keep the trie path-compressed: a node without an entry needs two children.
+    if (!node->m_entry && !(node->m_children[0] && node->m_children[1])) {
+        slot = std::move(node->m_children[0] ? node->m_children[0] : node->m_children[1]);
+    }
+    return true;
+}
+
+bool BanIndex::Erase(const CSubNet& sub_net)
+{
+    if (!sub_net.IsValid()) return false;
+
+    const CNetAddr& network = sub_net.network;
+    std::unique_ptr<Node>* root = Root(network.m_net);
+    if (root == nullptr) {
+        if (m_hosts.erase(network) == 0) return false;
+        --m_size;
+        return true;
+    }
+
+    uint8_t key_len;
+    const Key key{SubNetKey(sub_net, key_len)};
+    if (!EraseFromTrie(*root, key, key_len)) return false;
+    --m_size;
+    return true;
+}
+
+void BanIndex::Clear()
+{
+    m_ipv4_root.reset();
+    m_ipv6_root.reset();
+    m_hosts.clear();
+    m_size = 0;
+}
+
+void BanIndex::Rebuild(const banmap_t& banmap)
+{
+    Clear();
+    for (const auto& [sub_net, ban_entry] : banmap) {
+        Insert(sub_net, ban_entry.nBanUntil);
+    }
+}
+
+template <typename Fn>
+void BanIndex::ForEachMatch(const CNetAddr& addr, int64_t now, Fn&& fn) const
+{
+    if (!addr.IsValid()) return;
+
+    const std::unique_ptr<Node>* root = Root(addr.m_net);
+    if (root == nullptr) {
+        const auto it = m_hosts.find(addr);
+        if (it != m_hosts.end() && now < it->second.ban_until) fn(it->second);
+        return;
+    }
+
+    Key key{};
+    std::copy(addr.m_addr.begin(), addr.m_addr.end(), key.begin());
+    const unsigned int key_len = addr.m_addr.size() * 8;
+
+    for (const Node* node = root->get(); node != nullptr;) {
+        if (CommonPrefixLen(node->m_prefix, key, node->m_prefix_len) < node->m_prefix_len) break;
+        if (node->m_entry && now < node->m_entry->ban_until) {
+            if (fn(*node->m_entry)) return;
+        }
+        if (node->m_prefix_len >= key_len) break;
+        node = node->m_children[GetBit(key, node->m_prefix_len)].get();
+    }
+}
+
+bool BanIndex::IsBanned(const CNetAddr& addr, int64_t now) const
+{
+    bool banned{false};
+    ForEachMatch(addr, now, [&](const Entry&) {
+        banned = true;
+        return true;
+    });
+    return banned;
+}
+
+std::optional<CSubNet> BanIndex::FindLongestMatch(const CNetAddr& addr, int64_t now) const
+{
+    std::optional<CSubNet> ret;
+    ForEachMatch(addr, now, [&](const Entry& entry) {
+        ret = entry.sub_net;
+        return false;
+    });
+    return ret;
+}
@@ -0,0 +1,107 @@
+// Copyright (c) 2022 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_BANINDEX_H
+#define BITCOIN_BANINDEX_H
+
+#include <net_types.h> // For banmap_t
+#include <netaddress.h>
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <unordered_map>
+
+/**
+ * Lookup structure over the banned subnets of a BanMan.
+ *
+ * IPv4 and IPv6 subnets are kept in one path-compressed binary trie (radix
+ * tree) per network, keyed on the network bits of the subnet. Matching an
+ * address walks a single root-to-leaf path, so the cost of a lookup is bounded
+ * by the address length instead of by the number of bans. Tor, I2P and CJDNS
+ * entries can only ever match a single address and are kept in a hash map.
+ *
+ * The index stores the expiry time of every entry, and an entry only matches
+ * while it has not expired yet. This mirrors the linear scan over `banmap_t`
+ * it replaces: expired entries stay in the index until they are swept from
+ * the ban map.
+ */
+class BanIndex
+{
+public:
+    BanIndex() = default;
+    BanIndex(const BanIndex&) = delete;
+    BanIndex& operator=(const BanIndex&) = delete;
+
+    //! Add sub_net, or update its expiry time if it is already present. Invalid subnets are ignored.
+    void Insert(const CSubNet& sub_net, int64_t ban_until);
+
+    //! Remove sub_net. Returns whether it was present.
+    bool Erase(const CSubNet& sub_net);
+
+    //! Remove all entries.
+    void Clear();
+
+    //! Replace the contents of the index with the entries of banmap.
+    void Rebuild(const banmap_t& banmap);
+
+    //! Return whether any subnet containing addr is banned until after now.
+    bool IsBanned(const CNetAddr& addr, int64_t now) const;
+
+    //! Return the most specific subnet containing addr that is banned until after now.
+    std::optional<CSubNet> FindLongestMatch(const CNetAddr& addr, int64_t now) const;
+
+    //! Number of subnets in the index.
+    size_t Size() const { return m_size; }
+
+private:
+    using Key = std::array<uint8_t, ADDR_IPV6_SIZE>;
+
+    struct Entry {
+        CSubNet sub_net;
+        int64_t ban_until;
+    };
+
+    struct Node {
+        //! Prefix bits of this node; all bits past m_prefix_len are zero.
+        Key m_prefix{};
+        //! Number of significant bits in m_prefix.
+        uint8_t m_prefix_len{0};
+        //! Ban stored for exactly this prefix, if any.
+        std::optional<Entry> m_entry;
+        std::unique_ptr<Node> m_children[2];
+    };
+
+    class AddrHasher
+    {
+    public:
+        AddrHasher();
+        size_t operator()(const CNetAddr& addr) const noexcept;
+
+    private:
+        const uint64_t m_salt_k0;
+        const uint64_t m_salt_k1;
+    };
+
+    //! Return the trie root for the network of addr, or nullptr for non-IP networks.
+    std::unique_ptr<Node>* Root(Network net);
+    const std::unique_ptr<Node>* Root(Network net) const;
+
+    //! Return the trie key of an IPv4 or IPv6 subnet and set prefix_len to its CIDR length.
+    static Key SubNetKey(const CSubNet& sub_net, uint8_t& prefix_len);
+
+    static bool EraseFromTrie(std::unique_ptr<Node>& slot, const Key& key, uint8_t key_len);
+
+    //! Walk the trie path of addr, calling fn(entry) for every unexpired match from least to most specific.
+    template <typename Fn>
+    void ForEachMatch(const CNetAddr& addr, int64_t now, Fn&& fn) const;
+
+    std::unique_ptr<Node> m_ipv4_root;
+    std::unique_ptr<Node> m_ipv6_root;
+    std::unordered_map<CNetAddr, Entry, AddrHasher> m_hosts;
+    size_t m_size{0};
+};
+
+#endif // BITCOIN_BANINDEX_H
@@ -6,6 +6,7 @@
 #define BITCOIN_BANMAN_H
 
 #include <addrdb.h>
+#include <banindex.h>
 #include <common/bloom.h>
 #include <fs.h>
 #include <net_types.h> // For banmap_t
@@ -88,6 +89,8 @@ private:
 
     RecursiveMutex m_cs_banned;
     banmap_t m_banned GUARDED_BY(m_cs_banned);
+    //! Index over m_banned for IsBanned(const CNetAddr&), kept in sync on every change to m_banned
+    BanIndex m_ban_index GUARDED_BY(m_cs_banned);
     bool m_is_dirty GUARDED_BY(m_cs_banned){false};
     CClientUIInterface* m_client_interface = nullptr;
     CBanDB m_ban_db;
@@ -5,8 +5,11 @@
 #include <addrman.h>
 #include <bench/bench.h>
 #include <random.h>
+#include <streams.h>
+#include <util/asmap.h>
 #include <util/check.h>
 #include <util/time.h>
+#include <version.h>
 
 #include <optional>
 #include <vector>
@@ -22,6 +25,67 @@ static constexpr uint32_t ADDRMAN_CONSISTENCY_CHECK_RATIO{0};
 static std::vector<CAddress> g_sources;
 static std::vector<std::vector<CAddress>> g_addresses;
 
+/** Append val to out using the variable-length integer encoding of asmap instructions. */
+static void EncodeAsmapBits(std::vector<bool>& out, uint32_t val, uint32_t minval, const std::vector<uint8_t>& bit_sizes)
+{
+    val -= minval;
+    for (size_t i = 0; i < bit_sizes.size(); ++i) {
+        const bool last{i + 1 == bit_sizes.size()};
+        if (!last && val >= (uint32_t{1} << bit_sizes[i])) {
+            out.push_back(true);
+            val -= uint32_t{1} << bit_sizes[i];
+            continue;
+        }
+        if (!last) out.push_back(false);
+        for (int b = bit_sizes[i] - 1; b >= 0; --b) out.push_back((val >> b) & 1);
+        return;
+    }
+}
+
+/**
+ * Generate an asmap that branches on the first `depth` bits of the address,
+ * and then maps every prefix to one AS for a single matching next byte and
+ * to another AS otherwise. For depth 16 this is of similar size as real asmaps.
+ */
+static std::vector<bool> CreateAsmapTree(int depth, uint32_t& next_asn)
+{
+    static const std::vector<uint8_t> TYPE_BITS{0, 0, 1};
+    static const std::vector<uint8_t> ASN_BITS{15, 16, 17, 18, 19, 20, 21, 22, 23, 24};
+    static const std::vector<uint8_t> MATCH_BITS{1, 2, 3, 4, 5, 6, 7, 8};
+    static const std::vector<uint8_t> JUMP_BITS{5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 17, 18, 19, 20, 21, 22, 23, 24, 25, 26, 27, 28, 29, 30};
+    enum : uint32_t { RETURN = 0, JUMP = 1, MATCH = 2, DEFAULT = 3 };
+
+    std::vector<bool> out;
+    if (depth == 0) {
+        EncodeAsmapBits(out, DEFAULT, 0, TYPE_BITS);
+        EncodeAsmapBits(out, next_asn++, 1, ASN_BITS);
+        EncodeAsmapBits(out, MATCH, 0, TYPE_BITS);
+        EncodeAsmapBits(out, 0x100 | (next_asn & 0xFF), 2, MATCH_BITS);
+        EncodeAsmapBits(out, RETURN, 0, TYPE_BITS);
+        EncodeAsmapBits(out, next_asn++, 1, ASN_BITS);
+        return out;
+    }
+    const std::vector<bool> zero{CreateAsmapTree(depth - 1, next_asn)};
+    const std::vector<bool> one{CreateAsmapTree(depth - 1, next_asn)};
+    EncodeAsmapBits(out, JUMP, 0, TYPE_BITS);
+    EncodeAsmapBits(out, zero.size(), 17, JUMP_BITS);
+    out.insert(out.end(), zero.begin(), zero.end());
+    out.insert(out.end(), one.begin(), one.end());
+    return out;
+}
+
+static const std::vector<bool>& GetAsmap()
+{
+    static const std::vector<bool> asmap{[] {
+        uint32_t next_asn{1};
+        std::vector<bool> asmap{CreateAsmapTree(/*depth=*/16, next_asn)};
+        while (asmap.size() % 8 != 0) asmap.push_back(false);
+        assert(SanityCheckASMap(asmap, 128));
+        return asmap;
+    }()};
+    return asmap;
+}
+
 static void CreateAddresses()
 {
     if (g_sources.size() > 0) { // already created
@@ -72,16 +136,26 @@ static void FillAddrMan(AddrMan& addrman)
 
 /* Benchmarks */
 
-static void AddrManAdd(benchmark::Bench& bench)
+static void BenchAddrManAdd(benchmark::Bench& bench, const std::vector<bool>& asmap)
 {
     CreateAddresses();
 
     bench.run([&] {
-        AddrMan addrman{EMPTY_ASMAP, /*deterministic=*/false, ADDRMAN_CONSISTENCY_CHECK_RATIO};
+        AddrMan addrman{asmap, /*deterministic=*/false, ADDRMAN_CONSISTENCY_CHECK_RATIO};
         AddAddressesToAddrMan(addrman);
     });
 }
 
+static void AddrManAdd(benchmark::Bench& bench)
+{
+    BenchAddrManAdd(bench, EMPTY_ASMAP);
+}
+
+static void AddrManAddAsmap(benchmark::Bench& bench)
+{
+    BenchAddrManAdd(bench, GetAsmap());
+}
+
 static void AddrManSelect(benchmark::Bench& bench)
 {
     AddrMan addrman{EMPTY_ASMAP, /*deterministic=*/false, ADDRMAN_CONSISTENCY_CHECK_RATIO};
@@ -132,7 +206,73 @@ static void AddrManAddThenGood(benchmark::Bench& bench)
     });
 }
 
+static void BenchAddrManDeserialize(benchmark::Bench& bench, const std::vector<bool>& asmap)
+{
+    AddrMan addrman{asmap, /*deterministic=*/false, ADDRMAN_CONSISTENCY_CHECK_RATIO};
+    FillAddrMan(addrman);
+    for (size_t source_i = 0; source_i < NUM_SOURCES; source_i += 4) {
+        for (const CAddress& addr : g_addresses[source_i]) addrman.Good(addr);
+    }
+
+    CDataStream stream(SER_DISK, PROTOCOL_VERSION);
+    stream << addrman;
+
+    bench.run([&] {
+        AddrMan addrman_loaded{asmap, /*deterministic=*/false, ADDRMAN_CONSISTENCY_CHECK_RATIO};
+        CDataStream stream_copy{stream};
+        stream_copy >> addrman_loaded;
+        assert(addrman_loaded.size() > 0);
+    });
+}
+
+static void AddrManDeserialize(benchmark::Bench& bench)
+{
+    BenchAddrManDeserialize(bench, EMPTY_ASMAP);
+}
+
+static void AddrManDeserializeAsmap(benchmark::Bench& bench)
+{
+    BenchAddrManDeserialize(bench, GetAsmap());
+}
+
+static void AsmapInterpret(benchmark::Bench& bench)
+{
+    CreateAddresses();
+    const std::vector<bool>& asmap{GetAsmap()};
+
+    std::vector<std::vector<bool>> ips;
+    for (const CAddress& addr : g_addresses[0]) {
+        const std::vector<unsigned char> bytes{addr.GetAddrBytes()};
+        std::vector<bool> ip(128);
+        for (size_t bit = 0; bit < ip.size(); ++bit) ip[bit] = (bytes[bit / 8] >> (7 - bit % 8)) & 1;
+        ips.push_back(std::move(ip));
+    }
+
+    bench.batch(ips.size()).unit("lookup").run([&] {
+        for (const auto& ip : ips) {
+            ankerl::nanobench::doNotOptimizeAway(Interpret(asmap, ip));
+        }
+    });
+}
+
+static void AsmapLookup(benchmark::Bench& bench)
+{
+    CreateAddresses();
+    const CompiledASMap asmap{GetAsmap()};
+
+    bench.batch(g_addresses[0].size()).unit("lookup").run([&] {
+        for (const CAddress& addr : g_addresses[0]) {
+            ankerl::nanobench::doNotOptimizeAway(addr.GetMappedAS(asmap));
+        }
+    });
+}
+
 BENCHMARK(AddrManAdd);
+BENCHMARK(AddrManAddAsmap);
 BENCHMARK(AddrManSelect);
 BENCHMARK(AddrManGetAddr);
 BENCHMARK(AddrManAddThenGood);
+BENCHMARK(AddrManDeserialize);
+BENCHMARK(AddrManDeserializeAsmap);
+BENCHMARK(AsmapInterpret);
+BENCHMARK(AsmapLookup);
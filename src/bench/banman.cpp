@@ -0,0 +1,102 @@
+// Copyright (c) 2022 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <banindex.h>
+#include <bench/bench.h>
+#include <netaddress.h>
+#include <random.h>
+#include <uint256.h>
+
+#include <cstring>
+#include <vector>
+
+static constexpr size_t NUM_BANNED_SUBNETS = 100000;
+static constexpr size_t NUM_LOOKUPS = 1000;
+static constexpr int64_t BAN_UNTIL{1000};
+static constexpr int64_t NOW{500};
+
+static CNetAddr RandomAddr(FastRandomContext& rng)
+{
+    if (rng.randbool()) {
+        in_addr addr;
+        const auto bytes{rng.randbytes(sizeof(addr))};
+        memcpy(&addr, bytes.data(), sizeof(addr));
+        return CNetAddr{addr};
+    }
+    in6_addr addr;
+    const auto bytes{rng.randbytes(sizeof(addr))};
+    memcpy(&addr, bytes.data(), sizeof(addr));
+    return CNetAddr{addr};
+}
+
+/** A blocklist of mixed IPv4/IPv6 subnets and single hosts, as imported from public lists. */
+static banmap_t CreateBanMap(FastRandomContext& rng)
+{
+    banmap_t banmap;
+    while (banmap.size() < NUM_BANNED_SUBNETS) {
+        const CNetAddr addr{RandomAddr(rng)};
+        const int max_bits = addr.IsIPv4() ? 32 : 128;
+        const uint8_t mask = rng.randbool() ? max_bits : max_bits / 2 + rng.randrange(max_bits / 2);
+        CBanEntry entry;
+        entry.nBanUntil = BAN_UNTIL;
+        banmap.emplace(CSubNet{addr, mask}, entry);
+    }
+    return banmap;
+}
+
+static void BanIndexIsBanned(benchmark::Bench& bench)
+{
+    FastRandomContext rng{uint256{std::vector<unsigned char>(32, 26)}};
+    const banmap_t banmap{CreateBanMap(rng)};
+    BanIndex index;
+    index.Rebuild(banmap);
+
+    std::vector<CNetAddr> lookups;
+    for (size_t i = 0; i < NUM_LOOKUPS; ++i) lookups.push_back(RandomAddr(rng));
+
+    bench.batch(NUM_LOOKUPS).unit("lookup").run([&] {
+        for (const CNetAddr& addr : lookups) {
+            ankerl::nanobench::doNotOptimizeAway(index.IsBanned(addr, NOW));
+        }
+    });
+}
+
+/** The linear scan over all banned subnets that BanIndex replaces, for comparison. */
+static void BanMapLinearScan(benchmark::Bench& bench)
+{
+    FastRandomContext rng{uint256{std::vector<unsigned char>(32, 26)}};
+    const banmap_t banmap{CreateBanMap(rng)};
+
+    // Every lookup touches all entries, so use fewer of them.
+    std::vector<CNetAddr> lookups;
+    for (size_t i = 0; i < NUM_LOOKUPS / 100; ++i) lookups.push_back(RandomAddr(rng));
+
+    bench.batch(lookups.size()).unit("lookup").run([&] {
+        for (const CNetAddr& addr : lookups) {
+            bool banned{false};
+            for (const auto& [sub_net, entry] : banmap) {
+                if (NOW < entry.nBanUntil && sub_net.Match(addr)) {
+                    banned = true;
+                    break;
+                }
+            }
+            ankerl::nanobench::doNotOptimizeAway(banned);
+        }
+    });
+}
+
+static void BanIndexRebuild(benchmark::Bench& bench)
+{
+    FastRandomContext rng{uint256{std::vector<unsigned char>(32, 26)}};
+    const banmap_t banmap{CreateBanMap(rng)};
+    BanIndex index;
+
+    bench.batch(banmap.size()).unit("subnet").run([&] {
+        index.Rebuild(banmap);
+    });
+}
+
+BENCHMARK(BanIndexIsBanned);
+BENCHMARK(BanMapLinearScan);
+BENCHMARK(BanIndexRebuild);
@@ -3,33 +3,42 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include <bench/bench.h>
+#include <chainparams.h>
 #include <consensus/validation.h>
 #include <crypto/sha256.h>
+#include <node/candidateblock.h>
 #include <test/util/mining.h>
 #include <test/util/script.h>
 #include <test/util/setup_common.h>
 #include <test/util/wallet.h>
 #include <txmempool.h>
 #include <validation.h>
-
+#include <validationinterface.h>
 
 #include <vector>
 
-static void AssembleBlock(benchmark::Bench& bench)
-{
-    const auto test_setup = MakeNoLogFileContext<const TestingSetup>();
+using node::BlockAssembler;
+using node::CandidateBlock;
 
+/**
+ * Mine blocks and fill the mempool with a chain of chain_length transactions
+ * spending each mature coinbase. Every transaction in a chain pays more than
+ * its parent, so that each one pays for its ancestors.
+ */
+static void FillMempool(const TestingSetup& test_setup, size_t chain_length)
+{
     CScriptWitness witness;
     witness.stack.push_back(WITNESS_STACK_ELEM_OP_TRUE);
 
     // Collect some loose transactions that spend the coinbases of our mined blocks
     constexpr size_t NUM_BLOCKS{200};
     std::array<CTransactionRef, NUM_BLOCKS - COINBASE_MATURITY + 1> txs;
+    const CAmount chain_fees{1000 * static_cast<CAmount>(chain_length * (chain_length - 1) / 2)};
     for (size_t b{0}; b < NUM_BLOCKS; ++b) {
         CMutableTransaction tx;
-        tx.vin.push_back(MineBlock(test_setup->m_node, P2WSH_OP_TRUE));
+        tx.vin.push_back(MineBlock(test_setup.m_node, P2WSH_OP_TRUE));
         tx.vin.back().scriptWitness = witness;
-        tx.vout.emplace_back(1337, P2WSH_OP_TRUE);
+        tx.vout.emplace_back(1337 + chain_fees, P2WSH_OP_TRUE);
         if (NUM_BLOCKS - b >= COINBASE_MATURITY)
             txs.at(b) = MakeTransactionRef(tx);
     }
@@ -37,14 +46,58 @@ static void AssembleBlock(benchmark::Bench& bench)
         LOCK(::cs_main);
 
         for (const auto& txr : txs) {
-            const MempoolAcceptResult res = test_setup->m_node.chainman->ProcessTransaction(txr);
+            const MempoolAcceptResult res = test_setup.m_node.chainman->ProcessTransaction(txr);
             assert(res.m_result_type == MempoolAcceptResult::ResultType::VALID);
+            CTransactionRef parent{txr};
+            for (size_t i{1}; i < chain_length; ++i) {
+                CMutableTransaction child;
+                child.vin.emplace_back(COutPoint{parent->GetHash(), 0});
+                child.vin.back().scriptWitness = witness;
+                child.vout.emplace_back(parent->vout[0].nValue - 1000 * static_cast<CAmount>(i), P2WSH_OP_TRUE);
+                parent = MakeTransactionRef(child);
+                const MempoolAcceptResult child_res = test_setup.m_node.chainman->ProcessTransaction(parent);
+                assert(child_res.m_result_type == MempoolAcceptResult::ResultType::VALID);
+            }
         }
     }
+}
+
+static void AssembleBlock(benchmark::Bench& bench)
+{
+    const auto test_setup = MakeNoLogFileContext<const TestingSetup>();
+    FillMempool(*test_setup, /*chain_length=*/1);
+
+    bench.run([&] {
+        PrepareBlock(test_setup->m_node, P2WSH_OP_TRUE);
+    });
+}
+
+static void AssembleBlockChains(benchmark::Bench& bench)
+{
+    const auto test_setup = MakeNoLogFileContext<const TestingSetup>();
+    FillMempool(*test_setup, DEFAULT_ANCESTOR_LIMIT);
 
     bench.run([&] {
         PrepareBlock(test_setup->m_node, P2WSH_OP_TRUE);
     });
 }
 
+static void AssembleBlockIncremental(benchmark::Bench& bench)
+{
+    const auto test_setup = MakeNoLogFileContext<const TestingSetup>();
+    CandidateBlock candidate{*test_setup->m_node.chainman, *test_setup->m_node.mempool, Params(), BlockAssembler::DefaultOptions()};
+    RegisterValidationInterface(&candidate);
+    FillMempool(*test_setup, /*chain_length=*/1);
+    SyncWithValidationInterfaceQueue();
+
+    bench.run([&] {
+        candidate.CreateNewBlock(P2WSH_OP_TRUE);
+    });
+
+    UnregisterValidationInterface(&candidate);
+    SyncWithValidationInterfaceQueue();
+}
+
 BENCHMARK(AssembleBlock);
+BENCHMARK(AssembleBlockChains);
+BENCHMARK(AssembleBlockIncremental);
@@ -0,0 +1,77 @@
+// Copyright (c) 2022 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <chain.h>
+#include <node/blockmap.h>
+#include <random.h>
+#include <uint256.h>
+
+#include <vector>
+
+static constexpr int NUM_BLOCKS{200000};
+
+/** Block hashes of a linear chain, and the order in which the block tree database returns them. */
+struct ChainData {
+    std::vector<uint256> hashes;
+    std::vector<int> load_order;
+
+    ChainData()
+    {
+        FastRandomContext rng{/*fDeterministic=*/true};
+        for (int i = 0; i < NUM_BLOCKS; ++i) {
+            hashes.push_back(rng.rand256());
+            load_order.push_back(i);
+        }
+        Shuffle(load_order.begin(), load_order.end(), rng);
+    }
+};
+
+/** Mirrors BlockManager::LoadBlockIndex: insert entries in hash order, link them, then build skip pointers by height. */
+static void LoadBlockMap(const ChainData& data, node::BlockMap& map)
+{
+    for (const int i : data.load_order) {
+        const auto [it, inserted]{map.try_emplace(data.hashes[i])};
+        CBlockIndex& index{it->second};
+        if (inserted) index.phashBlock = &it->first;
+        index.nHeight = i;
+        if (i > 0) {
+            const auto [prev, prev_inserted]{map.try_emplace(data.hashes[i - 1])};
+            if (prev_inserted) prev->second.phashBlock = &prev->first;
+            index.pprev = &prev->second;
+        }
+    }
+    map.ReorderByHeight();
+    for (auto& [_, index] : map) {
+        if (index.pprev) index.BuildSkip();
+    }
+}
+
+static void BlockMapLoad(benchmark::Bench& bench)
+{
+    const ChainData data;
+    bench.batch(NUM_BLOCKS).unit("block").run([&] {
+        node::BlockMap map;
+        LoadBlockMap(data, map);
+        ankerl::nanobench::doNotOptimizeAway(map.size());
+    });
+}
+
+/** A full pass over the block index, as done by InvalidateBlock and ResetBlockFailureFlags. */
+static void BlockMapIterate(benchmark::Bench& bench)
+{
+    const ChainData data;
+    node::BlockMap map;
+    LoadBlockMap(data, map);
+    bench.batch(NUM_BLOCKS).unit("block").run([&] {
+        int count{0};
+        for (const auto& [_, index] : map) {
+            if (index.pprev && index.pprev->nHeight < index.nHeight) ++count;
+        }
+        ankerl::nanobench::doNotOptimizeAway(count);
+    });
+}
+
+BENCHMARK(BlockMapLoad);
+BENCHMARK(BlockMapIterate);
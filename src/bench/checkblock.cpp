@@ -28,6 +28,21 @@ static void DeserializeBlockTest(benchmark::Bench& bench)
     });
 }
 
+/** Deserialize a block without hashing its transactions, e.g. to serve it to a peer or over RPC. */
+static void DeserializeBlockLazyHashTest(benchmark::Bench& bench)
+{
+    CDataStream stream(benchmark::data::block413567, SER_NETWORK, PROTOCOL_VERSION | SERIALIZE_TRANSACTION_LAZY_HASH);
+    std::byte a{0};
+    stream.write({&a, 1}); // Prevent compaction
+
+    bench.unit("block").run([&] {
+        CBlock block;
+        stream >> block;
+        bool rewound = stream.Rewind(benchmark::data::block413567.size());
+        assert(rewound);
+    });
+}
+
 static void DeserializeAndCheckBlockTest(benchmark::Bench& bench)
 {
     CDataStream stream(benchmark::data::block413567, SER_NETWORK, PROTOCOL_VERSION);
@@ -50,4 +65,5 @@ static void DeserializeAndCheckBlockTest(benchmark::Bench& bench)
 }
 
 BENCHMARK(DeserializeBlockTest);
+BENCHMARK(DeserializeBlockLazyHashTest);
 BENCHMARK(DeserializeAndCheckBlockTest);
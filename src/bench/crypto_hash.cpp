@@ -15,6 +15,9 @@
 #include <random.h>
 #include <uint256.h>
 
+#include <thread>
+#include <vector>
+
 /* Number of bytes to hash per iteration */
 static const uint64_t BUFFER_SIZE = 1000*1000;
 
@@ -72,6 +75,41 @@ static void SHA256D64_1024(benchmark::Bench& bench)
     });
 }
 
+/** Serialized sizes of 1000 transactions, about as in a typical block. */
+static std::vector<std::vector<uint8_t>> TxSizedMessages()
+{
+    FastRandomContext rng{/*fDeterministic=*/true};
+    std::vector<std::vector<uint8_t>> msgs(1000);
+    for (auto& msg : msgs) msg.resize(150 + rng.randrange(400));
+    return msgs;
+}
+
+static void SHA256D_1000_tx(benchmark::Bench& bench)
+{
+    const auto msgs{TxSizedMessages()};
+    std::vector<uint8_t> out(32 * msgs.size());
+    bench.batch(msgs.size()).unit("hash").run([&] {
+        for (size_t i = 0; i < msgs.size(); ++i) {
+            CHash256().Write(msgs[i]).Finalize({out.data() + 32 * i, 32});
+        }
+    });
+}
+
+static void SHA256DMulti_1000_tx(benchmark::Bench& bench)
+{
+    const auto msgs{TxSizedMessages()};
+    std::vector<const uint8_t*> inputs;
+    std::vector<size_t> lengths;
+    for (const auto& msg : msgs) {
+        inputs.push_back(msg.data());
+        lengths.push_back(msg.size());
+    }
+    std::vector<uint8_t> out(32 * msgs.size());
+    bench.batch(msgs.size()).unit("hash").run([&] {
+        SHA256DMulti(out.data(), inputs.data(), lengths.data(), msgs.size());
+    });
+}
+
 static void SHA512(benchmark::Bench& bench)
 {
     uint8_t hash[CSHA512::OUTPUT_SIZE];
@@ -106,6 +144,25 @@ static void FastRandom_1bit(benchmark::Bench& bench)
     });
 }
 
+/** Threads seeding FastRandomContexts at once, as net_processing and addrman do per peer and message. */
+static void FastRandom_Seed_4Threads(benchmark::Bench& bench)
+{
+    constexpr int N_THREADS{4};
+    constexpr int SEEDS_PER_THREAD{1000};
+    bench.batch(N_THREADS * SEEDS_PER_THREAD).unit("seed").run([&] {
+        std::vector<std::thread> threads;
+        for (int t = 0; t < N_THREADS; ++t) {
+            threads.emplace_back([] {
+                for (int i = 0; i < SEEDS_PER_THREAD; ++i) {
+                    FastRandomContext rng;
+                    ankerl::nanobench::doNotOptimizeAway(rng.rand64());
+                }
+            });
+        }
+        for (std::thread& thread : threads) thread.join();
+    });
+}
+
 static void MuHash(benchmark::Bench& bench)
 {
     MuHash3072 acc;
@@ -159,8 +216,11 @@ BENCHMARK(SHA3_256_1M);
 BENCHMARK(SHA256_32b);
 BENCHMARK(SipHash_32b);
 BENCHMARK(SHA256D64_1024);
+BENCHMARK(SHA256D_1000_tx);
+BENCHMARK(SHA256DMulti_1000_tx);
 BENCHMARK(FastRandom_32bit);
 BENCHMARK(FastRandom_1bit);
+BENCHMARK(FastRandom_Seed_4Threads);
 
 BENCHMARK(MuHash);
 BENCHMARK(MuHashMul);
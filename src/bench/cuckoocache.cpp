@@ -0,0 +1,86 @@
+// Copyright (c) 2022 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <cuckoocache.h>
+#include <random.h>
+#include <uint256.h>
+#include <util/hasher.h>
+
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+#include <vector>
+
+static constexpr int N_THREADS{4};
+static constexpr size_t OPS_PER_THREAD{10000};
+//! The default signature cache size, as set up by InitSignatureCache.
+static constexpr size_t CACHE_BYTES{16 << 20};
+
+/** The signature cache as it was guarded before concurrent_cache: a shared lock for lookups and an exclusive one for inserts. */
+class LockedCache
+{
+    CuckooCache::cache<uint256, SignatureCacheHasher> m_cache;
+    mutable std::shared_mutex m_mutex;
+
+public:
+    void setup_bytes(size_t bytes) { m_cache.setup_bytes(bytes); }
+    bool contains(const uint256& e, bool erase) const
+    {
+        std::shared_lock<std::shared_mutex> lock(m_mutex);
+        return m_cache.contains(e, erase);
+    }
+    void insert(const uint256& e)
+    {
+        std::unique_lock<std::shared_mutex> lock(m_mutex);
+        m_cache.insert(e);
+    }
+};
+
+/**
+ * Script check threads hitting the signature cache at once, as during mempool
+ * acceptance and block connection: each thread looks up a signature that is
+ * cached, and one that is not, which it then inserts.
+ */
+template <typename Cache>
+static void CuckooCacheContention(benchmark::Bench& bench)
+{
+    Cache cache;
+    cache.setup_bytes(CACHE_BYTES);
+    FastRandomContext rng{/*fDeterministic=*/true};
+    std::vector<uint256> cached;
+    for (size_t i = 0; i < N_THREADS * OPS_PER_THREAD; ++i) {
+        cached.push_back(rng.rand256());
+        cache.insert(cached.back());
+    }
+
+    bench.batch(N_THREADS * OPS_PER_THREAD).unit("signature").run([&] {
+        std::vector<std::thread> threads;
+        for (int t = 0; t < N_THREADS; ++t) {
+            threads.emplace_back([&, t, seed = rng.rand256()] {
+                // Every thread and iteration checks and inserts signatures not seen before.
+                FastRandomContext thread_rng{seed};
+                for (size_t i = t * OPS_PER_THREAD; i < (t + 1) * OPS_PER_THREAD; ++i) {
+                    cache.contains(cached[i], false);
+                    const uint256 fresh{thread_rng.rand256()};
+                    if (!cache.contains(fresh, false)) cache.insert(fresh);
+                }
+            });
+        }
+        for (std::thread& thread : threads) thread.join();
+    });
+}
+
+static void CuckooCacheLockedContention(benchmark::Bench& bench)
+{
+    CuckooCacheContention<LockedCache>(bench);
+}
+
+static void CuckooCacheConcurrentContention(benchmark::Bench& bench)
+{
+    CuckooCacheContention<CuckooCache::concurrent_cache<uint256, SignatureCacheHasher>>(bench);
+}
+
+BENCHMARK(CuckooCacheLockedContention);
+BENCHMARK(CuckooCacheConcurrentContention);
@@ -0,0 +1,68 @@
+// Copyright (c) 2022 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <chain.h>
+#include <chainparams.h>
+#include <node/blockstorage.h>
+#include <pow.h>
+#include <sync.h>
+#include <test/util/setup_common.h>
+#include <txdb.h>
+#include <validation.h>
+
+#include <memory>
+#include <vector>
+
+static constexpr int NUM_HEADERS{50000};
+
+/** Write a chain of NUM_HEADERS valid regtest headers, with a fork every 1000 blocks, to an in-memory block tree db. */
+static std::unique_ptr<CBlockTreeDB> CreateBlockTreeDB()
+{
+    const Consensus::Params& params{Params().GetConsensus()};
+    auto block_tree_db{std::make_unique<CBlockTreeDB>(/*nCacheSize=*/1 << 20, /*fMemory=*/true)};
+
+    node::BlockMap map;
+    std::vector<const CBlockIndex*> entries;
+    const CBlockIndex* tip{nullptr};
+    for (int i = 0; i < NUM_HEADERS; ++i) {
+        CBlockHeader header;
+        header.nVersion = 4;
+        header.hashPrevBlock = tip ? tip->GetBlockHash() : uint256{};
+        header.nTime = 1600000000 + i * 600;
+        header.nBits = UintToArith256(params.powLimit).GetCompact();
+        while (!CheckProofOfWork(header.GetHash(), header.nBits, params)) ++header.nNonce;
+
+        const auto [it, inserted]{map.try_emplace(header.GetHash(), header)};
+        CBlockIndex& index{it->second};
+        index.phashBlock = &it->first;
+        index.pprev = const_cast<CBlockIndex*>(tip);
+        index.nHeight = tip ? tip->nHeight + 1 : 0;
+        index.nTx = 1;
+        WITH_LOCK(::cs_main, index.nStatus = BLOCK_VALID_TRANSACTIONS | BLOCK_HAVE_DATA);
+        entries.push_back(&index);
+        // Every 1000th block is a stale fork; the next block builds on its parent.
+        if (i % 1000 != 999) tip = &index;
+    }
+    WITH_LOCK(::cs_main, assert(block_tree_db->WriteBatchSync({}, /*nLastFile=*/0, entries)));
+    return block_tree_db;
+}
+
+/** Load the block index from the block tree db, as done on startup by BlockManager::LoadBlockIndexDB. */
+static void LoadBlockIndex(benchmark::Bench& bench)
+{
+    const auto testing_setup{MakeNoLogFileContext<const BasicTestingSetup>(CBaseChainParams::REGTEST)};
+    node::BlockManager blockman;
+    LOCK(::cs_main);
+    blockman.m_block_tree_db = CreateBlockTreeDB();
+
+    bench.batch(NUM_HEADERS).unit("header").run([&] {
+        assert(blockman.LoadBlockIndex(Params().GetConsensus()));
+        assert(blockman.m_block_index.size() == NUM_HEADERS);
+        pindexBestHeader = nullptr;
+        blockman.Unload();
+    });
+}
+
+BENCHMARK(LoadBlockIndex);
@@ -0,0 +1,232 @@
+// Copyright (c) 2022 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <coins.h>
+#include <consensus/validation.h>
+#include <key.h>
+#include <script/sign.h>
+#include <script/signingprovider.h>
+#include <script/standard.h>
+#include <test/util/mining.h>
+#include <test/util/script.h>
+#include <test/util/setup_common.h>
+#include <txmempool.h>
+#include <validation.h>
+
+#include <map>
+#include <vector>
+
+static constexpr size_t BATCH_SIZE{100};
+static constexpr size_t NUM_BATCHES{10};
+static constexpr size_t INPUTS_PER_TX{2};
+static constexpr size_t OUTPUTS_PER_FAN_OUT{1000};
+
+/**
+ * Mine blocks and confirm num_outputs outputs of 4 * CENT paying to script,
+ * created by fan-out transactions spending the mature coinbases.
+ */
+static std::vector<COutPoint> CreateConfirmedOutputs(const TestingSetup& test_setup, const CScript& script, size_t num_outputs)
+{
+    const size_t num_fan_outs{(num_outputs + OUTPUTS_PER_FAN_OUT - 1) / OUTPUTS_PER_FAN_OUT};
+    std::vector<CTxIn> coinbases;
+    for (size_t i{0}; i < COINBASE_MATURITY + num_fan_outs; ++i) {
+        coinbases.push_back(MineBlock(test_setup.m_node, P2WSH_OP_TRUE));
+    }
+
+    std::vector<COutPoint> outpoints;
+    for (size_t i{0}; i < num_fan_outs; ++i) {
+        CMutableTransaction fan_out;
+        fan_out.vin.push_back(coinbases[i]);
+        fan_out.vin.back().scriptWitness.stack.push_back(WITNESS_STACK_ELEM_OP_TRUE);
+        fan_out.vout.assign(OUTPUTS_PER_FAN_OUT, CTxOut{4 * CENT, script});
+        const CTransactionRef fan_out_tx{MakeTransactionRef(fan_out)};
+        const MempoolAcceptResult res{WITH_LOCK(::cs_main, return test_setup.m_node.chainman->ProcessTransaction(fan_out_tx))};
+        assert(res.m_result_type == MempoolAcceptResult::ResultType::VALID);
+        for (uint32_t n{0}; n < OUTPUTS_PER_FAN_OUT; ++n) {
+            outpoints.emplace_back(fan_out_tx->GetHash(), n);
+        }
+    }
+    MineBlock(test_setup.m_node, P2WSH_OP_TRUE);
+    return outpoints;
+}
+
+/**
+ * Create batches of independent transactions, each spending P2WPKH outputs
+ * confirmed in the chain, so that accepting them verifies signatures that are
+ * not in the signature cache yet.
+ */
+static std::vector<std::vector<CTransactionRef>> CreateBatches(const TestingSetup& test_setup)
+{
+    CKey key;
+    key.MakeNewKey(true);
+    const CScript script{GetScriptForDestination(WitnessV0KeyHash(key.GetPubKey()))};
+    FillableSigningProvider keystore;
+    keystore.AddKey(key);
+    const Coin coin{CTxOut{4 * CENT, script}, /*nHeightIn=*/1, /*fCoinBaseIn=*/false};
+
+    const std::vector<COutPoint> outpoints{CreateConfirmedOutputs(test_setup, script, BATCH_SIZE * NUM_BATCHES * INPUTS_PER_TX)};
+    std::vector<std::vector<CTransactionRef>> batches(NUM_BATCHES);
+    auto outpoint{outpoints.begin()};
+    for (auto& batch : batches) {
+        for (size_t i{0}; i < BATCH_SIZE; ++i) {
+            CMutableTransaction tx;
+            std::map<COutPoint, Coin> input_coins;
+            for (size_t j{0}; j < INPUTS_PER_TX; ++j, ++outpoint) {
+                tx.vin.emplace_back(*outpoint);
+                input_coins.emplace(*outpoint, coin);
+            }
+            tx.vout.emplace_back(INPUTS_PER_TX * 4 * CENT - 1000, script);
+            std::map<int, bilingual_str> input_errors;
+            const bool complete{SignTransaction(tx, &keystore, input_coins, SIGHASH_ALL, input_errors)};
+            assert(complete);
+            batch.push_back(MakeTransactionRef(tx));
+        }
+    }
+    return batches;
+}
+
+/**
+ * Create batches of chains of DEFAULT_ANCESTOR_LIMIT transactions spending
+ * P2WSH OP_TRUE outputs, each child spending its parent and a confirmed output.
+ * Without signatures to verify, accepting them is dominated by looking up
+ * coins and mempool ancestors.
+ */
+static std::vector<std::vector<CTransactionRef>> CreateChainBatches(const TestingSetup& test_setup)
+{
+    const std::vector<COutPoint> confirmed{CreateConfirmedOutputs(test_setup, P2WSH_OP_TRUE, BATCH_SIZE * NUM_BATCHES)};
+    std::vector<std::vector<CTransactionRef>> batches(NUM_BATCHES);
+    auto outpoint{confirmed.begin()};
+    CTransactionRef parent;
+    size_t chain_length{0};
+    for (auto& batch : batches) {
+        for (size_t i{0}; i < BATCH_SIZE; ++i, ++outpoint) {
+            CMutableTransaction tx;
+            CAmount value{4 * CENT};
+            if (parent && chain_length < DEFAULT_ANCESTOR_LIMIT) {
+                tx.vin.emplace_back(parent->GetHash(), 0);
+                value += parent->vout[0].nValue;
+                ++chain_length;
+            } else {
+                chain_length = 1;
+            }
+            tx.vin.emplace_back(*outpoint);
+            for (CTxIn& txin : tx.vin) {
+                txin.scriptWitness.stack.push_back(WITNESS_STACK_ELEM_OP_TRUE);
+            }
+            tx.vout.emplace_back(value - 1000, P2WSH_OP_TRUE);
+            parent = MakeTransactionRef(tx);
+            batch.push_back(parent);
+        }
+    }
+    return batches;
+}
+
+static void MempoolAcceptSerial(benchmark::Bench& bench)
+{
+    const auto test_setup = MakeNoLogFileContext<const TestingSetup>();
+    const auto batches{CreateBatches(*test_setup)};
+
+    auto batch{batches.begin()};
+    bench.epochs(1).epochIterations(NUM_BATCHES).batch(BATCH_SIZE).unit("tx").run([&] {
+        LOCK(::cs_main);
+        CChainState& chainstate{test_setup->m_node.chainman->ActiveChainstate()};
+        for (const CTransactionRef& tx : *batch) {
+            const MempoolAcceptResult res{AcceptToMemoryPool(chainstate, tx, GetTime(), /*bypass_limits=*/false, /*test_accept=*/false)};
+            assert(res.m_result_type == MempoolAcceptResult::ResultType::VALID);
+        }
+        // ProcessTransactions() checks the mempool once per batch.
+        test_setup->m_node.mempool->check(chainstate.CoinsTip(), chainstate.m_chain.Height() + 1);
+        ++batch;
+    });
+}
+
+static void MempoolAcceptBatch(benchmark::Bench& bench)
+{
+    const auto test_setup = MakeNoLogFileContext<const TestingSetup>();
+    const auto batches{CreateBatches(*test_setup)};
+
+    auto batch{batches.begin()};
+    bench.epochs(1).epochIterations(NUM_BATCHES).batch(BATCH_SIZE).unit("tx").run([&] {
+        for (const MempoolAcceptResult& res : test_setup->m_node.chainman->ProcessTransactions(*batch)) {
+            assert(res.m_result_type == MempoolAcceptResult::ResultType::VALID);
+        }
+        ++batch;
+    });
+}
+
+static void MempoolAcceptChains(benchmark::Bench& bench)
+{
+    const auto test_setup = MakeNoLogFileContext<const TestingSetup>();
+    const auto batches{CreateChainBatches(*test_setup)};
+
+    auto batch{batches.begin()};
+    bench.epochs(1).epochIterations(NUM_BATCHES).batch(BATCH_SIZE).unit("tx").run([&] {
+        LOCK(::cs_main);
+        CChainState& chainstate{test_setup->m_node.chainman->ActiveChainstate()};
+        for (const CTransactionRef& tx : *batch) {
+            const MempoolAcceptResult res{AcceptToMemoryPool(chainstate, tx, GetTime(), /*bypass_limits=*/false, /*test_accept=*/false)};
+            assert(res.m_result_type == MempoolAcceptResult::ResultType::VALID);
+        }
+        ++batch;
+    });
+}
+
+static void MempoolReorg(benchmark::Bench& bench)
+{
+    const auto test_setup = MakeNoLogFileContext<const TestingSetup>();
+    for (const auto& batch : CreateBatches(*test_setup)) {
+        for (const MempoolAcceptResult& res : test_setup->m_node.chainman->ProcessTransactions(batch)) {
+            assert(res.m_result_type == MempoolAcceptResult::ResultType::VALID);
+        }
+    }
+    MineBlock(test_setup->m_node, P2WSH_OP_TRUE);
+    assert(test_setup->m_node.mempool->size() == 0);
+
+    // Disconnecting the block puts its transactions back into the mempool.
+    CChainState& chainstate{test_setup->m_node.chainman->ActiveChainstate()};
+    CBlockIndex* tip{WITH_LOCK(::cs_main, return chainstate.m_chain.Tip())};
+    bench.epochs(1).epochIterations(1).batch(NUM_BATCHES * BATCH_SIZE).unit("tx").run([&] {
+        BlockValidationState state;
+        const bool invalidated{chainstate.InvalidateBlock(state, tip)};
+        assert(invalidated);
+        assert(test_setup->m_node.mempool->size() == NUM_BATCHES * BATCH_SIZE);
+    });
+}
+
+static void MempoolLoad(benchmark::Bench& bench)
+{
+    const auto test_setup = MakeNoLogFileContext<const TestingSetup>();
+    const auto batches{CreateBatches(*test_setup)};
+    {
+        // Dump the transactions from a mempool that did not check them, so
+        // that loading verifies signatures that are not in the signature
+        // cache yet.
+        CTxMemPool pool;
+        {
+            LOCK2(::cs_main, pool.cs);
+            LockPoints lp;
+            for (const auto& batch : batches) {
+                for (const CTransactionRef& tx : batch) {
+                    pool.addUnchecked(CTxMemPoolEntry(tx, /*fee=*/1000, GetTime(), /*entry_height=*/1, /*spends_coinbase=*/false, /*sigops_cost=*/4, lp));
+                }
+            }
+        }
+        const bool dumped{DumpMempool(pool, fsbridge::fopen, /*skip_file_commit=*/true)};
+        assert(dumped);
+    }
+
+    CChainState& chainstate{test_setup->m_node.chainman->ActiveChainstate()};
+    bench.epochs(1).epochIterations(1).batch(NUM_BATCHES * BATCH_SIZE).unit("tx").run([&] {
+        const bool loaded{LoadMempool(*test_setup->m_node.mempool, chainstate)};
+        assert(loaded);
+        assert(test_setup->m_node.mempool->size() == NUM_BATCHES * BATCH_SIZE);
+    });
+}
+
+BENCHMARK(MempoolAcceptSerial);
+BENCHMARK(MempoolAcceptBatch);
+BENCHMARK(MempoolAcceptChains);
+BENCHMARK(MempoolLoad);
+BENCHMARK(MempoolReorg);
@@ -115,5 +115,27 @@ static void MempoolCheck(benchmark::Bench& bench)
     });
 }
 
+static void MempoolClusterLinearize(benchmark::Bench& bench)
+{
+    FastRandomContext det_rand{true};
+    const int childTxs = bench.complexityN() > 1 ? static_cast<int>(bench.complexityN()) : 800;
+    const std::vector<CTransactionRef> ordered_coins = CreateOrderedCoins(det_rand, childTxs, /* min_ancestors */ 1);
+    const auto testing_setup = MakeNoLogFileContext<const TestingSetup>(CBaseChainParams::MAIN);
+    CTxMemPool pool;
+    LOCK2(cs_main, pool.cs);
+    for (auto& tx : ordered_coins) AddTx(tx, pool);
+    const uint256& root = ordered_coins.front()->GetHash();
+    const CTxMemPool::txiter root_it = *pool.GetIter(root);
+
+    // Changing a fee delta invalidates the cluster, so every iteration linearizes it again.
+    CAmount delta{1};
+    bench.run([&]() NO_THREAD_SAFETY_ANALYSIS {
+        pool.PrioritiseTransaction(root, delta);
+        delta = -delta;
+        ankerl::nanobench::doNotOptimizeAway(pool.GetCluster(root_it));
+    });
+}
+
 BENCHMARK(ComplexMemPool);
 BENCHMARK(MempoolCheck);
+BENCHMARK(MempoolClusterLinearize);
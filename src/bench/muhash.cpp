@@ -0,0 +1,80 @@
+// Copyright (c) 2022 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <coins.h>
+#include <crypto/common.h>
+#include <crypto/muhash.h>
+#include <primitives/transaction.h>
+#include <script/script.h>
+#include <span.h>
+#include <streams.h>
+#include <uint256.h>
+#include <version.h>
+
+#include <thread>
+#include <vector>
+
+static constexpr int NUM_COINS{1000000};
+static constexpr int N_SHARDS{4};
+static constexpr int BATCH_SIZE{1000};
+
+/** Serialize the i-th coin of a UTXO set of P2WPKH outputs, the way coinstats feeds coins to MuHash. */
+static void SerializeCoin(CDataStream& ss, int i)
+{
+    uint256 txid;
+    WriteLE32(txid.begin(), i);
+    const Coin coin{CTxOut{i, CScript() << OP_0 << std::vector<unsigned char>(20, i & 0xff)}, /*nHeightIn=*/i / 2000, /*fCoinBaseIn=*/false};
+    ss.clear();
+    ss << COutPoint{txid, uint32_t(i % 3)};
+    ss << uint32_t(coin.nHeight * 2 + coin.fCoinBase);
+    ss << coin.out;
+}
+
+/** Hash every coin into a single MuHash3072, as gettxoutsetinfo does. */
+static void MuHashMillionCoins(benchmark::Bench& bench)
+{
+    bench.epochs(1).batch(NUM_COINS).unit("coin").run([&] {
+        MuHash3072 acc;
+        CDataStream ss{SER_DISK, PROTOCOL_VERSION};
+        for (int i = 0; i < NUM_COINS; ++i) {
+            SerializeCoin(ss, i);
+            acc.Insert(MakeUCharSpan(ss));
+        }
+        uint256 out;
+        acc.Finalize(out);
+        ankerl::nanobench::doNotOptimizeAway(out);
+    });
+}
+
+/** Split the coins into shards, each hashed on its own thread in batches, and combine the results. */
+static void MuHashMillionCoinsSharded(benchmark::Bench& bench)
+{
+    bench.epochs(1).batch(NUM_COINS).unit("coin").run([&] {
+        std::vector<MuHash3072> shards(N_SHARDS);
+        std::vector<std::thread> threads;
+        for (int s = 0; s < N_SHARDS; ++s) {
+            threads.emplace_back([&, s] {
+                std::vector<CDataStream> batch(BATCH_SIZE, CDataStream{SER_DISK, PROTOCOL_VERSION});
+                std::vector<Span<const unsigned char>> spans(BATCH_SIZE);
+                for (int begin = s * (NUM_COINS / N_SHARDS); begin < (s + 1) * (NUM_COINS / N_SHARDS); begin += BATCH_SIZE) {
+                    for (int j = 0; j < BATCH_SIZE; ++j) {
+                        SerializeCoin(batch[j], begin + j);
+                        spans[j] = MakeUCharSpan(batch[j]);
+                    }
+                    shards[s].InsertBatch(spans);
+                }
+            });
+        }
+        for (std::thread& thread : threads) thread.join();
+        MuHash3072 acc;
+        for (const MuHash3072& shard : shards) acc *= shard;
+        uint256 out;
+        acc.Finalize(out);
+        ankerl::nanobench::doNotOptimizeAway(out);
+    });
+}
+
+BENCHMARK(MuHashMillionCoins);
+BENCHMARK(MuHashMillionCoinsSharded);
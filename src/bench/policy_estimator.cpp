@@ -0,0 +1,73 @@
+// Copyright (c) 2022 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <policy/fees.h>
+#include <test/util/setup_common.h>
+#include <txmempool.h>
+
+#include <vector>
+
+static constexpr int NUM_BLOCKS{200};
+static constexpr int NUM_FEERATES{10};
+static constexpr int TXS_PER_FEERATE{4};
+static constexpr int MAX_TARGET{48};
+
+/**
+ * Feed the estimator NUM_BLOCKS blocks of transactions at NUM_FEERATES
+ * feerates, where higher feerate transactions are mined sooner. Some low
+ * feerate transactions are left unconfirmed in the mempool.
+ */
+static void FillEstimator(CTxMemPool& pool) EXCLUSIVE_LOCKS_REQUIRED(cs_main, pool.cs)
+{
+    TestMemPoolEntryHelper entry;
+    CMutableTransaction tx;
+    tx.vin.resize(1);
+    tx.vout.resize(1);
+    std::vector<CTransactionRef> unconfirmed[NUM_FEERATES];
+    for (int height{0}; height < NUM_BLOCKS;) {
+        for (int j{0}; j < NUM_FEERATES; ++j) {
+            for (int k{0}; k < TXS_PER_FEERATE; ++k) {
+                tx.vin[0].prevout.n = 10000 * height + 100 * j + k;
+                const CTransactionRef ptx{MakeTransactionRef(tx)};
+                pool.addUnchecked(entry.Fee(2000 * (j + 1)).Height(height).FromTx(ptx));
+                unconfirmed[j].push_back(ptx);
+            }
+        }
+        std::vector<CTransactionRef> block;
+        for (int j{NUM_FEERATES - 1 - height % NUM_FEERATES}; j < NUM_FEERATES; ++j) {
+            block.insert(block.end(), unconfirmed[j].begin(), unconfirmed[j].end());
+            unconfirmed[j].clear();
+        }
+        pool.removeForBlock(block, ++height);
+    }
+}
+
+static void EstimateSmartFee(benchmark::Bench& bench)
+{
+    const auto testing_setup = MakeNoLogFileContext<>();
+    CBlockPolicyEstimator fee_estimator;
+    CTxMemPool pool{&fee_estimator};
+    {
+        LOCK2(cs_main, pool.cs);
+        FillEstimator(pool);
+    }
+
+    // Cycle through targets and modes, as callers do between blocks. Only the
+    // first call for each target and mode after a block calculates an estimate.
+    int target{1};
+    bool conservative{false};
+    const auto estimate{[&] {
+        FeeCalculation fee_calc;
+        fee_estimator.estimateSmartFee(target, &fee_calc, conservative);
+        if (++target > MAX_TARGET) {
+            target = 1;
+            conservative = !conservative;
+        }
+    }};
+    for (int i{0}; i < 2 * MAX_TARGET; ++i) estimate();
+    bench.run(estimate);
+}
+
+BENCHMARK(EstimateSmartFee);
@@ -4,7 +4,10 @@
 
 #include <bench/bench.h>
 #include <rpc/mempool.h>
+#include <streams.h>
 #include <txmempool.h>
+#include <util/strencodings.h>
+#include <version.h>
 
 #include <univalue.h>
 
@@ -15,11 +18,8 @@ static void AddTx(const CTransactionRef& tx, const CAmount& fee, CTxMemPool& poo
     pool.addUnchecked(CTxMemPoolEntry(tx, fee, /*time=*/0, /*entry_height=*/1, /*spends_coinbase=*/false, /*sigops_cost=*/4, lp));
 }
 
-static void RpcMempool(benchmark::Bench& bench)
+static void FillMempool(CTxMemPool& pool) EXCLUSIVE_LOCKS_REQUIRED(cs_main, pool.cs)
 {
-    CTxMemPool pool;
-    LOCK2(cs_main, pool.cs);
-
     for (int i = 0; i < 1000; ++i) {
         CMutableTransaction tx = CMutableTransaction();
         tx.vin.resize(1);
@@ -31,10 +31,31 @@ static void RpcMempool(benchmark::Bench& bench)
         const CTransactionRef tx_r{MakeTransactionRef(tx)};
         AddTx(tx_r, /* fee */ i, pool);
     }
+}
+
+static void RpcMempool(benchmark::Bench& bench)
+{
+    CTxMemPool pool;
+    LOCK2(cs_main, pool.cs);
+    FillMempool(pool);
 
     bench.run([&] {
         (void)MempoolToJSON(pool, /*verbose*/ true);
     });
 }
 
+static void RpcMempoolSnapshot(benchmark::Bench& bench)
+{
+    CTxMemPool pool;
+    LOCK2(cs_main, pool.cs);
+    FillMempool(pool);
+
+    bench.run([&] {
+        CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+        ss << *pool.GetSnapshot();
+        (void)HexStr(ss);
+    });
+}
+
 BENCHMARK(RpcMempool);
+BENCHMARK(RpcMempoolSnapshot);
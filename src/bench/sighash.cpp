@@ -0,0 +1,54 @@
+// Copyright (c) 2022 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <primitives/transaction.h>
+#include <random.h>
+#include <script/interpreter.h>
+#include <script/script.h>
+#include <uint256.h>
+
+static constexpr size_t NUM_INPUTS{1000};
+
+/** A consolidation of NUM_INPUTS legacy P2PKH outputs, about 150 kB once signed. */
+static CMutableTransaction CreateLargeLegacyTransaction()
+{
+    FastRandomContext rng{/*fDeterministic=*/true};
+    CMutableTransaction tx;
+    for (size_t i = 0; i < NUM_INPUTS; ++i) {
+        tx.vin.emplace_back(COutPoint{rng.rand256(), 0});
+        // A DER signature and a compressed pubkey
+        tx.vin.back().scriptSig << rng.randbytes(72) << rng.randbytes(33);
+    }
+    tx.vout.emplace_back(1000, CScript() << OP_DUP << OP_HASH160 << rng.randbytes(20) << OP_EQUALVERIFY << OP_CHECKSIG);
+    return tx;
+}
+
+/** Compute the SIGHASH_ALL signature hash of every input, as validation of the transaction does. */
+static void LegacySighashLargeTx(benchmark::Bench& bench, bool precompute)
+{
+    const CTransaction tx{CreateLargeLegacyTransaction()};
+    const CScript script_code{CScript() << OP_DUP << OP_HASH160 << std::vector<unsigned char>(20) << OP_EQUALVERIFY << OP_CHECKSIG};
+    bench.batch(NUM_INPUTS).unit("input").run([&] {
+        PrecomputedTransactionData txdata;
+        if (precompute) txdata.Init(tx, {});
+        for (size_t i = 0; i < NUM_INPUTS; ++i) {
+            const uint256 hash{SignatureHash(script_code, tx, i, SIGHASH_ALL, 0, SigVersion::BASE, &txdata)};
+            ankerl::nanobench::doNotOptimizeAway(hash);
+        }
+    });
+}
+
+static void LegacySighashLargeTxGeneric(benchmark::Bench& bench)
+{
+    LegacySighashLargeTx(bench, /*precompute=*/false);
+}
+
+static void LegacySighashLargeTxPrecomputed(benchmark::Bench& bench)
+{
+    LegacySighashLargeTx(bench, /*precompute=*/true);
+}
+
+BENCHMARK(LegacySighashLargeTxGeneric);
+BENCHMARK(LegacySighashLargeTxPrecomputed);
@@ -7,12 +7,14 @@
 #if defined(HAVE_CONSENSUS_LIB)
 #include <script/bitcoinconsensus.h>
 #endif
+#include <script/interpreter.h>
 #include <script/script.h>
 #include <script/standard.h>
 #include <streams.h>
 #include <test/util/transaction_utils.h>
 
 #include <array>
+#include <vector>
 
 // Microbenchmark for verification of a basic P2WPKH script. Can be easily
 // modified to measure performance of other types of scripts.
@@ -75,6 +77,87 @@ static void VerifyScriptBench(benchmark::Bench& bench)
     ECC_Stop();
 }
 
+// Verification of a 2-of-3 P2WSH multisig spend.
+static void VerifyMultisigScript(benchmark::Bench& bench)
+{
+    const ECCVerifyHandle verify_handle;
+    ECC_Start();
+
+    const uint32_t flags{SCRIPT_VERIFY_WITNESS | SCRIPT_VERIFY_P2SH | SCRIPT_VERIFY_NULLDUMMY | SCRIPT_VERIFY_NULLFAIL};
+    std::vector<CKey> keys(3);
+    for (CKey& key : keys) key.MakeNewKey(/*fCompressed=*/true);
+    const CScript witness_script{GetScriptForMultisig(2, {keys[0].GetPubKey(), keys[1].GetPubKey(), keys[2].GetPubKey()})};
+
+    const CMutableTransaction tx_credit{BuildCreditingTransaction(GetScriptForDestination(WitnessV0ScriptHash(witness_script)), 1)};
+    CMutableTransaction tx_spend{BuildSpendingTransaction(CScript(), CScriptWitness(), CTransaction(tx_credit))};
+    const uint256 sighash{SignatureHash(witness_script, tx_spend, 0, SIGHASH_ALL, tx_credit.vout[0].nValue, SigVersion::WITNESS_V0)};
+    CScriptWitness& witness{tx_spend.vin[0].scriptWitness};
+    witness.stack.emplace_back();
+    for (int i : {0, 2}) {
+        witness.stack.emplace_back();
+        keys[i].Sign(sighash, witness.stack.back());
+        witness.stack.back().push_back(static_cast<unsigned char>(SIGHASH_ALL));
+    }
+    witness.stack.emplace_back(witness_script.begin(), witness_script.end());
+
+    bench.run([&] {
+        ScriptError err;
+        const bool success{VerifyScript(tx_spend.vin[0].scriptSig, tx_credit.vout[0].scriptPubKey, &witness, flags,
+                                        MutableTransactionSignatureChecker(&tx_spend, 0, tx_credit.vout[0].nValue, MissingDataBehavior::ASSERT_FAIL),
+                                        &err)};
+        assert(err == SCRIPT_ERR_OK);
+        assert(success);
+    });
+    ECC_Stop();
+}
+
+// Verification of a taproot script path spend of a single-key tapscript.
+static void VerifyTapscript(benchmark::Bench& bench)
+{
+    const ECCVerifyHandle verify_handle;
+    ECC_Start();
+
+    const uint32_t flags{SCRIPT_VERIFY_WITNESS | SCRIPT_VERIFY_P2SH | SCRIPT_VERIFY_TAPROOT};
+    CKey internal_key, key;
+    internal_key.MakeNewKey(/*fCompressed=*/true);
+    key.MakeNewKey(/*fCompressed=*/true);
+    const CScript tapscript{CScript() << ToByteVector(XOnlyPubKey{key.GetPubKey()}) << OP_CHECKSIG};
+    TaprootBuilder builder;
+    builder.Add(/*depth=*/0, tapscript, TAPROOT_LEAF_TAPSCRIPT).Finalize(XOnlyPubKey{internal_key.GetPubKey()});
+    const TaprootSpendData spend_data{builder.GetSpendData()};
+
+    const CMutableTransaction tx_credit{BuildCreditingTransaction(GetScriptForDestination(builder.GetOutput()), 1)};
+    CMutableTransaction tx_spend{BuildSpendingTransaction(CScript(), CScriptWitness(), CTransaction(tx_credit))};
+    PrecomputedTransactionData txdata;
+    txdata.Init(tx_spend, {tx_credit.vout[0]}, /*force=*/true);
+
+    ScriptExecutionData execdata;
+    execdata.m_annex_init = true;
+    execdata.m_annex_present = false;
+    execdata.m_tapleaf_hash_init = true;
+    execdata.m_tapleaf_hash = ComputeTapleafHash(TAPROOT_LEAF_TAPSCRIPT, tapscript);
+    execdata.m_codeseparator_pos_init = true;
+    execdata.m_codeseparator_pos = 0xFFFFFFFF;
+    uint256 sighash;
+    assert(SignatureHashSchnorr(sighash, execdata, tx_spend, 0, SIGHASH_DEFAULT, SigVersion::TAPSCRIPT, txdata, MissingDataBehavior::ASSERT_FAIL));
+
+    CScriptWitness& witness{tx_spend.vin[0].scriptWitness};
+    witness.stack.emplace_back(64);
+    assert(key.SignSchnorr(sighash, witness.stack.back(), /*merkle_root=*/nullptr, /*aux=*/uint256{}));
+    witness.stack.emplace_back(tapscript.begin(), tapscript.end());
+    witness.stack.push_back(*spend_data.scripts.at({tapscript, TAPROOT_LEAF_TAPSCRIPT}).begin());
+
+    bench.run([&] {
+        ScriptError err;
+        const bool success{VerifyScript(tx_spend.vin[0].scriptSig, tx_credit.vout[0].scriptPubKey, &witness, flags,
+                                        MutableTransactionSignatureChecker(&tx_spend, 0, tx_credit.vout[0].nValue, txdata, MissingDataBehavior::ASSERT_FAIL),
+                                        &err)};
+        assert(err == SCRIPT_ERR_OK);
+        assert(success);
+    });
+    ECC_Stop();
+}
+
 static void VerifyNestedIfScript(benchmark::Bench& bench)
 {
     std::vector<std::vector<unsigned char>> stack;
@@ -96,5 +179,26 @@ static void VerifyNestedIfScript(benchmark::Bench& bench)
     });
 }
 
+// A script that only hashes, copies and compares stack elements, so that its
+// cost is dominated by the interpreter's stack handling rather than by
+// signature checks.
+static void VerifyStackOpsScript(benchmark::Bench& bench)
+{
+    CScript script;
+    script << std::vector<unsigned char>(32, 0x42);
+    for (int i = 0; i < MAX_OPS_PER_SCRIPT / 4; ++i) {
+        script << OP_SHA256 << OP_DUP << OP_DUP << OP_EQUALVERIFY;
+    }
+    bench.run([&] {
+        std::vector<std::vector<unsigned char>> stack;
+        ScriptError error;
+        bool ret = EvalScript(stack, script, 0, BaseSignatureChecker(), SigVersion::BASE, &error);
+        assert(ret);
+    });
+}
+
 BENCHMARK(VerifyScriptBench);
+BENCHMARK(VerifyMultisigScript);
+BENCHMARK(VerifyTapscript);
 BENCHMARK(VerifyNestedIfScript);
+BENCHMARK(VerifyStackOpsScript);
@@ -0,0 +1,95 @@
+// Copyright (c) 2022 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <primitives/transaction.h>
+#include <script/script.h>
+#include <test/util/setup_common.h>
+#include <util/system.h>
+#include <validationinterface.h>
+#include <zmq/zmqnotificationinterface.h>
+
+#include <zmq.h>
+
+#include <cassert>
+#include <memory>
+#include <string>
+#include <vector>
+
+static constexpr int NUM_TXS{1000};
+static const std::string ZMQ_BENCH_ADDRESS{"tcp://127.0.0.1:28389"};
+
+/** Receive the parts of one message, returns false on timeout. */
+static bool ReceiveMessage(void* socket)
+{
+    int more{0};
+    do {
+        zmq_msg_t msg;
+        zmq_msg_init(&msg);
+        if (zmq_msg_recv(&msg, socket, 0) == -1) {
+            zmq_msg_close(&msg);
+            return false;
+        }
+        more = zmq_msg_more(&msg);
+        zmq_msg_close(&msg);
+    } while (more);
+    return true;
+}
+
+/**
+ * End-to-end latency of rawtx notifications for a flood of transactions
+ * entering the mempool: from the validation interface signals to a subscriber
+ * receiving all messages.
+ */
+static void ZmqRawTxFlood(benchmark::Bench& bench)
+{
+    const auto testing_setup = MakeNoLogFileContext<const TestingSetup>();
+    gArgs.ForceSetArg("-zmqpubrawtx", ZMQ_BENCH_ADDRESS);
+    gArgs.ForceSetArg("-zmqpubrawtxhwm", "0");
+    std::unique_ptr<CZMQNotificationInterface> notification_interface{CZMQNotificationInterface::Create()};
+    assert(notification_interface);
+    RegisterValidationInterface(notification_interface.get());
+
+    void* context{zmq_ctx_new()};
+    void* socket{zmq_socket(context, ZMQ_SUB)};
+    const int unlimited{0};
+    const int timeout_ms{100};
+    zmq_setsockopt(socket, ZMQ_RCVHWM, &unlimited, sizeof(unlimited));
+    zmq_setsockopt(socket, ZMQ_RCVTIMEO, &timeout_ms, sizeof(timeout_ms));
+    zmq_setsockopt(socket, ZMQ_SUBSCRIBE, "rawtx", 5);
+    zmq_connect(socket, ZMQ_BENCH_ADDRESS.c_str());
+
+    std::vector<CTransactionRef> txs;
+    for (int i{0}; i < NUM_TXS; ++i) {
+        CMutableTransaction tx;
+        tx.vin.emplace_back(COutPoint{uint256::ONE, static_cast<uint32_t>(i)});
+        tx.vout.emplace_back(i, CScript{} << OP_TRUE);
+        txs.push_back(MakeTransactionRef(tx));
+    }
+
+    // Wait for the subscription to reach the publisher, earlier messages are lost.
+    uint64_t mempool_sequence{0};
+    do {
+        GetMainSignals().TransactionAddedToMempool(txs.front(), ++mempool_sequence);
+    } while (!ReceiveMessage(socket));
+    SyncWithValidationInterfaceQueue();
+    while (ReceiveMessage(socket)) {}
+
+    bench.batch(NUM_TXS).unit("tx").run([&] {
+        for (const CTransactionRef& tx : txs) {
+            GetMainSignals().TransactionAddedToMempool(tx, ++mempool_sequence);
+        }
+        for (int i{0}; i < NUM_TXS; ++i) {
+            const bool received{ReceiveMessage(socket)};
+            assert(received);
+        }
+    });
+
+    zmq_close(socket);
+    zmq_ctx_term(context);
+    UnregisterValidationInterface(notification_interface.get());
+    SyncWithValidationInterfaceQueue();
+}
+
+BENCHMARK(ZmqRawTxFlood);
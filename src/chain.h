@@ -393,7 +393,8 @@ public:
         if (obj.nStatus & BLOCK_HAVE_DATA) READWRITE(VARINT(obj.nDataPos));
         if (obj.nStatus & BLOCK_HAVE_UNDO) READWRITE(VARINT(obj.nUndoPos));
 
-        // block header
+        // block header, which has to stay at the end: CBlockTreeDB::LoadBlockIndexGuts
+        // hashes it without deserializing the rest of the entry
         READWRITE(obj.nVersion);
         READWRITE(obj.hashPrev);
         READWRITE(obj.hashMerkleRoot);
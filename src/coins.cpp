@@ -35,7 +35,8 @@ size_t CCoinsViewBacked::EstimateSize() const { return base->EstimateSize(); }
 CCoinsViewCache::CCoinsViewCache(CCoinsView *baseIn) : CCoinsViewBacked(baseIn), cachedCoinsUsage(0) {}
 
 size_t CCoinsViewCache::DynamicMemoryUsage() const {
-    return memusage::DynamicUsage(cacheCoins) + cachedCoinsUsage;
+    return memusage::DynamicUsage(cacheCoins) + cachedCoinsUsage +
+        memusage::MallocUsage(sizeof(memusage::unordered_node<CCoinsMap::value_type>)) * m_spare_nodes.size() + memusage::DynamicUsage(m_spare_nodes);
 }
 
 CCoinsMap::iterator CCoinsViewCache::FetchCoin(const COutPoint &outpoint) const {
@@ -45,7 +46,16 @@ CCoinsMap::iterator CCoinsViewCache::FetchCoin(const COutPoint &outpoint) const
     Coin tmp;
     if (!base->GetCoin(outpoint, tmp))
         return cacheCoins.end();
-    CCoinsMap::iterator ret = cacheCoins.emplace(std::piecewise_construct, std::forward_as_tuple(outpoint), std::forward_as_tuple(std::move(tmp))).first;
+    CCoinsMap::iterator ret;
+    if (m_spare_nodes.empty()) {
+        ret = cacheCoins.emplace(std::piecewise_construct, std::forward_as_tuple(outpoint), std::forward_as_tuple(std::move(tmp))).first;
+    } else {
+        CCoinsMap::node_type node{std::move(m_spare_nodes.back())};
+        m_spare_nodes.pop_back();
+        node.key() = outpoint;
+        node.mapped() = CCoinsCacheEntry{std::move(tmp)};
+        ret = cacheCoins.insert(std::move(node)).position;
+    }
     if (ret->second.coin.IsSpent()) {
         // The parent only has an empty entry for this outpoint; we can consider our
         // version as fresh.
@@ -276,6 +286,21 @@ void CCoinsViewCache::ReallocateCache()
     assert(cacheCoins.size() == 0);
     cacheCoins.~CCoinsMap();
     ::new (&cacheCoins) CCoinsMap();
+    m_spare_nodes.clear();
+    m_spare_nodes.shrink_to_fit();
+}
+
+void CCoinsViewCache::Reset()
+{
+    m_spare_nodes.reserve(m_spare_nodes.size() + cacheCoins.size());
+    while (!cacheCoins.empty()) {
+        CCoinsMap::node_type node{cacheCoins.extract(cacheCoins.begin())};
+        // Free the script of the dropped coin right away; only the entry is kept.
+        node.mapped() = CCoinsCacheEntry{};
+        m_spare_nodes.push_back(std::move(node));
+    }
+    cachedCoinsUsage = 0;
+    hashBlock.SetNull();
 }
 
 static const size_t MIN_TRANSACTION_OUTPUT_WEIGHT = WITNESS_SCALE_FACTOR * ::GetSerializeSize(CTxOut(), PROTOCOL_VERSION);
@@ -19,6 +19,7 @@
 
 #include <functional>
 #include <unordered_map>
+#include <vector>
 
 /**
  * A UTXO entry.
@@ -223,6 +224,9 @@ protected:
     /* Cached dynamic memory usage for the inner Coin objects. */
     mutable size_t cachedCoinsUsage;
 
+    /* Entries dropped by Reset(), whose allocations are reused for coins fetched afterwards. */
+    mutable std::vector<CCoinsMap::node_type> m_spare_nodes;
+
 public:
     CCoinsViewCache(CCoinsView *baseIn);
 
@@ -311,6 +315,16 @@ public:
     //! See: https://stackoverflow.com/questions/42114044/how-to-release-unordered-map-memory
     void ReallocateCache();
 
+    /**
+     * Drop all cached coins and the best block, leaving the cache as if it had just been
+     * constructed, but keep its hash table and entries allocated to reuse for coins fetched
+     * afterwards. Changes that were not flushed are forgotten.
+     *
+     * This lets short-lived views, like the ones used for mempool acceptance, be reused from
+     * one transaction to the next without allocating and freeing an entry for every coin.
+     */
+    void Reset();
+
 private:
     /**
      * @note this is marked const, but may actually append to `cacheCoins`, increasing
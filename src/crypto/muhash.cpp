@@ -4,6 +4,7 @@
 
 #include <crypto/muhash.h>
 
+#include <compat/cpuid.h>
 #include <crypto/chacha20.h>
 #include <crypto/common.h>
 #include <hash.h>
@@ -12,6 +13,14 @@
 #include <cstdio>
 #include <limits>
 
+#if defined(USE_ASM) && defined(HAVE_GETCPUID) && (defined(__x86_64__) || defined(__amd64__))
+#define MUHASH_USE_BMI2
+namespace muhash_bmi2
+{
+void Mul(uint64_t* out, const uint64_t* a, const uint64_t* b);
+}
+#endif
+
 namespace {
 
 using limb_t = Num3072::limb_t;
@@ -113,6 +122,21 @@ inline void addnextract2(limb_t& c0, limb_t& c1, const limb_t& a, limb_t& n)
     c1 = c2;
 }
 
+#ifdef MUHASH_USE_BMI2
+/** Whether the CPU supports the MULX (BMI2) and ADCX/ADOX (ADX) instructions. */
+bool HaveBMI2ADX()
+{
+    static const bool have = [] {
+        uint32_t eax, ebx, ecx, edx;
+        GetCPUID(0, 0, eax, ebx, ecx, edx);
+        if (eax < 7) return false;
+        GetCPUID(7, 0, eax, ebx, ecx, edx);
+        return ((ebx >> 8) & 1) && ((ebx >> 19) & 1);
+    }();
+    return have;
+}
+#endif
+
 /** in_out = in_out^(2^sq) * mul */
 inline void square_n_mul(Num3072& in_out, const int sq, const Num3072& mul)
 {
@@ -178,8 +202,44 @@ Num3072 Num3072::GetInverse() const
     return out;
 }
 
+/** Set this to product modulo 2^3072 - MAX_PRIME_DIFF, where product is 6144 bits wide. */
+void Num3072::ReduceProduct(const limb_t (&product)[2 * LIMBS])
+{
+    limb_t tmp[LIMBS];
+
+    /* First reduction: fold the upper half in, as 2^3072 = MAX_PRIME_DIFF (mod p). */
+    limb_t carry = 0;
+    for (int j = 0; j < LIMBS; ++j) {
+        double_limb_t t = (double_limb_t)product[LIMBS + j] * MAX_PRIME_DIFF + product[j] + carry;
+        tmp[j] = t;
+        carry = t >> LIMB_SIZE;
+    }
+
+    /* Perform a second reduction. */
+    limb_t c0 = carry, c1 = 0;
+    muln2(c0, c1, MAX_PRIME_DIFF);
+    for (int j = 0; j < LIMBS; ++j) {
+        addnextract2(c0, c1, tmp[j], this->limbs[j]);
+    }
+
+    assert(c1 == 0);
+    assert(c0 == 0 || c0 == 1);
+
+    if (this->IsOverflow()) this->FullReduce();
+    if (c0) this->FullReduce();
+}
+
 void Num3072::Multiply(const Num3072& a)
 {
+#ifdef MUHASH_USE_BMI2
+    if (HaveBMI2ADX()) {
+        limb_t product[2 * LIMBS];
+        muhash_bmi2::Mul(product, this->limbs, a.limbs);
+        ReduceProduct(product);
+        return;
+    }
+#endif
+
     limb_t c0 = 0, c1 = 0, c2 = 0;
     Num3072 tmp;
 
@@ -217,6 +277,16 @@ void Num3072::Multiply(const Num3072& a)
 
 void Num3072::Square()
 {
+#ifdef MUHASH_USE_BMI2
+    // A full multiplication with the BMI2/ADX kernel beats the portable squaring.
+    if (HaveBMI2ADX()) {
+        limb_t product[2 * LIMBS];
+        muhash_bmi2::Mul(product, this->limbs, this->limbs);
+        ReduceProduct(product);
+        return;
+    }
+#endif
+
     limb_t c0 = 0, c1 = 0, c2 = 0;
     Num3072 tmp;
 
@@ -340,6 +410,14 @@ MuHash3072& MuHash3072::Insert(Span<const unsigned char> in) noexcept {
     return *this;
 }
 
+MuHash3072& MuHash3072::InsertBatch(Span<const Span<const unsigned char>> in) noexcept
+{
+    Num3072 acc;
+    for (const auto& element : in) acc.Multiply(ToNum3072(element));
+    m_numerator.Multiply(acc);
+    return *this;
+}
+
 MuHash3072& MuHash3072::Remove(Span<const unsigned char> in) noexcept {
     m_denominator.Multiply(ToNum3072(in));
     return *this;
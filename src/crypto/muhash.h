@@ -60,6 +60,9 @@ public:
             READWRITE(limb);
         }
     }
+
+private:
+    void ReduceProduct(const limb_t (&product)[2 * LIMBS]);
 };
 
 /** A class representing MuHash sets
@@ -109,6 +112,12 @@ public:
     /* Insert a single piece of data into the set. */
     MuHash3072& Insert(Span<const unsigned char> in) noexcept;
 
+    /* Insert many pieces of data into the set. They are multiplied into a
+     * local accumulator, which is combined into the set once. Disjoint
+     * batches (e.g. shards of the UTXO set) can be inserted into separate
+     * objects in parallel, and the results combined with operator*=. */
+    MuHash3072& InsertBatch(Span<const Span<const unsigned char>> in) noexcept;
+
     /* Remove a single piece of data from the set. */
     MuHash3072& Remove(Span<const unsigned char> in) noexcept;
 
@@ -0,0 +1,48 @@
+// Copyright (c) 2022 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__amd64__)
+
+namespace muhash_bmi2
+{
+/**
+ * out[0..95] = a[0..47] * b[0..47], using the BMI2 and ADX instructions.
+ *
+ * The product is computed one row a[i] * b at a time. Within a row, MULX
+ * leaves the flags untouched, so the low halves of the partial products can
+ * be added to the accumulator on the OF chain (ADOX) while the high halves
+ * are carried into the next limb on the CF chain (ADCX), without any flag
+ * saving in between.
+ */
+void Mul(uint64_t* out, const uint64_t* a, const uint64_t* b)
+{
+    memset(out, 0, 96 * sizeof(uint64_t));
+    for (int i = 0; i < 48; ++i) {
+        __asm__ __volatile__(
+            "xorl %%r10d, %%r10d\n"
+            ".irp j,0,16,32,48,64,80,96,112,128,144,160,176,192,208,224,240,256,272,288,304,320,336,352,368\n"
+            "mulxq \\j(%[b]), %%r8, %%r9\n"
+            "adoxq \\j(%[r]), %%r8\n"
+            "adcxq %%r10, %%r8\n"
+            "movq %%r8, \\j(%[r])\n"
+            "mulxq \\j+8(%[b]), %%r8, %%r10\n"
+            "adoxq \\j+8(%[r]), %%r8\n"
+            "adcxq %%r9, %%r8\n"
+            "movq %%r8, \\j+8(%[r])\n"
+            ".endr\n"
+            "movl $0, %%r8d\n"
+            "adoxq %%r8, %%r10\n"
+            "adcxq %%r8, %%r10\n"
+            "movq %%r10, 384(%[r])\n"
+            :
+            : [r] "r"(out + i), [b] "r"(b), "d"(a[i])
+            : "r8", "r9", "r10", "cc", "memory");
+    }
+}
+} // namespace muhash_bmi2
+
+#endif
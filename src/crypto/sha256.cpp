@@ -8,6 +8,9 @@
 #include <assert.h>
 #include <string.h>
 
+#include <algorithm>
+#include <utility>
+
 #include <compat/cpuid.h>
 
 #if defined(__linux__) && defined(ENABLE_ARM_SHANI) && !defined(BUILD_BITCOIN_INTERNAL)
@@ -34,19 +37,36 @@ namespace sha256d64_sse41
 void Transform_4way(unsigned char* out, const unsigned char* in);
 }
 
+namespace sha256_sse41
+{
+void Transform_4way(uint32_t* s, const unsigned char* const* chunks, size_t blocks);
+}
+
 namespace sha256d64_avx2
 {
 void Transform_8way(unsigned char* out, const unsigned char* in);
 }
 
+namespace sha256_avx2
+{
+void Transform_8way(uint32_t* s, const unsigned char* const* chunks, size_t blocks);
+}
+
+namespace sha256d64_avx512
+{
+void Transform_16way(unsigned char* out, const unsigned char* in);
+}
+
 namespace sha256d64_x86_shani
 {
 void Transform_2way(unsigned char* out, const unsigned char* in);
+void Transform_4way(unsigned char* out, const unsigned char* in);
 }
 
 namespace sha256_x86_shani
 {
 void Transform(uint32_t* s, const unsigned char* chunk, size_t blocks);
+void Transform_2way(uint32_t* s, const unsigned char* const* chunks, size_t blocks);
 }
 
 namespace sha256_arm_shani
@@ -436,6 +456,8 @@ void TransformD64(unsigned char* out, const unsigned char* in)
 
 typedef void (*TransformType)(uint32_t*, const unsigned char*, size_t);
 typedef void (*TransformD64Type)(unsigned char*, const unsigned char*);
+/** Transform N independent states (8 words each, consecutively in s), each with its own sequence of chunks. */
+typedef void (*TransformMultiType)(uint32_t*, const unsigned char* const*, size_t);
 
 template<TransformType tr>
 void TransformD64Wrapper(unsigned char* out, const unsigned char* in)
@@ -481,6 +503,116 @@ TransformD64Type TransformD64 = sha256::TransformD64;
 TransformD64Type TransformD64_2way = nullptr;
 TransformD64Type TransformD64_4way = nullptr;
 TransformD64Type TransformD64_8way = nullptr;
+TransformD64Type TransformD64_16way = nullptr;
+TransformMultiType TransformMulti_2way = nullptr;
+TransformMultiType TransformMulti_4way = nullptr;
+TransformMultiType TransformMulti_8way = nullptr;
+
+/** A message being double-SHA256'd in one lane of a multi-lane transform. */
+struct MultiLane
+{
+    enum Stage { BODY, TAIL, SECOND, DONE };
+
+    Stage stage{DONE};
+    //! The next chunk to process, and the number of chunks left in the current stage.
+    const unsigned char* data{nullptr};
+    size_t blocks{0};
+    size_t len{0};
+    unsigned char* out{nullptr};
+    //! Padded tail of the message, or the input to the second hash.
+    unsigned char buf[128];
+
+    void Start(uint32_t* s, unsigned char* out_in, const unsigned char* in, size_t len_in)
+    {
+        sha256::Initialize(s);
+        stage = BODY;
+        data = in;
+        blocks = len_in / 64;
+        len = len_in;
+        out = out_in;
+        if (blocks == 0) Advance(s);
+    }
+
+    /** Account for n processed chunks, moving on to the next stage if the current one is done. */
+    void Consume(uint32_t* s, size_t n)
+    {
+        data += 64 * n;
+        blocks -= n;
+        if (blocks == 0) Advance(s);
+    }
+
+    void Advance(uint32_t* s)
+    {
+        switch (stage) {
+        case BODY: {
+            // The unprocessed end of the message, followed by the SHA256 padding.
+            const size_t rem = len % 64;
+            if (rem) memcpy(buf, data, rem);
+            memset(buf + rem, 0, sizeof(buf) - rem);
+            buf[rem] = 0x80;
+            blocks = rem < 56 ? 1 : 2;
+            WriteBE64(buf + 64 * blocks - 8, uint64_t{len} << 3);
+            data = buf;
+            stage = TAIL;
+            break;
+        }
+        case TAIL:
+            // A 32-byte message: the first hash, followed by the padding.
+            for (int i = 0; i < 8; ++i) WriteBE32(buf + 4 * i, s[i]);
+            memset(buf + 32, 0, 32);
+            buf[32] = 0x80;
+            buf[62] = 1;
+            sha256::Initialize(s);
+            data = buf;
+            blocks = 1;
+            stage = SECOND;
+            break;
+        case SECOND:
+            for (int i = 0; i < 8; ++i) WriteBE32(out + 4 * i, s[i]);
+            stage = DONE;
+            break;
+        case DONE:
+            assert(false);
+        }
+    }
+};
+
+/** Double-SHA256 count >= width messages, keeping width lanes of tr busy for as long as there are messages to start. */
+void SHA256DMultiLanes(TransformMultiType tr, size_t width, unsigned char* output, const unsigned char* const* inputs, const size_t* lengths, size_t count)
+{
+    uint32_t s[8 * 8];
+    MultiLane lanes[8];
+    const unsigned char* chunks[8];
+    size_t next = 0;
+
+    while (true) {
+        size_t blocks = SIZE_MAX;
+        bool full = true;
+        for (size_t i = 0; i < width; ++i) {
+            if (lanes[i].stage == MultiLane::DONE) {
+                if (next == count) {
+                    full = false;
+                    break;
+                }
+                lanes[i].Start(s + 8 * i, output + 32 * next, inputs[next], lengths[next]);
+                ++next;
+            }
+            chunks[i] = lanes[i].data;
+            blocks = std::min(blocks, lanes[i].blocks);
+        }
+        if (!full) break;
+        tr(s, chunks, blocks);
+        for (size_t i = 0; i < width; ++i) lanes[i].Consume(s + 8 * i, blocks);
+    }
+
+    // Out of messages to fill the lanes with; finish the remaining ones one at a time.
+    for (size_t i = 0; i < width; ++i) {
+        while (lanes[i].stage != MultiLane::DONE) {
+            Transform(s + 8 * i, lanes[i].data, lanes[i].blocks);
+            lanes[i].Consume(s + 8 * i, lanes[i].blocks);
+        }
+    }
+}
 
 bool SelfTest() {
     // Input state (equal to the initial SHA256 state)
@@ -564,6 +696,34 @@ bool SelfTest() {
         if (!std::equal(out, out + 256, result_d64)) return false;
     }
 
+    // Test TransformD64_16way, if available, on the 8 messages above repeated twice.
+    if (TransformD64_16way) {
+        unsigned char in[1024];
+        std::copy(data + 1, data + 513, in);
+        std::copy(data + 1, data + 513, in + 512);
+        unsigned char out[512];
+        TransformD64_16way(out, in);
+        if (!std::equal(out, out + 256, result_d64)) return false;
+        if (!std::equal(out + 256, out + 512, result_d64)) return false;
+    }
+
+    // Test the multi-lane transforms, if available. Lane i starts from the
+    // state after i chunks and processes the 9 - width chunks that follow.
+    const std::pair<TransformMultiType, int> multi[] = {{TransformMulti_2way, 2}, {TransformMulti_4way, 4}, {TransformMulti_8way, 8}};
+    for (const auto& [tr, width] : multi) {
+        if (!tr) continue;
+        uint32_t state[64];
+        const unsigned char* chunks[8];
+        for (int i = 0; i < width; ++i) {
+            std::copy(result[i], result[i] + 8, state + 8 * i);
+            chunks[i] = data + 1 + 64 * i;
+        }
+        tr(state, chunks, 9 - width);
+        for (int i = 0; i < width; ++i) {
+            if (!std::equal(state + 8 * i, state + 8 * i + 8, result[i + 9 - width])) return false;
+        }
+    }
+
     return true;
 }
 
@@ -575,6 +735,14 @@ bool AVXEnabled()
     __asm__("xgetbv" : "=a"(a), "=d"(d) : "c"(0));
     return (a & 6) == 6;
 }
+
+/** Check whether the OS has enabled AVX-512 registers (the opmask, and the upper halves and upper 16 of the ZMM registers). */
+bool AVX512Enabled()
+{
+    uint32_t a, d;
+    __asm__("xgetbv" : "=a"(a), "=d"(d) : "c"(0));
+    return (a & 0xe6) == 0xe6;
+}
 #endif
 } // namespace
 
@@ -587,16 +755,21 @@ std::string SHA256AutoDetect()
     bool have_xsave = false;
     bool have_avx = false;
     bool have_avx2 = false;
+    bool have_avx512 = false;
     bool have_x86_shani = false;
     bool enabled_avx = false;
+    bool enabled_avx512 = false;
 
     (void)AVXEnabled;
+    (void)AVX512Enabled;
     (void)have_sse4;
     (void)have_avx;
     (void)have_xsave;
     (void)have_avx2;
+    (void)have_avx512;
     (void)have_x86_shani;
     (void)enabled_avx;
+    (void)enabled_avx512;
 
     uint32_t eax, ebx, ecx, edx;
     GetCPUID(1, 0, eax, ebx, ecx, edx);
@@ -605,10 +778,12 @@ std::string SHA256AutoDetect()
     have_avx = (ecx >> 28) & 1;
     if (have_xsave && have_avx) {
         enabled_avx = AVXEnabled();
+        enabled_avx512 = enabled_avx && AVX512Enabled();
     }
     if (have_sse4) {
         GetCPUID(7, 0, eax, ebx, ecx, edx);
         have_avx2 = (ebx >> 5) & 1;
+        have_avx512 = (ebx >> 16) & 1;
         have_x86_shani = (ebx >> 29) & 1;
     }
 
@@ -617,7 +792,9 @@ std::string SHA256AutoDetect()
         Transform = sha256_x86_shani::Transform;
         TransformD64 = TransformD64Wrapper<sha256_x86_shani::Transform>;
         TransformD64_2way = sha256d64_x86_shani::Transform_2way;
-        ret = "x86_shani(1way,2way)";
+        TransformD64_4way = sha256d64_x86_shani::Transform_4way;
+        TransformMulti_2way = sha256_x86_shani::Transform_2way;
+        ret = "x86_shani(1way,2way,4way)";
         have_sse4 = false; // Disable SSE4/AVX2;
         have_avx2 = false;
     }
@@ -631,6 +808,7 @@ std::string SHA256AutoDetect()
 #endif
 #if defined(ENABLE_SSE41) && !defined(BUILD_BITCOIN_INTERNAL)
         TransformD64_4way = sha256d64_sse41::Transform_4way;
+        TransformMulti_4way = sha256_sse41::Transform_4way;
         ret += ",sse41(4way)";
 #endif
     }
@@ -638,9 +816,17 @@ std::string SHA256AutoDetect()
 #if defined(ENABLE_AVX2) && !defined(BUILD_BITCOIN_INTERNAL)
     if (have_avx2 && have_avx && enabled_avx) {
         TransformD64_8way = sha256d64_avx2::Transform_8way;
+        TransformMulti_8way = sha256_avx2::Transform_8way;
         ret += ",avx2(8way)";
     }
 #endif
+
+#if defined(ENABLE_AVX512) && !defined(BUILD_BITCOIN_INTERNAL)
+    if (have_avx512 && enabled_avx512) {
+        TransformD64_16way = sha256d64_avx512::Transform_16way;
+        ret += ",avx512(16way)";
+    }
+#endif
 #endif
 
 #if defined(ENABLE_ARM_SHANI) && !defined(BUILD_BITCOIN_INTERNAL)
@@ -738,6 +924,14 @@ CSHA256& CSHA256::Reset()
 
 void SHA256D64(unsigned char* out, const unsigned char* in, size_t blocks)
 {
+    if (TransformD64_16way) {
+        while (blocks >= 16) {
+            TransformD64_16way(out, in);
+            out += 512;
+            in += 1024;
+            blocks -= 16;
+        }
+    }
     if (TransformD64_8way) {
         while (blocks >= 8) {
             TransformD64_8way(out, in);
@@ -769,3 +963,23 @@ void SHA256D64(unsigned char* out, const unsigned char* in, size_t blocks)
         --blocks;
     }
 }
+
+void SHA256DMulti(unsigned char* output, const unsigned char* const* inputs, const size_t* lengths, size_t count)
+{
+    if (TransformMulti_8way && count >= 8) {
+        SHA256DMultiLanes(TransformMulti_8way, 8, output, inputs, lengths, count);
+        return;
+    }
+    if (TransformMulti_4way && count >= 4) {
+        SHA256DMultiLanes(TransformMulti_4way, 4, output, inputs, lengths, count);
+        return;
+    }
+    if (TransformMulti_2way && count >= 2) {
+        SHA256DMultiLanes(TransformMulti_2way, 2, output, inputs, lengths, count);
+        return;
+    }
+    for (size_t i = 0; i < count; ++i) {
+        CSHA256().Write(inputs[i], lengths[i]).Finalize(output + 32 * i);
+        CSHA256().Write(output + 32 * i, 32).Finalize(output + 32 * i);
+    }
+}
@@ -4,12 +4,13 @@
 
 #ifdef ENABLE_SSE41
 
+#include <algorithm>
+#include <stddef.h>
 #include <stdint.h>
 #include <immintrin.h>
 
 #include <crypto/common.h>
 
-namespace sha256d64_sse41 {
 namespace {
 
 __m128i inline K(uint32_t x) { return _mm_set1_epi32(x); }
@@ -62,8 +63,31 @@ void inline Write4(unsigned char* out, int offset, __m128i v) {
     WriteLE32(out + 96 + offset, _mm_extract_epi32(v, 0));
 }
 
+__m128i inline Gather4(const unsigned char* const* in, int offset) {
+    __m128i ret = _mm_set_epi32(
+        ReadLE32(in[0] + offset),
+        ReadLE32(in[1] + offset),
+        ReadLE32(in[2] + offset),
+        ReadLE32(in[3] + offset)
+    );
+    return _mm_shuffle_epi8(ret, _mm_set_epi32(0x0C0D0E0FUL, 0x08090A0BUL, 0x04050607UL, 0x00010203UL));
+}
+
+__m128i inline LoadState4(const uint32_t* s, int word) {
+    return _mm_set_epi32(s[word], s[8 + word], s[16 + word], s[24 + word]);
 }
 
+void inline StoreState4(uint32_t* s, int word, __m128i v) {
+    s[word] = _mm_extract_epi32(v, 3);
+    s[8 + word] = _mm_extract_epi32(v, 2);
+    s[16 + word] = _mm_extract_epi32(v, 1);
+    s[24 + word] = _mm_extract_epi32(v, 0);
+}
+
+}
+
+namespace sha256d64_sse41 {
+
 void Transform_4way(unsigned char* out, const unsigned char* in)
 {
     // Transform 1
@@ -317,4 +341,112 @@ void Transform_4way(unsigned char* out, const unsigned char* in)
 
 }
 
+namespace sha256_sse41 {
+void Transform_4way(uint32_t* s, const unsigned char* const* chunks, size_t blocks)
+{
+    const unsigned char* in[4];
+    std::copy(chunks, chunks + 4, in);
+
+    __m128i a = LoadState4(s, 0);
+    __m128i b = LoadState4(s, 1);
+    __m128i c = LoadState4(s, 2);
+    __m128i d = LoadState4(s, 3);
+    __m128i e = LoadState4(s, 4);
+    __m128i f = LoadState4(s, 5);
+    __m128i g = LoadState4(s, 6);
+    __m128i h = LoadState4(s, 7);
+
+    while (blocks--) {
+        __m128i t0 = a, t1 = b, t2 = c, t3 = d, t4 = e, t5 = f, t6 = g, t7 = h;
+        __m128i w0, w1, w2, w3, w4, w5, w6, w7, w8, w9, w10, w11, w12, w13, w14, w15;
+
+        Round(a, b, c, d, e, f, g, h, Add(K(0x428a2f98ul), w0 = Gather4(in, 0)));
+        Round(h, a, b, c, d, e, f, g, Add(K(0x71374491ul), w1 = Gather4(in, 4)));
+        Round(g, h, a, b, c, d, e, f, Add(K(0xb5c0fbcful), w2 = Gather4(in, 8)));
+        Round(f, g, h, a, b, c, d, e, Add(K(0xe9b5dba5ul), w3 = Gather4(in, 12)));
+        Round(e, f, g, h, a, b, c, d, Add(K(0x3956c25bul), w4 = Gather4(in, 16)));
+        Round(d, e, f, g, h, a, b, c, Add(K(0x59f111f1ul), w5 = Gather4(in, 20)));
+        Round(c, d, e, f, g, h, a, b, Add(K(0x923f82a4ul), w6 = Gather4(in, 24)));
+        Round(b, c, d, e, f, g, h, a, Add(K(0xab1c5ed5ul), w7 = Gather4(in, 28)));
+        Round(a, b, c, d, e, f, g, h, Add(K(0xd807aa98ul), w8 = Gather4(in, 32)));
+        Round(h, a, b, c, d, e, f, g, Add(K(0x12835b01ul), w9 = Gather4(in, 36)));
+        Round(g, h, a, b, c, d, e, f, Add(K(0x243185beul), w10 = Gather4(in, 40)));
+        Round(f, g, h, a, b, c, d, e, Add(K(0x550c7dc3ul), w11 = Gather4(in, 44)));
+        Round(e, f, g, h, a, b, c, d, Add(K(0x72be5d74ul), w12 = Gather4(in, 48)));
+        Round(d, e, f, g, h, a, b, c, Add(K(0x80deb1feul), w13 = Gather4(in, 52)));
+        Round(c, d, e, f, g, h, a, b, Add(K(0x9bdc06a7ul), w14 = Gather4(in, 56)));
+        Round(b, c, d, e, f, g, h, a, Add(K(0xc19bf174ul), w15 = Gather4(in, 60)));
+        Round(a, b, c, d, e, f, g, h, Add(K(0xe49b69c1ul), Inc(w0, sigma1(w14), w9, sigma0(w1))));
+        Round(h, a, b, c, d, e, f, g, Add(K(0xefbe4786ul), Inc(w1, sigma1(w15), w10, sigma0(w2))));
+        Round(g, h, a, b, c, d, e, f, Add(K(0x0fc19dc6ul), Inc(w2, sigma1(w0), w11, sigma0(w3))));
+        Round(f, g, h, a, b, c, d, e, Add(K(0x240ca1ccul), Inc(w3, sigma1(w1), w12, sigma0(w4))));
+        Round(e, f, g, h, a, b, c, d, Add(K(0x2de92c6ful), Inc(w4, sigma1(w2), w13, sigma0(w5))));
+        Round(d, e, f, g, h, a, b, c, Add(K(0x4a7484aaul), Inc(w5, sigma1(w3), w14, sigma0(w6))));
+        Round(c, d, e, f, g, h, a, b, Add(K(0x5cb0a9dcul), Inc(w6, sigma1(w4), w15, sigma0(w7))));
+        Round(b, c, d, e, f, g, h, a, Add(K(0x76f988daul), Inc(w7, sigma1(w5), w0, sigma0(w8))));
+        Round(a, b, c, d, e, f, g, h, Add(K(0x983e5152ul), Inc(w8, sigma1(w6), w1, sigma0(w9))));
+        Round(h, a, b, c, d, e, f, g, Add(K(0xa831c66dul), Inc(w9, sigma1(w7), w2, sigma0(w10))));
+        Round(g, h, a, b, c, d, e, f, Add(K(0xb00327c8ul), Inc(w10, sigma1(w8), w3, sigma0(w11))));
+        Round(f, g, h, a, b, c, d, e, Add(K(0xbf597fc7ul), Inc(w11, sigma1(w9), w4, sigma0(w12))));
+        Round(e, f, g, h, a, b, c, d, Add(K(0xc6e00bf3ul), Inc(w12, sigma1(w10), w5, sigma0(w13))));
+        Round(d, e, f, g, h, a, b, c, Add(K(0xd5a79147ul), Inc(w13, sigma1(w11), w6, sigma0(w14))));
+        Round(c, d, e, f, g, h, a, b, Add(K(0x06ca6351ul), Inc(w14, sigma1(w12), w7, sigma0(w15))));
+        Round(b, c, d, e, f, g, h, a, Add(K(0x14292967ul), Inc(w15, sigma1(w13), w8, sigma0(w0))));
+        Round(a, b, c, d, e, f, g, h, Add(K(0x27b70a85ul), Inc(w0, sigma1(w14), w9, sigma0(w1))));
+        Round(h, a, b, c, d, e, f, g, Add(K(0x2e1b2138ul), Inc(w1, sigma1(w15), w10, sigma0(w2))));
+        Round(g, h, a, b, c, d, e, f, Add(K(0x4d2c6dfcul), Inc(w2, sigma1(w0), w11, sigma0(w3))));
+        Round(f, g, h, a, b, c, d, e, Add(K(0x53380d13ul), Inc(w3, sigma1(w1), w12, sigma0(w4))));
+        Round(e, f, g, h, a, b, c, d, Add(K(0x650a7354ul), Inc(w4, sigma1(w2), w13, sigma0(w5))));
+        Round(d, e, f, g, h, a, b, c, Add(K(0x766a0abbul), Inc(w5, sigma1(w3), w14, sigma0(w6))));
+        Round(c, d, e, f, g, h, a, b, Add(K(0x81c2c92eul), Inc(w6, sigma1(w4), w15, sigma0(w7))));
+        Round(b, c, d, e, f, g, h, a, Add(K(0x92722c85ul), Inc(w7, sigma1(w5), w0, sigma0(w8))));
+        Round(a, b, c, d, e, f, g, h, Add(K(0xa2bfe8a1ul), Inc(w8, sigma1(w6), w1, sigma0(w9))));
+        Round(h, a, b, c, d, e, f, g, Add(K(0xa81a664bul), Inc(w9, sigma1(w7), w2, sigma0(w10))));
+        Round(g, h, a, b, c, d, e, f, Add(K(0xc24b8b70ul), Inc(w10, sigma1(w8), w3, sigma0(w11))));
+        Round(f, g, h, a, b, c, d, e, Add(K(0xc76c51a3ul), Inc(w11, sigma1(w9), w4, sigma0(w12))));
+        Round(e, f, g, h, a, b, c, d, Add(K(0xd192e819ul), Inc(w12, sigma1(w10), w5, sigma0(w13))));
+        Round(d, e, f, g, h, a, b, c, Add(K(0xd6990624ul), Inc(w13, sigma1(w11), w6, sigma0(w14))));
+        Round(c, d, e, f, g, h, a, b, Add(K(0xf40e3585ul), Inc(w14, sigma1(w12), w7, sigma0(w15))));
+        Round(b, c, d, e, f, g, h, a, Add(K(0x106aa070ul), Inc(w15, sigma1(w13), w8, sigma0(w0))));
+        Round(a, b, c, d, e, f, g, h, Add(K(0x19a4c116ul), Inc(w0, sigma1(w14), w9, sigma0(w1))));
+        Round(h, a, b, c, d, e, f, g, Add(K(0x1e376c08ul), Inc(w1, sigma1(w15), w10, sigma0(w2))));
+        Round(g, h, a, b, c, d, e, f, Add(K(0x2748774cul), Inc(w2, sigma1(w0), w11, sigma0(w3))));
+        Round(f, g, h, a, b, c, d, e, Add(K(0x34b0bcb5ul), Inc(w3, sigma1(w1), w12, sigma0(w4))));
+        Round(e, f, g, h, a, b, c, d, Add(K(0x391c0cb3ul), Inc(w4, sigma1(w2), w13, sigma0(w5))));
+        Round(d, e, f, g, h, a, b, c, Add(K(0x4ed8aa4aul), Inc(w5, sigma1(w3), w14, sigma0(w6))));
+        Round(c, d, e, f, g, h, a, b, Add(K(0x5b9cca4ful), Inc(w6, sigma1(w4), w15, sigma0(w7))));
+        Round(b, c, d, e, f, g, h, a, Add(K(0x682e6ff3ul), Inc(w7, sigma1(w5), w0, sigma0(w8))));
+        Round(a, b, c, d, e, f, g, h, Add(K(0x748f82eeul), Inc(w8, sigma1(w6), w1, sigma0(w9))));
+        Round(h, a, b, c, d, e, f, g, Add(K(0x78a5636ful), Inc(w9, sigma1(w7), w2, sigma0(w10))));
+        Round(g, h, a, b, c, d, e, f, Add(K(0x84c87814ul), Inc(w10, sigma1(w8), w3, sigma0(w11))));
+        Round(f, g, h, a, b, c, d, e, Add(K(0x8cc70208ul), Inc(w11, sigma1(w9), w4, sigma0(w12))));
+        Round(e, f, g, h, a, b, c, d, Add(K(0x90befffaul), Inc(w12, sigma1(w10), w5, sigma0(w13))));
+        Round(d, e, f, g, h, a, b, c, Add(K(0xa4506cebul), Inc(w13, sigma1(w11), w6, sigma0(w14))));
+        Round(c, d, e, f, g, h, a, b, Add(K(0xbef9a3f7ul), Inc(w14, sigma1(w12), w7, sigma0(w15))));
+        Round(b, c, d, e, f, g, h, a, Add(K(0xc67178f2ul), Inc(w15, sigma1(w13), w8, sigma0(w0))));
+
+        a = Add(a, t0);
+        b = Add(b, t1);
+        c = Add(c, t2);
+        d = Add(d, t3);
+        e = Add(e, t4);
+        f = Add(f, t5);
+        g = Add(g, t6);
+        h = Add(h, t7);
+
+        for (int i = 0; i < 4; ++i) in[i] += 64;
+    }
+
+    StoreState4(s, 0, a);
+    StoreState4(s, 1, b);
+    StoreState4(s, 2, c);
+    StoreState4(s, 3, d);
+    StoreState4(s, 4, e);
+    StoreState4(s, 5, f);
+    StoreState4(s, 6, g);
+    StoreState4(s, 7, h);
+}
+}
+
+
 #endif
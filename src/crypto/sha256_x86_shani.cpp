@@ -137,6 +137,118 @@ void Transform(uint32_t* s, const unsigned char* chunk, size_t blocks)
     _mm_storeu_si128((__m128i*)s, s0);
     _mm_storeu_si128((__m128i*)(s + 4), s1);
 }
+
+void Transform_2way(uint32_t* s, const unsigned char* const* chunks, size_t blocks)
+{
+    const unsigned char* achunk = chunks[0];
+    const unsigned char* bchunk = chunks[1];
+
+    __m128i am0, am1, am2, am3, as0, as1, aso0, aso1;
+    __m128i bm0, bm1, bm2, bm3, bs0, bs1, bso0, bso1;
+
+    /* Load state */
+    as0 = _mm_loadu_si128((const __m128i*)s);
+    bs0 = _mm_loadu_si128((const __m128i*)(s + 8));
+    as1 = _mm_loadu_si128((const __m128i*)(s + 4));
+    bs1 = _mm_loadu_si128((const __m128i*)(s + 12));
+    Shuffle(as0, as1);
+    Shuffle(bs0, bs1);
+
+    while (blocks--) {
+        /* Remember old state */
+        aso0 = as0;
+        bso0 = bs0;
+        aso1 = as1;
+        bso1 = bs1;
+
+        /* Load data and transform */
+        am0 = Load(achunk);
+        bm0 = Load(bchunk);
+        QuadRound(as0, as1, am0, 0xe9b5dba5b5c0fbcfull, 0x71374491428a2f98ull);
+        QuadRound(bs0, bs1, bm0, 0xe9b5dba5b5c0fbcfull, 0x71374491428a2f98ull);
+        am1 = Load(achunk + 16);
+        bm1 = Load(bchunk + 16);
+        QuadRound(as0, as1, am1, 0xab1c5ed5923f82a4ull, 0x59f111f13956c25bull);
+        QuadRound(bs0, bs1, bm1, 0xab1c5ed5923f82a4ull, 0x59f111f13956c25bull);
+        ShiftMessageA(am0, am1);
+        ShiftMessageA(bm0, bm1);
+        am2 = Load(achunk + 32);
+        bm2 = Load(bchunk + 32);
+        QuadRound(as0, as1, am2, 0x550c7dc3243185beull, 0x12835b01d807aa98ull);
+        QuadRound(bs0, bs1, bm2, 0x550c7dc3243185beull, 0x12835b01d807aa98ull);
+        ShiftMessageA(am1, am2);
+        ShiftMessageA(bm1, bm2);
+        am3 = Load(achunk + 48);
+        bm3 = Load(bchunk + 48);
+        QuadRound(as0, as1, am3, 0xc19bf1749bdc06a7ull, 0x80deb1fe72be5d74ull);
+        QuadRound(bs0, bs1, bm3, 0xc19bf1749bdc06a7ull, 0x80deb1fe72be5d74ull);
+        ShiftMessageB(am2, am3, am0);
+        ShiftMessageB(bm2, bm3, bm0);
+        QuadRound(as0, as1, am0, 0x240ca1cc0fc19dc6ull, 0xefbe4786E49b69c1ull);
+        QuadRound(bs0, bs1, bm0, 0x240ca1cc0fc19dc6ull, 0xefbe4786E49b69c1ull);
+        ShiftMessageB(am3, am0, am1);
+        ShiftMessageB(bm3, bm0, bm1);
+        QuadRound(as0, as1, am1, 0x76f988da5cb0a9dcull, 0x4a7484aa2de92c6full);
+        QuadRound(bs0, bs1, bm1, 0x76f988da5cb0a9dcull, 0x4a7484aa2de92c6full);
+        ShiftMessageB(am0, am1, am2);
+        ShiftMessageB(bm0, bm1, bm2);
+        QuadRound(as0, as1, am2, 0xbf597fc7b00327c8ull, 0xa831c66d983e5152ull);
+        QuadRound(bs0, bs1, bm2, 0xbf597fc7b00327c8ull, 0xa831c66d983e5152ull);
+        ShiftMessageB(am1, am2, am3);
+        ShiftMessageB(bm1, bm2, bm3);
+        QuadRound(as0, as1, am3, 0x1429296706ca6351ull, 0xd5a79147c6e00bf3ull);
+        QuadRound(bs0, bs1, bm3, 0x1429296706ca6351ull, 0xd5a79147c6e00bf3ull);
+        ShiftMessageB(am2, am3, am0);
+        ShiftMessageB(bm2, bm3, bm0);
+        QuadRound(as0, as1, am0, 0x53380d134d2c6dfcull, 0x2e1b213827b70a85ull);
+        QuadRound(bs0, bs1, bm0, 0x53380d134d2c6dfcull, 0x2e1b213827b70a85ull);
+        ShiftMessageB(am3, am0, am1);
+        ShiftMessageB(bm3, bm0, bm1);
+        QuadRound(as0, as1, am1, 0x92722c8581c2c92eull, 0x766a0abb650a7354ull);
+        QuadRound(bs0, bs1, bm1, 0x92722c8581c2c92eull, 0x766a0abb650a7354ull);
+        ShiftMessageB(am0, am1, am2);
+        ShiftMessageB(bm0, bm1, bm2);
+        QuadRound(as0, as1, am2, 0xc76c51A3c24b8b70ull, 0xa81a664ba2bfe8a1ull);
+        QuadRound(bs0, bs1, bm2, 0xc76c51A3c24b8b70ull, 0xa81a664ba2bfe8a1ull);
+        ShiftMessageB(am1, am2, am3);
+        ShiftMessageB(bm1, bm2, bm3);
+        QuadRound(as0, as1, am3, 0x106aa070f40e3585ull, 0xd6990624d192e819ull);
+        QuadRound(bs0, bs1, bm3, 0x106aa070f40e3585ull, 0xd6990624d192e819ull);
+        ShiftMessageB(am2, am3, am0);
+        ShiftMessageB(bm2, bm3, bm0);
+        QuadRound(as0, as1, am0, 0x34b0bcb52748774cull, 0x1e376c0819a4c116ull);
+        QuadRound(bs0, bs1, bm0, 0x34b0bcb52748774cull, 0x1e376c0819a4c116ull);
+        ShiftMessageB(am3, am0, am1);
+        ShiftMessageB(bm3, bm0, bm1);
+        QuadRound(as0, as1, am1, 0x682e6ff35b9cca4full, 0x4ed8aa4a391c0cb3ull);
+        QuadRound(bs0, bs1, bm1, 0x682e6ff35b9cca4full, 0x4ed8aa4a391c0cb3ull);
+        ShiftMessageC(am0, am1, am2);
+        ShiftMessageC(bm0, bm1, bm2);
+        QuadRound(as0, as1, am2, 0x8cc7020884c87814ull, 0x78a5636f748f82eeull);
+        QuadRound(bs0, bs1, bm2, 0x8cc7020884c87814ull, 0x78a5636f748f82eeull);
+        ShiftMessageC(am1, am2, am3);
+        ShiftMessageC(bm1, bm2, bm3);
+        QuadRound(as0, as1, am3, 0xc67178f2bef9A3f7ull, 0xa4506ceb90befffaull);
+        QuadRound(bs0, bs1, bm3, 0xc67178f2bef9A3f7ull, 0xa4506ceb90befffaull);
+
+        /* Combine with old state */
+        as0 = _mm_add_epi32(as0, aso0);
+        bs0 = _mm_add_epi32(bs0, bso0);
+        as1 = _mm_add_epi32(as1, aso1);
+        bs1 = _mm_add_epi32(bs1, bso1);
+
+        /* Advance */
+        achunk += 64;
+        bchunk += 64;
+    }
+
+    Unshuffle(as0, as1);
+    Unshuffle(bs0, bs1);
+    _mm_storeu_si128((__m128i*)s, as0);
+    _mm_storeu_si128((__m128i*)(s + 8), bs0);
+    _mm_storeu_si128((__m128i*)(s + 4), as1);
+    _mm_storeu_si128((__m128i*)(s + 12), bs1);
+}
 }
 
 namespace sha256d64_x86_shani {
@@ -351,6 +463,407 @@ void Transform_2way(unsigned char* out, const unsigned char* in)
     Save(out + 48, bs1);
 }
 
+
+void Transform_4way(unsigned char* out, const unsigned char* in)
+{
+    __m128i am0, am1, am2, am3, as0, as1, aso0, aso1;
+    __m128i bm0, bm1, bm2, bm3, bs0, bs1, bso0, bso1;
+    __m128i cm0, cm1, cm2, cm3, cs0, cs1, cso0, cso1;
+    __m128i dm0, dm1, dm2, dm3, ds0, ds1, dso0, dso1;
+
+    /* Transform 1 */
+    ds0 = cs0 = bs0 = as0 = _mm_load_si128((const __m128i*)INIT0);
+    ds1 = cs1 = bs1 = as1 = _mm_load_si128((const __m128i*)INIT1);
+    am0 = Load(in);
+    bm0 = Load(in + 64);
+    cm0 = Load(in + 128);
+    dm0 = Load(in + 192);
+    QuadRound(as0, as1, am0, 0xe9b5dba5b5c0fbcfull, 0x71374491428a2f98ull);
+    QuadRound(bs0, bs1, bm0, 0xe9b5dba5b5c0fbcfull, 0x71374491428a2f98ull);
+    QuadRound(cs0, cs1, cm0, 0xe9b5dba5b5c0fbcfull, 0x71374491428a2f98ull);
+    QuadRound(ds0, ds1, dm0, 0xe9b5dba5b5c0fbcfull, 0x71374491428a2f98ull);
+    am1 = Load(in + 16);
+    bm1 = Load(in + 80);
+    cm1 = Load(in + 144);
+    dm1 = Load(in + 208);
+    QuadRound(as0, as1, am1, 0xab1c5ed5923f82a4ull, 0x59f111f13956c25bull);
+    QuadRound(bs0, bs1, bm1, 0xab1c5ed5923f82a4ull, 0x59f111f13956c25bull);
+    QuadRound(cs0, cs1, cm1, 0xab1c5ed5923f82a4ull, 0x59f111f13956c25bull);
+    QuadRound(ds0, ds1, dm1, 0xab1c5ed5923f82a4ull, 0x59f111f13956c25bull);
+    ShiftMessageA(am0, am1);
+    ShiftMessageA(bm0, bm1);
+    ShiftMessageA(cm0, cm1);
+    ShiftMessageA(dm0, dm1);
+    am2 = Load(in + 32);
+    bm2 = Load(in + 96);
+    cm2 = Load(in + 160);
+    dm2 = Load(in + 224);
+    QuadRound(as0, as1, am2, 0x550c7dc3243185beull, 0x12835b01d807aa98ull);
+    QuadRound(bs0, bs1, bm2, 0x550c7dc3243185beull, 0x12835b01d807aa98ull);
+    QuadRound(cs0, cs1, cm2, 0x550c7dc3243185beull, 0x12835b01d807aa98ull);
+    QuadRound(ds0, ds1, dm2, 0x550c7dc3243185beull, 0x12835b01d807aa98ull);
+    ShiftMessageA(am1, am2);
+    ShiftMessageA(bm1, bm2);
+    ShiftMessageA(cm1, cm2);
+    ShiftMessageA(dm1, dm2);
+    am3 = Load(in + 48);
+    bm3 = Load(in + 112);
+    cm3 = Load(in + 176);
+    dm3 = Load(in + 240);
+    QuadRound(as0, as1, am3, 0xc19bf1749bdc06a7ull, 0x80deb1fe72be5d74ull);
+    QuadRound(bs0, bs1, bm3, 0xc19bf1749bdc06a7ull, 0x80deb1fe72be5d74ull);
+    QuadRound(cs0, cs1, cm3, 0xc19bf1749bdc06a7ull, 0x80deb1fe72be5d74ull);
+    QuadRound(ds0, ds1, dm3, 0xc19bf1749bdc06a7ull, 0x80deb1fe72be5d74ull);
+    ShiftMessageB(am2, am3, am0);
+    ShiftMessageB(bm2, bm3, bm0);
+    ShiftMessageB(cm2, cm3, cm0);
+    ShiftMessageB(dm2, dm3, dm0);
+    QuadRound(as0, as1, am0, 0x240ca1cc0fc19dc6ull, 0xefbe4786E49b69c1ull);
+    QuadRound(bs0, bs1, bm0, 0x240ca1cc0fc19dc6ull, 0xefbe4786E49b69c1ull);
+    QuadRound(cs0, cs1, cm0, 0x240ca1cc0fc19dc6ull, 0xefbe4786E49b69c1ull);
+    QuadRound(ds0, ds1, dm0, 0x240ca1cc0fc19dc6ull, 0xefbe4786E49b69c1ull);
+    ShiftMessageB(am3, am0, am1);
+    ShiftMessageB(bm3, bm0, bm1);
+    ShiftMessageB(cm3, cm0, cm1);
+    ShiftMessageB(dm3, dm0, dm1);
+    QuadRound(as0, as1, am1, 0x76f988da5cb0a9dcull, 0x4a7484aa2de92c6full);
+    QuadRound(bs0, bs1, bm1, 0x76f988da5cb0a9dcull, 0x4a7484aa2de92c6full);
+    QuadRound(cs0, cs1, cm1, 0x76f988da5cb0a9dcull, 0x4a7484aa2de92c6full);
+    QuadRound(ds0, ds1, dm1, 0x76f988da5cb0a9dcull, 0x4a7484aa2de92c6full);
+    ShiftMessageB(am0, am1, am2);
+    ShiftMessageB(bm0, bm1, bm2);
+    ShiftMessageB(cm0, cm1, cm2);
+    ShiftMessageB(dm0, dm1, dm2);
+    QuadRound(as0, as1, am2, 0xbf597fc7b00327c8ull, 0xa831c66d983e5152ull);
+    QuadRound(bs0, bs1, bm2, 0xbf597fc7b00327c8ull, 0xa831c66d983e5152ull);
+    QuadRound(cs0, cs1, cm2, 0xbf597fc7b00327c8ull, 0xa831c66d983e5152ull);
+    QuadRound(ds0, ds1, dm2, 0xbf597fc7b00327c8ull, 0xa831c66d983e5152ull);
+    ShiftMessageB(am1, am2, am3);
+    ShiftMessageB(bm1, bm2, bm3);
+    ShiftMessageB(cm1, cm2, cm3);
+    ShiftMessageB(dm1, dm2, dm3);
+    QuadRound(as0, as1, am3, 0x1429296706ca6351ull, 0xd5a79147c6e00bf3ull);
+    QuadRound(bs0, bs1, bm3, 0x1429296706ca6351ull, 0xd5a79147c6e00bf3ull);
+    QuadRound(cs0, cs1, cm3, 0x1429296706ca6351ull, 0xd5a79147c6e00bf3ull);
+    QuadRound(ds0, ds1, dm3, 0x1429296706ca6351ull, 0xd5a79147c6e00bf3ull);
+    ShiftMessageB(am2, am3, am0);
+    ShiftMessageB(bm2, bm3, bm0);
+    ShiftMessageB(cm2, cm3, cm0);
+    ShiftMessageB(dm2, dm3, dm0);
+    QuadRound(as0, as1, am0, 0x53380d134d2c6dfcull, 0x2e1b213827b70a85ull);
+    QuadRound(bs0, bs1, bm0, 0x53380d134d2c6dfcull, 0x2e1b213827b70a85ull);
+    QuadRound(cs0, cs1, cm0, 0x53380d134d2c6dfcull, 0x2e1b213827b70a85ull);
+    QuadRound(ds0, ds1, dm0, 0x53380d134d2c6dfcull, 0x2e1b213827b70a85ull);
+    ShiftMessageB(am3, am0, am1);
+    ShiftMessageB(bm3, bm0, bm1);
+    ShiftMessageB(cm3, cm0, cm1);
+    ShiftMessageB(dm3, dm0, dm1);
+    QuadRound(as0, as1, am1, 0x92722c8581c2c92eull, 0x766a0abb650a7354ull);
+    QuadRound(bs0, bs1, bm1, 0x92722c8581c2c92eull, 0x766a0abb650a7354ull);
+    QuadRound(cs0, cs1, cm1, 0x92722c8581c2c92eull, 0x766a0abb650a7354ull);
+    QuadRound(ds0, ds1, dm1, 0x92722c8581c2c92eull, 0x766a0abb650a7354ull);
+    ShiftMessageB(am0, am1, am2);
+    ShiftMessageB(bm0, bm1, bm2);
+    ShiftMessageB(cm0, cm1, cm2);
+    ShiftMessageB(dm0, dm1, dm2);
+    QuadRound(as0, as1, am2, 0xc76c51A3c24b8b70ull, 0xa81a664ba2bfe8a1ull);
+    QuadRound(bs0, bs1, bm2, 0xc76c51A3c24b8b70ull, 0xa81a664ba2bfe8a1ull);
+    QuadRound(cs0, cs1, cm2, 0xc76c51A3c24b8b70ull, 0xa81a664ba2bfe8a1ull);
+    QuadRound(ds0, ds1, dm2, 0xc76c51A3c24b8b70ull, 0xa81a664ba2bfe8a1ull);
+    ShiftMessageB(am1, am2, am3);
+    ShiftMessageB(bm1, bm2, bm3);
+    ShiftMessageB(cm1, cm2, cm3);
+    ShiftMessageB(dm1, dm2, dm3);
+    QuadRound(as0, as1, am3, 0x106aa070f40e3585ull, 0xd6990624d192e819ull);
+    QuadRound(bs0, bs1, bm3, 0x106aa070f40e3585ull, 0xd6990624d192e819ull);
+    QuadRound(cs0, cs1, cm3, 0x106aa070f40e3585ull, 0xd6990624d192e819ull);
+    QuadRound(ds0, ds1, dm3, 0x106aa070f40e3585ull, 0xd6990624d192e819ull);
+    ShiftMessageB(am2, am3, am0);
+    ShiftMessageB(bm2, bm3, bm0);
+    ShiftMessageB(cm2, cm3, cm0);
+    ShiftMessageB(dm2, dm3, dm0);
+    QuadRound(as0, as1, am0, 0x34b0bcb52748774cull, 0x1e376c0819a4c116ull);
+    QuadRound(bs0, bs1, bm0, 0x34b0bcb52748774cull, 0x1e376c0819a4c116ull);
+    QuadRound(cs0, cs1, cm0, 0x34b0bcb52748774cull, 0x1e376c0819a4c116ull);
+    QuadRound(ds0, ds1, dm0, 0x34b0bcb52748774cull, 0x1e376c0819a4c116ull);
+    ShiftMessageB(am3, am0, am1);
+    ShiftMessageB(bm3, bm0, bm1);
+    ShiftMessageB(cm3, cm0, cm1);
+    ShiftMessageB(dm3, dm0, dm1);
+    QuadRound(as0, as1, am1, 0x682e6ff35b9cca4full, 0x4ed8aa4a391c0cb3ull);
+    QuadRound(bs0, bs1, bm1, 0x682e6ff35b9cca4full, 0x4ed8aa4a391c0cb3ull);
+    QuadRound(cs0, cs1, cm1, 0x682e6ff35b9cca4full, 0x4ed8aa4a391c0cb3ull);
+    QuadRound(ds0, ds1, dm1, 0x682e6ff35b9cca4full, 0x4ed8aa4a391c0cb3ull);
+    ShiftMessageC(am0, am1, am2);
+    ShiftMessageC(bm0, bm1, bm2);
+    ShiftMessageC(cm0, cm1, cm2);
+    ShiftMessageC(dm0, dm1, dm2);
+    QuadRound(as0, as1, am2, 0x8cc7020884c87814ull, 0x78a5636f748f82eeull);
+    QuadRound(bs0, bs1, bm2, 0x8cc7020884c87814ull, 0x78a5636f748f82eeull);
+    QuadRound(cs0, cs1, cm2, 0x8cc7020884c87814ull, 0x78a5636f748f82eeull);
+    QuadRound(ds0, ds1, dm2, 0x8cc7020884c87814ull, 0x78a5636f748f82eeull);
+    ShiftMessageC(am1, am2, am3);
+    ShiftMessageC(bm1, bm2, bm3);
+    ShiftMessageC(cm1, cm2, cm3);
+    ShiftMessageC(dm1, dm2, dm3);
+    QuadRound(as0, as1, am3, 0xc67178f2bef9A3f7ull, 0xa4506ceb90befffaull);
+    QuadRound(bs0, bs1, bm3, 0xc67178f2bef9A3f7ull, 0xa4506ceb90befffaull);
+    QuadRound(cs0, cs1, cm3, 0xc67178f2bef9A3f7ull, 0xa4506ceb90befffaull);
+    QuadRound(ds0, ds1, dm3, 0xc67178f2bef9A3f7ull, 0xa4506ceb90befffaull);
+    as0 = _mm_add_epi32(as0, _mm_load_si128((const __m128i*)INIT0));
+    bs0 = _mm_add_epi32(bs0, _mm_load_si128((const __m128i*)INIT0));
+    cs0 = _mm_add_epi32(cs0, _mm_load_si128((const __m128i*)INIT0));
+    ds0 = _mm_add_epi32(ds0, _mm_load_si128((const __m128i*)INIT0));
+    as1 = _mm_add_epi32(as1, _mm_load_si128((const __m128i*)INIT1));
+    bs1 = _mm_add_epi32(bs1, _mm_load_si128((const __m128i*)INIT1));
+    cs1 = _mm_add_epi32(cs1, _mm_load_si128((const __m128i*)INIT1));
+    ds1 = _mm_add_epi32(ds1, _mm_load_si128((const __m128i*)INIT1));
+
+    /* Transform 2 */
+    aso0 = as0;
+    bso0 = bs0;
+    cso0 = cs0;
+    dso0 = ds0;
+    aso1 = as1;
+    bso1 = bs1;
+    cso1 = cs1;
+    dso1 = ds1;
+    QuadRound(as0, as1, 0xe9b5dba5b5c0fbcfull, 0x71374491c28a2f98ull);
+    QuadRound(bs0, bs1, 0xe9b5dba5b5c0fbcfull, 0x71374491c28a2f98ull);
+    QuadRound(cs0, cs1, 0xe9b5dba5b5c0fbcfull, 0x71374491c28a2f98ull);
+    QuadRound(ds0, ds1, 0xe9b5dba5b5c0fbcfull, 0x71374491c28a2f98ull);
+    QuadRound(as0, as1, 0xab1c5ed5923f82a4ull, 0x59f111f13956c25bull);
+    QuadRound(bs0, bs1, 0xab1c5ed5923f82a4ull, 0x59f111f13956c25bull);
+    QuadRound(cs0, cs1, 0xab1c5ed5923f82a4ull, 0x59f111f13956c25bull);
+    QuadRound(ds0, ds1, 0xab1c5ed5923f82a4ull, 0x59f111f13956c25bull);
+    QuadRound(as0, as1, 0x550c7dc3243185beull, 0x12835b01d807aa98ull);
+    QuadRound(bs0, bs1, 0x550c7dc3243185beull, 0x12835b01d807aa98ull);
+    QuadRound(cs0, cs1, 0x550c7dc3243185beull, 0x12835b01d807aa98ull);
+    QuadRound(ds0, ds1, 0x550c7dc3243185beull, 0x12835b01d807aa98ull);
+    QuadRound(as0, as1, 0xc19bf3749bdc06a7ull, 0x80deb1fe72be5d74ull);
+    QuadRound(bs0, bs1, 0xc19bf3749bdc06a7ull, 0x80deb1fe72be5d74ull);
+    QuadRound(cs0, cs1, 0xc19bf3749bdc06a7ull, 0x80deb1fe72be5d74ull);
+    QuadRound(ds0, ds1, 0xc19bf3749bdc06a7ull, 0x80deb1fe72be5d74ull);
+    QuadRound(as0, as1, 0x240cf2540fe1edc6ull, 0xf0fe4786649b69c1ull);
+    QuadRound(bs0, bs1, 0x240cf2540fe1edc6ull, 0xf0fe4786649b69c1ull);
+    QuadRound(cs0, cs1, 0x240cf2540fe1edc6ull, 0xf0fe4786649b69c1ull);
+    QuadRound(ds0, ds1, 0x240cf2540fe1edc6ull, 0xf0fe4786649b69c1ull);
+    QuadRound(as0, as1, 0x16f988fa61b9411eull, 0x6cc984be4fe9346full);
+    QuadRound(bs0, bs1, 0x16f988fa61b9411eull, 0x6cc984be4fe9346full);
+    QuadRound(cs0, cs1, 0x16f988fa61b9411eull, 0x6cc984be4fe9346full);
+    QuadRound(ds0, ds1, 0x16f988fa61b9411eull, 0x6cc984be4fe9346full);
+    QuadRound(as0, as1, 0xb9d99ec7b019fc65ull, 0xa88e5a6df2c65152ull);
+    QuadRound(bs0, bs1, 0xb9d99ec7b019fc65ull, 0xa88e5a6df2c65152ull);
+    QuadRound(cs0, cs1, 0xb9d99ec7b019fc65ull, 0xa88e5a6df2c65152ull);
+    QuadRound(ds0, ds1, 0xb9d99ec7b019fc65ull, 0xa88e5a6df2c65152ull);
+    QuadRound(as0, as1, 0xc7353eb0fdb1232bull, 0xe70eeaa09a1231c3ull);
+    QuadRound(bs0, bs1, 0xc7353eb0fdb1232bull, 0xe70eeaa09a1231c3ull);
+    QuadRound(cs0, cs1, 0xc7353eb0fdb1232bull, 0xe70eeaa09a1231c3ull);
+    QuadRound(ds0, ds1, 0xc7353eb0fdb1232bull, 0xe70eeaa09a1231c3ull);
+    QuadRound(as0, as1, 0xdc1eeefd5a0f118full, 0xcb976d5f3069bad5ull);
+    QuadRound(bs0, bs1, 0xdc1eeefd5a0f118full, 0xcb976d5f3069bad5ull);
+    QuadRound(cs0, cs1, 0xdc1eeefd5a0f118full, 0xcb976d5f3069bad5ull);
+    QuadRound(ds0, ds1, 0xdc1eeefd5a0f118full, 0xcb976d5f3069bad5ull);
+    QuadRound(as0, as1, 0xe15d5b1658f4ca9dull, 0xde0b7a040a35b689ull);
+    QuadRound(bs0, bs1, 0xe15d5b1658f4ca9dull, 0xde0b7a040a35b689ull);
+    QuadRound(cs0, cs1, 0xe15d5b1658f4ca9dull, 0xde0b7a040a35b689ull);
+    QuadRound(ds0, ds1, 0xe15d5b1658f4ca9dull, 0xde0b7a040a35b689ull);
+    QuadRound(as0, as1, 0x6fab9537a507ea32ull, 0x37088980007f3e86ull);
+    QuadRound(bs0, bs1, 0x6fab9537a507ea32ull, 0x37088980007f3e86ull);
+    QuadRound(cs0, cs1, 0x6fab9537a507ea32ull, 0x37088980007f3e86ull);
+    QuadRound(ds0, ds1, 0x6fab9537a507ea32ull, 0x37088980007f3e86ull);
+    QuadRound(as0, as1, 0xc0bbbe37cdaa3b6dull, 0x0d8cd6f117406110ull);
+    QuadRound(bs0, bs1, 0xc0bbbe37cdaa3b6dull, 0x0d8cd6f117406110ull);
+    QuadRound(cs0, cs1, 0xc0bbbe37cdaa3b6dull, 0x0d8cd6f117406110ull);
+    QuadRound(ds0, ds1, 0xc0bbbe37cdaa3b6dull, 0x0d8cd6f117406110ull);
+    QuadRound(as0, as1, 0x6fd15ca70b02e931ull, 0xdb48a36383613bdaull);
+    QuadRound(bs0, bs1, 0x6fd15ca70b02e931ull, 0xdb48a36383613bdaull);
+    QuadRound(cs0, cs1, 0x6fd15ca70b02e931ull, 0xdb48a36383613bdaull);
+    QuadRound(ds0, ds1, 0x6fd15ca70b02e931ull, 0xdb48a36383613bdaull);
+    QuadRound(as0, as1, 0x6d4378906ed41a95ull, 0x31338431521afacaull);
+    QuadRound(bs0, bs1, 0x6d4378906ed41a95ull, 0x31338431521afacaull);
+    QuadRound(cs0, cs1, 0x6d4378906ed41a95ull, 0x31338431521afacaull);
+    QuadRound(ds0, ds1, 0x6d4378906ed41a95ull, 0x31338431521afacaull);
+    QuadRound(as0, as1, 0x532fb63cb5c9a0e6ull, 0x9eccabbdc39c91f2ull);
+    QuadRound(bs0, bs1, 0x532fb63cb5c9a0e6ull, 0x9eccabbdc39c91f2ull);
+    QuadRound(cs0, cs1, 0x532fb63cb5c9a0e6ull, 0x9eccabbdc39c91f2ull);
+    QuadRound(ds0, ds1, 0x532fb63cb5c9a0e6ull, 0x9eccabbdc39c91f2ull);
+    QuadRound(as0, as1, 0x4c191d76a4954b68ull, 0x07237ea3d2c741c6ull);
+    QuadRound(bs0, bs1, 0x4c191d76a4954b68ull, 0x07237ea3d2c741c6ull);
+    QuadRound(cs0, cs1, 0x4c191d76a4954b68ull, 0x07237ea3d2c741c6ull);
+    QuadRound(ds0, ds1, 0x4c191d76a4954b68ull, 0x07237ea3d2c741c6ull);
+    as0 = _mm_add_epi32(as0, aso0);
+    bs0 = _mm_add_epi32(bs0, bso0);
+    cs0 = _mm_add_epi32(cs0, cso0);
+    ds0 = _mm_add_epi32(ds0, dso0);
+    as1 = _mm_add_epi32(as1, aso1);
+    bs1 = _mm_add_epi32(bs1, bso1);
+    cs1 = _mm_add_epi32(cs1, cso1);
+    ds1 = _mm_add_epi32(ds1, dso1);
+
+    /* Extract hash */
+    Unshuffle(as0, as1);
+    Unshuffle(bs0, bs1);
+    Unshuffle(cs0, cs1);
+    Unshuffle(ds0, ds1);
+    am0 = as0;
+    bm0 = bs0;
+    cm0 = cs0;
+    dm0 = ds0;
+    am1 = as1;
+    bm1 = bs1;
+    cm1 = cs1;
+    dm1 = ds1;
+
+    /* Transform 3 */
+    ds0 = cs0 = bs0 = as0 = _mm_load_si128((const __m128i*)INIT0);
+    ds1 = cs1 = bs1 = as1 = _mm_load_si128((const __m128i*)INIT1);
+    QuadRound(as0, as1, am0, 0xe9b5dba5B5c0fbcfull, 0x71374491428a2f98ull);
+    QuadRound(bs0, bs1, bm0, 0xe9b5dba5B5c0fbcfull, 0x71374491428a2f98ull);
+    QuadRound(cs0, cs1, cm0, 0xe9b5dba5B5c0fbcfull, 0x71374491428a2f98ull);
+    QuadRound(ds0, ds1, dm0, 0xe9b5dba5B5c0fbcfull, 0x71374491428a2f98ull);
+    QuadRound(as0, as1, am1, 0xab1c5ed5923f82a4ull, 0x59f111f13956c25bull);
+    QuadRound(bs0, bs1, bm1, 0xab1c5ed5923f82a4ull, 0x59f111f13956c25bull);
+    QuadRound(cs0, cs1, cm1, 0xab1c5ed5923f82a4ull, 0x59f111f13956c25bull);
+    QuadRound(ds0, ds1, dm1, 0xab1c5ed5923f82a4ull, 0x59f111f13956c25bull);
+    ShiftMessageA(am0, am1);
+    ShiftMessageA(bm0, bm1);
+    ShiftMessageA(cm0, cm1);
+    ShiftMessageA(dm0, dm1);
+    dm2 = cm2 = bm2 = am2 = _mm_set_epi64x(0x0ull, 0x80000000ull);
+    QuadRound(as0, as1, 0x550c7dc3243185beull, 0x12835b015807aa98ull);
+    QuadRound(bs0, bs1, 0x550c7dc3243185beull, 0x12835b015807aa98ull);
+    QuadRound(cs0, cs1, 0x550c7dc3243185beull, 0x12835b015807aa98ull);
+    QuadRound(ds0, ds1, 0x550c7dc3243185beull, 0x12835b015807aa98ull);
+    ShiftMessageA(am1, am2);
+    ShiftMessageA(bm1, bm2);
+    ShiftMessageA(cm1, cm2);
+    ShiftMessageA(dm1, dm2);
+    dm3 = cm3 = bm3 = am3 = _mm_set_epi64x(0x10000000000ull, 0x0ull);
+    QuadRound(as0, as1, 0xc19bf2749bdc06a7ull, 0x80deb1fe72be5d74ull);
+    QuadRound(bs0, bs1, 0xc19bf2749bdc06a7ull, 0x80deb1fe72be5d74ull);
+    QuadRound(cs0, cs1, 0xc19bf2749bdc06a7ull, 0x80deb1fe72be5d74ull);
+    QuadRound(ds0, ds1, 0xc19bf2749bdc06a7ull, 0x80deb1fe72be5d74ull);
+    ShiftMessageB(am2, am3, am0);
+    ShiftMessageB(bm2, bm3, bm0);
+    ShiftMessageB(cm2, cm3, cm0);
+    ShiftMessageB(dm2, dm3, dm0);
+    QuadRound(as0, as1, am0, 0x240ca1cc0fc19dc6ull, 0xefbe4786e49b69c1ull);
+    QuadRound(bs0, bs1, bm0, 0x240ca1cc0fc19dc6ull, 0xefbe4786e49b69c1ull);
+    QuadRound(cs0, cs1, cm0, 0x240ca1cc0fc19dc6ull, 0xefbe4786e49b69c1ull);
+    QuadRound(ds0, ds1, dm0, 0x240ca1cc0fc19dc6ull, 0xefbe4786e49b69c1ull);
+    ShiftMessageB(am3, am0, am1);
+    ShiftMessageB(bm3, bm0, bm1);
+    ShiftMessageB(cm3, cm0, cm1);
+    ShiftMessageB(dm3, dm0, dm1);
+    QuadRound(as0, as1, am1, 0x76f988da5cb0a9dcull, 0x4a7484aa2de92c6full);
+    QuadRound(bs0, bs1, bm1, 0x76f988da5cb0a9dcull, 0x4a7484aa2de92c6full);
+    QuadRound(cs0, cs1, cm1, 0x76f988da5cb0a9dcull, 0x4a7484aa2de92c6full);
+    QuadRound(ds0, ds1, dm1, 0x76f988da5cb0a9dcull, 0x4a7484aa2de92c6full);
+    ShiftMessageB(am0, am1, am2);
+    ShiftMessageB(bm0, bm1, bm2);
+    ShiftMessageB(cm0, cm1, cm2);
+    ShiftMessageB(dm0, dm1, dm2);
+    QuadRound(as0, as1, am2, 0xbf597fc7b00327c8ull, 0xa831c66d983e5152ull);
+    QuadRound(bs0, bs1, bm2, 0xbf597fc7b00327c8ull, 0xa831c66d983e5152ull);
+    QuadRound(cs0, cs1, cm2, 0xbf597fc7b00327c8ull, 0xa831c66d983e5152ull);
+    QuadRound(ds0, ds1, dm2, 0xbf597fc7b00327c8ull, 0xa831c66d983e5152ull);
+    ShiftMessageB(am1, am2, am3);
+    ShiftMessageB(bm1, bm2, bm3);
+    ShiftMessageB(cm1, cm2, cm3);
+    ShiftMessageB(dm1, dm2, dm3);
+    QuadRound(as0, as1, am3, 0x1429296706ca6351ull, 0xd5a79147c6e00bf3ull);
+    QuadRound(bs0, bs1, bm3, 0x1429296706ca6351ull, 0xd5a79147c6e00bf3ull);
+    QuadRound(cs0, cs1, cm3, 0x1429296706ca6351ull, 0xd5a79147c6e00bf3ull);
+    QuadRound(ds0, ds1, dm3, 0x1429296706ca6351ull, 0xd5a79147c6e00bf3ull);
+    ShiftMessageB(am2, am3, am0);
+    ShiftMessageB(bm2, bm3, bm0);
+    ShiftMessageB(cm2, cm3, cm0);
+    ShiftMessageB(dm2, dm3, dm0);
+    QuadRound(as0, as1, am0, 0x53380d134d2c6dfcull, 0x2e1b213827b70a85ull);
+    QuadRound(bs0, bs1, bm0, 0x53380d134d2c6dfcull, 0x2e1b213827b70a85ull);
+    QuadRound(cs0, cs1, cm0, 0x53380d134d2c6dfcull, 0x2e1b213827b70a85ull);
+    QuadRound(ds0, ds1, dm0, 0x53380d134d2c6dfcull, 0x2e1b213827b70a85ull);
+    ShiftMessageB(am3, am0, am1);
+    ShiftMessageB(bm3, bm0, bm1);
+    ShiftMessageB(cm3, cm0, cm1);
+    ShiftMessageB(dm3, dm0, dm1);
+    QuadRound(as0, as1, am1, 0x92722c8581c2c92eull, 0x766a0abb650a7354ull);
+    QuadRound(bs0, bs1, bm1, 0x92722c8581c2c92eull, 0x766a0abb650a7354ull);
+    QuadRound(cs0, cs1, cm1, 0x92722c8581c2c92eull, 0x766a0abb650a7354ull);
+    QuadRound(ds0, ds1, dm1, 0x92722c8581c2c92eull, 0x766a0abb650a7354ull);
+    ShiftMessageB(am0, am1, am2);
+    ShiftMessageB(bm0, bm1, bm2);
+    ShiftMessageB(cm0, cm1, cm2);
+    ShiftMessageB(dm0, dm1, dm2);
+    QuadRound(as0, as1, am2, 0xc76c51a3c24b8b70ull, 0xa81a664ba2bfe8A1ull);
+    QuadRound(bs0, bs1, bm2, 0xc76c51a3c24b8b70ull, 0xa81a664ba2bfe8A1ull);
+    QuadRound(cs0, cs1, cm2, 0xc76c51a3c24b8b70ull, 0xa81a664ba2bfe8A1ull);
+    QuadRound(ds0, ds1, dm2, 0xc76c51a3c24b8b70ull, 0xa81a664ba2bfe8A1ull);
+    ShiftMessageB(am1, am2, am3);
+    ShiftMessageB(bm1, bm2, bm3);
+    ShiftMessageB(cm1, cm2, cm3);
+    ShiftMessageB(dm1, dm2, dm3);
+    QuadRound(as0, as1, am3, 0x106aa070f40e3585ull, 0xd6990624d192e819ull);
+    QuadRound(bs0, bs1, bm3, 0x106aa070f40e3585ull, 0xd6990624d192e819ull);
+    QuadRound(cs0, cs1, cm3, 0x106aa070f40e3585ull, 0xd6990624d192e819ull);
+    QuadRound(ds0, ds1, dm3, 0x106aa070f40e3585ull, 0xd6990624d192e819ull);
+    ShiftMessageB(am2, am3, am0);
+    ShiftMessageB(bm2, bm3, bm0);
+    ShiftMessageB(cm2, cm3, cm0);
+    ShiftMessageB(dm2, dm3, dm0);
+    QuadRound(as0, as1, am0, 0x34b0bcb52748774cull, 0x1e376c0819a4c116ull);
+    QuadRound(bs0, bs1, bm0, 0x34b0bcb52748774cull, 0x1e376c0819a4c116ull);
+    QuadRound(cs0, cs1, cm0, 0x34b0bcb52748774cull, 0x1e376c0819a4c116ull);
+    QuadRound(ds0, ds1, dm0, 0x34b0bcb52748774cull, 0x1e376c0819a4c116ull);
+    ShiftMessageB(am3, am0, am1);
+    ShiftMessageB(bm3, bm0, bm1);
+    ShiftMessageB(cm3, cm0, cm1);
+    ShiftMessageB(dm3, dm0, dm1);
+    QuadRound(as0, as1, am1, 0x682e6ff35b9cca4full, 0x4ed8aa4a391c0cb3ull);
+    QuadRound(bs0, bs1, bm1, 0x682e6ff35b9cca4full, 0x4ed8aa4a391c0cb3ull);
+    QuadRound(cs0, cs1, cm1, 0x682e6ff35b9cca4full, 0x4ed8aa4a391c0cb3ull);
+    QuadRound(ds0, ds1, dm1, 0x682e6ff35b9cca4full, 0x4ed8aa4a391c0cb3ull);
+    ShiftMessageC(am0, am1, am2);
+    ShiftMessageC(bm0, bm1, bm2);
+    ShiftMessageC(cm0, cm1, cm2);
+    ShiftMessageC(dm0, dm1, dm2);
+    QuadRound(as0, as1, am2, 0x8cc7020884c87814ull, 0x78a5636f748f82eeull);
+    QuadRound(bs0, bs1, bm2, 0x8cc7020884c87814ull, 0x78a5636f748f82eeull);
+    QuadRound(cs0, cs1, cm2, 0x8cc7020884c87814ull, 0x78a5636f748f82eeull);
+    QuadRound(ds0, ds1, dm2, 0x8cc7020884c87814ull, 0x78a5636f748f82eeull);
+    ShiftMessageC(am1, am2, am3);
+    ShiftMessageC(bm1, bm2, bm3);
+    ShiftMessageC(cm1, cm2, cm3);
+    ShiftMessageC(dm1, dm2, dm3);
+    QuadRound(as0, as1, am3, 0xc67178f2bef9a3f7ull, 0xa4506ceb90befffaull);
+    QuadRound(bs0, bs1, bm3, 0xc67178f2bef9a3f7ull, 0xa4506ceb90befffaull);
+    QuadRound(cs0, cs1, cm3, 0xc67178f2bef9a3f7ull, 0xa4506ceb90befffaull);
+    QuadRound(ds0, ds1, dm3, 0xc67178f2bef9a3f7ull, 0xa4506ceb90befffaull);
+    as0 = _mm_add_epi32(as0, _mm_load_si128((const __m128i*)INIT0));
+    bs0 = _mm_add_epi32(bs0, _mm_load_si128((const __m128i*)INIT0));
+    cs0 = _mm_add_epi32(cs0, _mm_load_si128((const __m128i*)INIT0));
+    ds0 = _mm_add_epi32(ds0, _mm_load_si128((const __m128i*)INIT0));
+    as1 = _mm_add_epi32(as1, _mm_load_si128((const __m128i*)INIT1));
+    bs1 = _mm_add_epi32(bs1, _mm_load_si128((const __m128i*)INIT1));
+    cs1 = _mm_add_epi32(cs1, _mm_load_si128((const __m128i*)INIT1));
+    ds1 = _mm_add_epi32(ds1, _mm_load_si128((const __m128i*)INIT1));
+
+    /* Extract hash into out */
+    Unshuffle(as0, as1);
+    Unshuffle(bs0, bs1);
+    Unshuffle(cs0, cs1);
+    Unshuffle(ds0, ds1);
+    Save(out, as0);
+    Save(out + 16, as1);
+    Save(out + 32, bs0);
+    Save(out + 48, bs1);
+    Save(out + 64, cs0);
+    Save(out + 80, cs1);
+    Save(out + 96, ds0);
+    Save(out + 112, ds1);
+}
+
 }
 
 #endif
@@ -13,6 +13,8 @@
 #include <cmath>
 #include <cstring>
 #include <memory>
+#include <thread>
+#include <type_traits>
 #include <utility>
 #include <vector>
 
@@ -25,6 +27,9 @@
  *
  * 2. @ref cache is a cache which is performant in memory usage and lookup speed. It
  * is lockfree for erase operations. Elements are lazily erased on the next insert.
+ *
+ * 3. @ref concurrent_cache is a variant of @ref cache which is also lockfree for
+ * lookups and inserts, at the cost of a per-slot sequence number.
  */
 namespace CuckooCache
 {
@@ -475,6 +480,299 @@ public:
         return false;
     }
 };
+
+/** @ref concurrent_cache is a @ref cache that may be used from several threads
+ * at once without external locking: any number of threads may call insert and
+ * contains concurrently. Only setup and setup_bytes need exclusive access.
+ *
+ * Each slot is guarded by a sequence number (a seqlock). A writer makes it odd
+ * while it replaces the slot's element and even again afterwards, so writers
+ * to the same slot exclude each other and a reader can tell whether the words
+ * it read belong to a single element. Readers never wait: a slot that is being
+ * written is treated as not containing the element, and the reader moves on.
+ *
+ * Epochs work as in @ref cache, with the epoch flags also kept in a
+ * bit_packed_atomic_flags. The periodic epoch scan is done by whichever
+ * inserting thread finds it due, while other threads keep inserting.
+ *
+ * Compared to @ref cache, concurrency weakens its guarantees as follows, which
+ * only costs hit rate and never yields a false positive:
+ *   - An element that is being moved by a cuckoo eviction, or whose slot is
+ *     being written, is briefly not found.
+ *   - contains(e, true) may race with an insert that replaced e, and mark the
+ *     new element for erasure instead.
+ *   - Two threads inserting the same element at once may each store a copy.
+ *
+ * @tparam Element should be a trivially copyable type that is compared by its
+ * object representation (e.g. uint256), with a size that is a multiple of 4
+ * bytes.
+ * @tparam Hash as for @ref cache.
+ */
+template <typename Element, typename Hash>
+class concurrent_cache
+{
+private:
+    static_assert(std::is_trivially_copyable_v<Element>, "Element is copied word by word");
+    static_assert(sizeof(Element) % sizeof(uint32_t) == 0, "Element is copied word by word");
+    static constexpr size_t WORDS{sizeof(Element) / sizeof(uint32_t)};
+
+    /** A slot of the table: an element, stored as atomic words, and its sequence number. */
+    struct Slot {
+        std::atomic<uint32_t> seq{0};
+        std::array<std::atomic<uint32_t>, WORDS> words{};
+    };
+
+    /** table stores all the elements */
+    std::unique_ptr<Slot[]> table;
+
+    /** size stores the total available slots in the hash table */
+    uint32_t size;
+
+    /** See @ref cache::collection_flags. */
+    mutable bit_packed_atomic_flags collection_flags;
+
+    /** old_epoch_flags tracks how recently an element was inserted into the
+     * cache. A set flag denotes not-recent, and is the inverse of
+     * @ref cache::epoch_flags (as bit_packed_atomic_flags start out set).
+     */
+    mutable bit_packed_atomic_flags old_epoch_flags;
+
+    /** See @ref cache::epoch_heuristic_counter. */
+    std::atomic<uint32_t> epoch_heuristic_counter;
+
+    /** epoch_scan_busy is set while a thread does the epoch scan. */
+    std::atomic<bool> epoch_scan_busy;
+
+    /** See @ref cache::epoch_size. */
+    uint32_t epoch_size;
+
+    /** See @ref cache::depth_limit. */
+    uint8_t depth_limit;
+
+    const Hash hash_function;
+
+    inline std::array<uint32_t, 8> compute_hashes(const Element& e) const
+    {
+        return {{FastRange32(hash_function.template operator()<0>(e), size),
+                 FastRange32(hash_function.template operator()<1>(e), size),
+                 FastRange32(hash_function.template operator()<2>(e), size),
+                 FastRange32(hash_function.template operator()<3>(e), size),
+                 FastRange32(hash_function.template operator()<4>(e), size),
+                 FastRange32(hash_function.template operator()<5>(e), size),
+                 FastRange32(hash_function.template operator()<6>(e), size),
+                 FastRange32(hash_function.template operator()<7>(e), size)}};
+    }
+
+    constexpr uint32_t invalid() const
+    {
+        return ~(uint32_t)0;
+    }
+
+    /** matches returns whether the slot at index `n` holds `e`. A slot that
+     * is being written does not match anything.
+     */
+    bool matches(uint32_t n, const Element& e) const
+    {
+        const Slot& slot = table[n];
+        const uint32_t seq = slot.seq.load(std::memory_order_acquire);
+        if (seq & 1) return false;
+        std::array<uint32_t, WORDS> words;
+        std::memcpy(words.data(), &e, sizeof(Element));
+        // Most slots differ in the first word. A mismatch needs no check for a
+        // concurrent write, as not finding an element is always safe.
+        for (size_t i = 0; i < WORDS; ++i)
+            if (slot.words[i].load(std::memory_order_relaxed) != words[i]) return false;
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return slot.seq.load(std::memory_order_relaxed) == seq;
+    }
+
+    /** lock acquires the slot at index `n` for writing, waiting for any other
+     * writer to finish. Returns its sequence number to pass to unlock.
+     */
+    uint32_t lock(uint32_t n)
+    {
+        std::atomic<uint32_t>& seq = table[n].seq;
+        uint32_t expected = seq.load(std::memory_order_relaxed);
+        while ((expected & 1) || !seq.compare_exchange_weak(expected, expected + 1, std::memory_order_acquire, std::memory_order_relaxed)) {
+            if (expected & 1) {
+                std::this_thread::yield();
+                expected = seq.load(std::memory_order_relaxed);
+            }
+        }
+        // Order the following element stores after the sequence number store.
+        std::atomic_thread_fence(std::memory_order_release);
+        return expected + 1;
+    }
+
+    void unlock(uint32_t n, uint32_t seq)
+    {
+        table[n].seq.store(seq + 1, std::memory_order_release);
+    }
+
+    /** write stores `e` at index `n`, which must be locked. */
+    void write(uint32_t n, const Element& e)
+    {
+        std::array<uint32_t, WORDS> words;
+        std::memcpy(words.data(), &e, sizeof(Element));
+        for (size_t i = 0; i < WORDS; ++i)
+            table[n].words[i].store(words[i], std::memory_order_relaxed);
+    }
+
+    /** read_locked returns the element at index `n`, which must be locked. */
+    Element read_locked(uint32_t n) const
+    {
+        std::array<uint32_t, WORDS> words;
+        for (size_t i = 0; i < WORDS; ++i)
+            words[i] = table[n].words[i].load(std::memory_order_relaxed);
+        Element e;
+        std::memcpy(&e, words.data(), sizeof(Element));
+        return e;
+    }
+
+    inline void allow_erase(uint32_t n) const
+    {
+        collection_flags.bit_set(n);
+    }
+
+    inline void please_keep(uint32_t n) const
+    {
+        collection_flags.bit_unset(n);
+    }
+
+    inline void set_epoch(uint32_t n, bool old) const
+    {
+        if (old) {
+            old_epoch_flags.bit_set(n);
+        } else {
+            old_epoch_flags.bit_unset(n);
+        }
+    }
+
+    /** epoch_check works as @ref cache::epoch_check. Only one thread at a time
+     * scans the table; others calling it in the meantime return right away.
+     */
+    void epoch_check()
+    {
+        uint32_t counter = epoch_heuristic_counter.load(std::memory_order_relaxed);
+        while (counter != 0) {
+            if (epoch_heuristic_counter.compare_exchange_weak(counter, counter - 1, std::memory_order_relaxed)) return;
+        }
+        if (epoch_scan_busy.exchange(true, std::memory_order_acquire)) return;
+        uint32_t epoch_unused_count = 0;
+        for (uint32_t i = 0; i < size; ++i)
+            epoch_unused_count += !old_epoch_flags.bit_is_set(i) &&
+                                  !collection_flags.bit_is_set(i);
+        if (epoch_unused_count >= epoch_size) {
+            for (uint32_t i = 0; i < size; ++i)
+                if (!old_epoch_flags.bit_is_set(i))
+                    old_epoch_flags.bit_set(i);
+                else
+                    allow_erase(i);
+            epoch_heuristic_counter.store(epoch_size, std::memory_order_relaxed);
+        } else {
+            epoch_heuristic_counter.store(std::max(1u, std::max(epoch_size / 16, epoch_size - epoch_unused_count)),
+                                          std::memory_order_relaxed);
+        }
+        epoch_scan_busy.store(false, std::memory_order_release);
+    }
+
+public:
+    /** You must always construct a cache with some elements via a subsequent
+     * call to setup or setup_bytes, otherwise operations may segfault.
+     */
+    concurrent_cache() : table(), size(), collection_flags(0), old_epoch_flags(0),
+    epoch_heuristic_counter(), epoch_scan_busy(false), epoch_size(), depth_limit(0), hash_function()
+    {
+    }
+
+    /** setup works as @ref cache::setup. It must not be called concurrently
+     * with any other method.
+     */
+    uint32_t setup(uint32_t new_size)
+    {
+        depth_limit = static_cast<uint8_t>(std::log2(static_cast<float>(std::max((uint32_t)2, new_size))));
+        size = std::max<uint32_t>(2, new_size);
+        table.reset(new Slot[size]);
+        collection_flags.setup(size);
+        old_epoch_flags.setup(size);
+        epoch_size = std::max((uint32_t)1, (45 * size) / 100);
+        epoch_heuristic_counter.store(epoch_size, std::memory_order_relaxed);
+        return size;
+    }
+
+    /** setup_bytes works as @ref cache::setup_bytes, accounting for the
+     * sequence number of each slot.
+     */
+    uint32_t setup_bytes(size_t bytes)
+    {
+        return setup(bytes / sizeof(Slot));
+    }
+
+    /** insert works as @ref cache::insert. Each slot is only locked while its
+     * element is replaced, and the element evicted from it is carried on to
+     * the next slot without holding any lock.
+     */
+    inline void insert(Element e)
+    {
+        epoch_check();
+        uint32_t last_loc = invalid();
+        bool last_epoch_old = false;
+        std::array<uint32_t, 8> locs = compute_hashes(e);
+        for (const uint32_t loc : locs) {
+            if (matches(loc, e)) {
+                please_keep(loc);
+                set_epoch(loc, false);
+                return;
+            }
+        }
+        for (uint8_t depth = 0; depth < depth_limit; ++depth) {
+            // First try to insert to an empty slot, if one exists
+            for (const uint32_t loc : locs) {
+                if (!collection_flags.bit_is_set(loc))
+                    continue;
+                const uint32_t seq = lock(loc);
+                // Another thread may have claimed the slot in the meantime.
+                const bool empty = collection_flags.bit_is_set(loc);
+                if (empty) {
+                    write(loc, e);
+                    please_keep(loc);
+                    set_epoch(loc, last_epoch_old);
+                }
+                unlock(loc, seq);
+                if (empty) return;
+            }
+            // Swap with the element at the location that was not the last one
+            // looked at, as in cache::insert.
+            last_loc = locs[(1 + (std::find(locs.begin(), locs.end(), last_loc) - locs.begin())) & 7];
+            const uint32_t seq = lock(last_loc);
+            const Element evicted = read_locked(last_loc);
+            write(last_loc, e);
+            const bool epoch_old = last_epoch_old;
+            last_epoch_old = old_epoch_flags.bit_is_set(last_loc);
+            set_epoch(last_loc, epoch_old);
+            unlock(last_loc, seq);
+            e = evicted;
+
+            locs = compute_hashes(e);
+        }
+    }
+
+    /** contains works as @ref cache::contains, except that it may miss an
+     * element that is being moved or overwritten by a concurrent insert.
+     */
+    inline bool contains(const Element& e, const bool erase) const
+    {
+        std::array<uint32_t, 8> locs = compute_hashes(e);
+        for (const uint32_t loc : locs) {
+            if (matches(loc, e)) {
+                if (erase)
+                    allow_erase(loc);
+                return true;
+            }
+        }
+        return false;
+    }
+};
 } // namespace CuckooCache
 
 #endif // BITCOIN_CUCKOOCACHE_H
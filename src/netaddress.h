@@ -25,11 +25,13 @@
 #include <string>
 #include <vector>
 
+class CompiledASMap;
+
 /**
  * A flag that is ORed into the protocol version to designate that addresses
  * should be serialized in (unserialized from) v2 format (BIP155).
  * Make sure that this does not collide with any of the values in `version.h`
- * or with `SERIALIZE_TRANSACTION_NO_WITNESS`.
+ * or with `SERIALIZE_TRANSACTION_NO_WITNESS` or `SERIALIZE_TRANSACTION_LAZY_HASH`.
  */
 static constexpr int ADDRV2_FORMAT = 0x20000000;
 
@@ -205,9 +207,9 @@ public:
     // The AS on the BGP path to the node we use to diversify
     // peers in AddrMan bucketing based on the AS infrastructure.
     // The ip->AS mapping depends on how asmap is constructed.
-    uint32_t GetMappedAS(const std::vector<bool>& asmap) const;
+    uint32_t GetMappedAS(const CompiledASMap& asmap) const;
 
-    std::vector<unsigned char> GetGroup(const std::vector<bool>& asmap) const;
+    std::vector<unsigned char> GetGroup(const CompiledASMap& asmap) const;
     std::vector<unsigned char> GetAddrBytes() const;
     int GetReachabilityFrom(const CNetAddr* paddrPartner = nullptr) const;
 
@@ -252,6 +254,7 @@ public:
         }
     }
 
+    friend class BanIndex;
     friend class CSubNet;
 
 private:
@@ -521,6 +524,8 @@ public:
     friend bool operator==(const CSubNet& a, const CSubNet& b);
     friend bool operator!=(const CSubNet& a, const CSubNet& b) { return !(a == b); }
     friend bool operator<(const CSubNet& a, const CSubNet& b);
+
+    friend class BanIndex;
 };
 
 /** A combination of a network address (CNetAddr) and a (TCP) port */
@@ -0,0 +1,84 @@
+// Copyright (c) 2022 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <node/blockmap.h>
+
+#include <memusage.h>
+
+#include <algorithm>
+#include <cassert>
+#include <limits>
+
+namespace node {
+
+void BlockMap::clear()
+{
+    m_chunks.clear();
+    m_table.assign(MIN_TABLE_SIZE, 0);
+    m_size = 0;
+}
+
+void BlockMap::reserve(size_t n)
+{
+    size_t table_size{m_table.size()};
+    while (n * 4 > table_size * 3) table_size *= 2;
+    if (table_size != m_table.size()) Rehash(table_size);
+}
+
+size_t BlockMap::FindSlot(const uint256& hash) const
+{
+    const size_t mask{m_table.size() - 1};
+    for (size_t slot{m_hasher(hash) & mask};; slot = (slot + 1) & mask) {
+        const uint32_t entry{m_table[slot]};
+        if (entry == 0 || At(entry - 1).first == hash) return slot;
+    }
+}
+
+size_t BlockMap::FindPos(const uint256& hash) const
+{
+    const uint32_t entry{m_table[FindSlot(hash)]};
+    return entry == 0 ? m_size : entry - 1;
+}
+
+void BlockMap::Rehash(size_t table_size)
+{
+    assert(m_size < std::numeric_limits<uint32_t>::max());
+    m_table.assign(table_size, 0);
+    const size_t mask{table_size - 1};
+    for (size_t pos = 0; pos < m_size; ++pos) {
+        size_t slot{m_hasher(At(pos).first) & mask};
+        while (m_table[slot] != 0) slot = (slot + 1) & mask;
+        m_table[slot] = static_cast<uint32_t>(pos + 1);
+    }
+}
+
+void BlockMap::ReorderByHeight()
+{
+    std::vector<value_type*> sorted;
+    sorted.reserve(m_size);
+    for (value_type& entry : *this) sorted.push_back(&entry);
+    std::stable_sort(sorted.begin(), sorted.end(), [](const value_type* a, const value_type* b) {
+        return a->second.nHeight < b->second.nHeight;
+    });
+
+    BlockMap reordered;
+    reordered.reserve(m_size);
+    for (const value_type* entry : sorted) {
+        reordered.try_emplace(entry->first, entry->second);
+    }
+    for (auto& [hash, index] : reordered) {
+        index.phashBlock = &hash;
+        if (index.pprev) index.pprev = &reordered.find(index.pprev->GetBlockHash())->second;
+        if (index.pskip) index.pskip = &reordered.find(index.pskip->GetBlockHash())->second;
+    }
+    *this = std::move(reordered);
+}
+
+size_t BlockMap::DynamicMemoryUsage() const
+{
+    return memusage::DynamicUsage(m_chunks) + m_chunks.size() * memusage::MallocUsage(CHUNK_SIZE * sizeof(value_type)) +
+           memusage::DynamicUsage(m_table);
+}
+
+} // namespace node
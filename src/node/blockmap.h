@@ -0,0 +1,173 @@
+// Copyright (c) 2022 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_NODE_BLOCKMAP_H
+#define BITCOIN_NODE_BLOCKMAP_H
+
+#include <chain.h>
+#include <uint256.h>
+#include <util/hasher.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+namespace node {
+
+/**
+ * Container for all CBlockIndex entries, keyed by block hash.
+ *
+ * Entries are stored in insertion order in an arena of fixed-size chunks, so
+ * that they never move once inserted (validation code keeps pointers to them)
+ * and iterating over all of them walks contiguous memory. Lookups go through
+ * an open-addressing hash table of 32-bit positions into the arena, which is
+ * considerably smaller than a node-based map with its per-entry allocation,
+ * bucket pointer and cached hash.
+ *
+ * The interface is the subset of std::unordered_map that is used for the
+ * block index. Entries cannot be erased.
+ */
+class BlockMap
+{
+public:
+    using key_type = uint256;
+    using mapped_type = CBlockIndex;
+    using value_type = std::pair<const uint256, CBlockIndex>;
+    using size_type = size_t;
+
+private:
+    //! Number of entries per arena chunk, as a power of two.
+    static constexpr int CHUNK_BITS{12};
+    static constexpr size_t CHUNK_SIZE{size_t{1} << CHUNK_BITS};
+
+    template <typename Map, typename Value>
+    class IteratorImpl
+    {
+        friend class BlockMap;
+
+        Map* m_map{nullptr};
+        size_t m_pos{0};
+
+        IteratorImpl(Map* map, size_t pos) : m_map{map}, m_pos{pos} {}
+
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = BlockMap::value_type;
+        using difference_type = std::ptrdiff_t;
+        using pointer = Value*;
+        using reference = Value&;
+
+        IteratorImpl() = default;
+
+        //! Allow conversion from iterator to const_iterator.
+        operator IteratorImpl<const Map, const Value>() const { return {m_map, m_pos}; }
+
+        reference operator*() const { return m_map->At(m_pos); }
+        pointer operator->() const { return &m_map->At(m_pos); }
+        IteratorImpl& operator++()
+        {
+            ++m_pos;
+            return *this;
+        }
+        IteratorImpl operator++(int)
+        {
+            IteratorImpl ret{*this};
+            ++m_pos;
+            return ret;
+        }
+        friend bool operator==(const IteratorImpl& a, const IteratorImpl& b) { return a.m_pos == b.m_pos; }
+        friend bool operator!=(const IteratorImpl& a, const IteratorImpl& b) { return a.m_pos != b.m_pos; }
+    };
+
+public:
+    using iterator = IteratorImpl<BlockMap, value_type>;
+    using const_iterator = IteratorImpl<const BlockMap, const value_type>;
+
+    BlockMap() = default;
+    BlockMap(BlockMap&&) = default;
+    BlockMap& operator=(BlockMap&&) = default;
+    BlockMap(const BlockMap&) = delete;
+    BlockMap& operator=(const BlockMap&) = delete;
+
+    iterator begin() { return {this, 0}; }
+    iterator end() { return {this, m_size}; }
+    const_iterator begin() const { return {this, 0}; }
+    const_iterator end() const { return {this, m_size}; }
+
+    size_t size() const { return m_size; }
+    bool empty() const { return m_size == 0; }
+
+    //! Remove all entries. This invalidates all pointers to them.
+    void clear();
+
+    //! Make room in the hash table for n entries.
+    void reserve(size_t n);
+
+    iterator find(const uint256& hash) { return {this, FindPos(hash)}; }
+    const_iterator find(const uint256& hash) const { return {this, FindPos(hash)}; }
+    size_t count(const uint256& hash) const { return FindPos(hash) != m_size; }
+
+    /**
+     * Insert a CBlockIndex constructed from args under hash, unless an entry
+     * with that hash exists already. Returns an iterator to the entry with
+     * that hash and whether it was inserted.
+     */
+    template <typename... Args>
+    std::pair<iterator, bool> try_emplace(const uint256& hash, Args&&... args)
+    {
+        size_t slot{FindSlot(hash)};
+        if (m_table[slot] != 0) return {iterator{this, m_table[slot] - size_t{1}}, false};
+        if ((m_size + 1) * 4 > m_table.size() * 3) {
+            Rehash(m_table.size() * 2);
+            slot = FindSlot(hash);
+        }
+        if (m_size % CHUNK_SIZE == 0) {
+            m_chunks.emplace_back().reserve(CHUNK_SIZE);
+        }
+        m_chunks.back().emplace_back(std::piecewise_construct,
+                                     std::forward_as_tuple(hash),
+                                     std::forward_as_tuple(std::forward<Args>(args)...));
+        m_table[slot] = static_cast<uint32_t>(++m_size);
+        return {iterator{this, m_size - 1}, true};
+    }
+
+    /**
+     * Move all entries into height order, so that walking pprev chains and
+     * iterating over the index touch memory in the same order, and fix up the
+     * phashBlock, pprev and pskip pointers of all entries.
+     *
+     * Only valid while nothing outside of the map points to its entries (e.g.
+     * right after loading it from disk), as all such pointers are invalidated.
+     */
+    void ReorderByHeight();
+
+    //! Approximate dynamic memory usage of the map.
+    size_t DynamicMemoryUsage() const;
+
+private:
+    value_type& At(size_t pos) { return m_chunks[pos >> CHUNK_BITS][pos & (CHUNK_SIZE - 1)]; }
+    const value_type& At(size_t pos) const { return m_chunks[pos >> CHUNK_BITS][pos & (CHUNK_SIZE - 1)]; }
+
+    //! Return the table slot holding hash, or the empty slot it would be inserted at.
+    size_t FindSlot(const uint256& hash) const;
+    //! Return the arena position of hash, or m_size if it is not present.
+    size_t FindPos(const uint256& hash) const;
+    void Rehash(size_t table_size);
+
+    //! The arena. Each chunk is allocated with capacity CHUNK_SIZE and never reallocated.
+    std::vector<std::vector<value_type>> m_chunks;
+    //! Hash table of arena positions plus one; 0 marks an empty slot. Its size is a power of two.
+    std::vector<uint32_t> m_table{std::vector<uint32_t>(MIN_TABLE_SIZE)};
+    size_t m_size{0};
+    BlockHasher m_hasher;
+
+    static constexpr size_t MIN_TABLE_SIZE{64};
+};
+
+} // namespace node
+
+#endif // BITCOIN_NODE_BLOCKMAP_H
@@ -0,0 +1,272 @@
+// Copyright (c) 2022 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <node/candidateblock.h>
+
+#include <chain.h>
+#include <chainparams.h>
+#include <consensus/consensus.h>
+#include <consensus/tx_verify.h>
+#include <consensus/validation.h>
+#include <script/script.h>
+#include <txmempool.h>
+#include <validation.h>
+
+#include <algorithm>
+#include <limits>
+#include <string>
+#include <unordered_set>
+#include <utility>
+
+namespace node {
+CandidateBlock::CandidateBlock(ChainstateManager& chainman, const CTxMemPool& mempool, const CChainParams& params, const BlockAssembler::Options& options)
+    : m_chainman{chainman},
+      m_mempool{mempool},
+      m_params{params},
+      m_options{options},
+      // Limit weight to between 4K and MAX_BLOCK_WEIGHT-4K for sanity, as BlockAssembler does:
+      m_max_weight{std::max<size_t>(4000, std::min<size_t>(MAX_BLOCK_WEIGHT - 4000, options.nBlockMaxWeight))},
+      m_lowest_feerate{options.blockMinFeeRate}
+{
+}
+
+std::unique_ptr<CBlockTemplate> CandidateBlock::Assemble(const CScript& scriptPubKeyIn)
+{
+    AssertLockHeld(::cs_main);
+    AssertLockHeld(m_mutex);
+
+    BlockAssembler assembler{m_chainman.ActiveChainstate(), m_mempool, m_params, m_options};
+    std::unique_ptr<CBlockTemplate> block_template{assembler.CreateNewBlock(scriptPubKeyIn)};
+
+    const CBlockIndex* tip{m_chainman.ActiveChain().Tip()};
+    m_tip = tip->GetBlockHash();
+    m_height = tip->nHeight + 1;
+    m_lock_time_cutoff = tip->GetMedianTimePast();
+
+    // Reserve space for coinbase tx, as BlockAssembler does
+    m_weight = 4000;
+    m_sigops_cost = 400;
+    m_fees = 0;
+    m_entries.clear();
+    m_positions.clear();
+    const CBlock& block{block_template->block};
+    for (size_t i = 1; i < block.vtx.size(); ++i) {
+        Append(block.vtx[i], block_template->vTxFees[i], block_template->vTxSigOpsCost[i], GetTransactionWeight(*block.vtx[i]));
+    }
+    m_lowest_feerate = assembler.GetLowestPackageFeeRate().value_or(m_options.blockMinFeeRate);
+    m_fee_shortfall = 0;
+    m_valid = true;
+    return block_template;
+}
+
+void CandidateBlock::Append(const CTransactionRef& tx, CAmount fee, int64_t sigops_cost, int64_t weight)
+{
+    AssertLockHeld(m_mutex);
+    m_positions.emplace(tx->GetHash(), m_entries.size());
+    m_entries.push_back({tx, fee, sigops_cost, weight});
+    m_weight += weight;
+    m_sigops_cost += sigops_cost;
+    m_fees += fee;
+}
+
+uint64_t CandidateBlock::Drop(const uint256& txid)
+{
+    AssertLockHeld(m_mutex);
+    const auto it{m_positions.find(txid)};
+    if (it == m_positions.end()) return 0;
+
+    // Descendants always come later in the block, so one pass from the
+    // transaction onwards finds all of them.
+    std::unordered_set<uint256, SaltedTxidHasher> dropped{txid};
+    uint64_t freed{0};
+    for (size_t i = it->second; i < m_entries.size(); ++i) {
+        Entry& entry{m_entries[i]};
+        if (!entry.tx) continue;
+        const bool drop{dropped.count(entry.tx->GetHash()) > 0 ||
+                        std::any_of(entry.tx->vin.begin(), entry.tx->vin.end(), [&](const CTxIn& txin) { return dropped.count(txin.prevout.hash) > 0; })};
+        if (!drop) continue;
+        dropped.insert(entry.tx->GetHash());
+        m_positions.erase(entry.tx->GetHash());
+        freed += entry.weight;
+        m_sigops_cost -= entry.sigops_cost;
+        m_fees -= entry.fee;
+        entry.tx.reset();
+    }
+    m_weight -= freed;
+
+    // Compact once at least half of the entries are dropped ones.
+    if (m_positions.size() * 2 <= m_entries.size()) {
+        m_entries.erase(std::remove_if(m_entries.begin(), m_entries.end(), [](const Entry& entry) { return !entry.tx; }), m_entries.end());
+        for (size_t i = 0; i < m_entries.size(); ++i) m_positions[m_entries[i].tx->GetHash()] = i;
+    }
+    return freed;
+}
+
+bool CandidateBlock::MakeRoom(uint64_t weight, int64_t sigops_cost, CAmount fees, std::unordered_set<uint256, SaltedTxidHasher> spent)
+{
+    AssertLockHeld(m_mutex);
+    // Only transactions nothing else in the candidate (or the package) spends
+    // can be dropped without taking others with them.
+    for (const Entry& entry : m_entries) {
+        if (!entry.tx) continue;
+        for (const CTxIn& txin : entry.tx->vin) spent.insert(txin.prevout.hash);
+    }
+    std::vector<const Entry*> leaves;
+    for (const Entry& entry : m_entries) {
+        if (entry.tx && !spent.count(entry.tx->GetHash())) leaves.push_back(&entry);
+    }
+    std::sort(leaves.begin(), leaves.end(), [](const Entry* a, const Entry* b) { return a->fee * b->weight < b->fee * a->weight; });
+
+    uint64_t freed_weight{0};
+    int64_t freed_sigops_cost{0};
+    CAmount lost_fees{0};
+    std::vector<uint256> to_drop;
+    for (const Entry* leaf : leaves) {
+        if (m_weight - freed_weight + weight < m_max_weight && m_sigops_cost - freed_sigops_cost + sigops_cost < MAX_BLOCK_SIGOPS_COST) break;
+        lost_fees += leaf->fee;
+        if (lost_fees >= fees) return false;
+        freed_weight += leaf->weight;
+        freed_sigops_cost += leaf->sigops_cost;
+        to_drop.push_back(leaf->tx->GetHash());
+    }
+    if (m_weight - freed_weight + weight >= m_max_weight || m_sigops_cost - freed_sigops_cost + sigops_cost >= MAX_BLOCK_SIGOPS_COST) return false;
+
+    for (const uint256& txid : to_drop) Drop(txid);
+    // Whatever the package leaves of the freed space could be filled by other transactions.
+    m_fee_shortfall += m_lowest_feerate.GetFee((m_max_weight - m_weight - weight) / WITNESS_SCALE_FACTOR);
+    return true;
+}
+
+bool CandidateBlock::ShortfallExceeded() const
+{
+    AssertLockHeld(m_mutex);
+    return m_fee_shortfall * 100 > m_fees * MAX_FEE_SHORTFALL_PERCENT;
+}
+
+std::unique_ptr<CBlockTemplate> CandidateBlock::CreateNewBlock(const CScript& scriptPubKeyIn)
+{
+    LOCK(::cs_main);
+    LOCK(m_mutex);
+    m_requested = true;
+
+    const CBlockIndex* tip{m_chainman.ActiveChain().Tip()};
+    assert(tip != nullptr);
+    if (!m_valid || tip->GetBlockHash() != m_tip) return Assemble(scriptPubKeyIn);
+
+    auto block_template{std::make_unique<CBlockTemplate>()};
+    CBlock& block{block_template->block};
+    block.vtx.reserve(m_positions.size() + 1);
+    block_template->vTxFees.reserve(m_positions.size() + 1);
+    block_template->vTxSigOpsCost.reserve(m_positions.size() + 1);
+
+    // Add dummy coinbase tx as first transaction
+    block.vtx.emplace_back();
+    block_template->vTxFees.push_back(-1);
+    block_template->vTxSigOpsCost.push_back(-1);
+    for (const Entry& entry : m_entries) {
+        if (!entry.tx) continue;
+        block.vtx.push_back(entry.tx);
+        block_template->vTxFees.push_back(entry.fee);
+        block_template->vTxSigOpsCost.push_back(entry.sigops_cost);
+    }
+    FinishBlockTemplate(*block_template, scriptPubKeyIn, m_fees, tip, m_params);
+    return block_template;
+}
+
+void CandidateBlock::Invalidate()
+{
+    LOCK(m_mutex);
+    m_valid = false;
+}
+
+void CandidateBlock::TransactionAddedToMempool(const CTransactionRef& tx, uint64_t mempool_sequence)
+{
+    bool reassemble{false};
+    {
+        LOCK(m_mutex);
+        if (!m_valid || m_positions.count(tx->GetHash())) return;
+
+        LOCK(m_mempool.cs);
+        const auto it{m_mempool.GetIter(tx->GetHash())};
+        // The transaction may have left the mempool again since the notification was queued.
+        if (!it) return;
+
+        // The package is the transaction and its ancestors that are not in the candidate yet.
+        CTxMemPool::setEntries ancestors;
+        const uint64_t no_limit{std::numeric_limits<uint64_t>::max()};
+        std::string dummy;
+        m_mempool.CalculateMemPoolAncestors(**it, ancestors, no_limit, no_limit, no_limit, no_limit, dummy, false);
+        std::vector<CTxMemPool::txiter> package{*it};
+        for (const CTxMemPool::txiter& ancestor : ancestors) {
+            if (!m_positions.count(ancestor->GetTx().GetHash())) package.push_back(ancestor);
+        }
+
+        uint64_t package_size{0};
+        CAmount package_fees{0};
+        int64_t package_sigops_cost{0};
+        for (const CTxMemPool::txiter& entry : package) {
+            if (!IsFinalTx(entry->GetTx(), m_height, m_lock_time_cutoff)) return;
+            package_size += entry->GetTxSize();
+            package_fees += entry->GetModifiedFee();
+            package_sigops_cost += entry->GetSigOpCost();
+        }
+        if (package_fees < m_options.blockMinFeeRate.GetFee(package_size)) return;
+
+        bool fits{m_weight + WITNESS_SCALE_FACTOR * package_size < m_max_weight &&
+                  m_sigops_cost + package_sigops_cost < MAX_BLOCK_SIGOPS_COST};
+        if (!fits) {
+            if (CFeeRate(package_fees, package_size) <= m_lowest_feerate) return;
+            std::unordered_set<uint256, SaltedTxidHasher> spent;
+            for (const CTxMemPool::txiter& entry : package) {
+                for (const CTxIn& txin : entry->GetTx().vin) spent.insert(txin.prevout.hash);
+            }
+            fits = MakeRoom(WITNESS_SCALE_FACTOR * package_size, package_sigops_cost, package_fees, std::move(spent));
+        }
+        if (fits) {
+            std::sort(package.begin(), package.end(), CompareTxIterByAncestorCount());
+            for (const CTxMemPool::txiter& entry : package) {
+                Append(entry->GetSharedTx(), entry->GetFee(), entry->GetSigOpCost(), entry->GetTxWeight());
+            }
+        } else {
+            m_fee_shortfall += package_fees;
+            reassemble = ShortfallExceeded();
+        }
+    }
+    if (reassemble) {
+        LOCK(::cs_main);
+        LOCK(m_mutex);
+        Assemble(CScript());
+    }
+}
+
+void CandidateBlock::TransactionRemovedFromMempool(const CTransactionRef& tx, MemPoolRemovalReason reason, uint64_t mempool_sequence)
+{
+    bool reassemble{false};
+    {
+        LOCK(m_mutex);
+        if (!m_valid) return;
+        const uint64_t freed{Drop(tx->GetHash())};
+        if (freed == 0) return;
+        m_fee_shortfall += m_lowest_feerate.GetFee(freed / WITNESS_SCALE_FACTOR);
+        reassemble = ShortfallExceeded();
+    }
+    if (reassemble) {
+        LOCK(::cs_main);
+        LOCK(m_mutex);
+        Assemble(CScript());
+    }
+}
+
+void CandidateBlock::UpdatedBlockTip(const CBlockIndex* pindexNew, const CBlockIndex* pindexFork, bool fInitialDownload)
+{
+    if (fInitialDownload) {
+        Invalidate();
+        return;
+    }
+    LOCK(::cs_main);
+    LOCK(m_mutex);
+    if (!m_requested) return;
+    Assemble(CScript());
+}
+} // namespace node
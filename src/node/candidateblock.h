@@ -0,0 +1,121 @@
+// Copyright (c) 2022 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_NODE_CANDIDATEBLOCK_H
+#define BITCOIN_NODE_CANDIDATEBLOCK_H
+
+#include <consensus/amount.h>
+#include <node/miner.h>
+#include <policy/feerate.h>
+#include <primitives/transaction.h>
+#include <sync.h>
+#include <uint256.h>
+#include <util/hasher.h>
+#include <validationinterface.h>
+
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+class CChainParams;
+class ChainstateManager;
+class CScript;
+class CTxMemPool;
+
+namespace node {
+static const bool DEFAULT_INCREMENTAL_BLOCK_TEMPLATE = false;
+
+/**
+ * A block candidate kept up to date as transactions enter and leave the
+ * mempool, so that block templates can be served without running
+ * BlockAssembler over the whole mempool for every request.
+ *
+ * The candidate is assembled by BlockAssembler on first use and whenever the
+ * tip changes. In between:
+ * - A transaction added to the mempool is appended, together with those of its
+ *   ancestors that are not in the candidate, if the package pays at least the
+ *   block minimum feerate and fits. If it does not fit but pays more than the
+ *   lowest package the last assembly selected, the lowest feerate transactions
+ *   nothing in the candidate spends are dropped to make room, as long as that
+ *   gains fees. Otherwise its fees may be missing from the candidate.
+ * - A transaction removed from the mempool is dropped, along with its
+ *   descendants in the candidate. The space freed could be filled by
+ *   transactions paying at most the lowest selected package feerate.
+ * The sum of these amounts bounds how much less the candidate collects in fees
+ * than a fresh assembly would. When it exceeds MAX_FEE_SHORTFALL_PERCENT of
+ * the candidate's fees, the candidate is assembled again.
+ *
+ * Fee deltas from prioritisetransaction are not signalled by the mempool;
+ * Invalidate() must be called after changing them.
+ */
+class CandidateBlock final : public CValidationInterface
+{
+public:
+    static constexpr int MAX_FEE_SHORTFALL_PERCENT{1};
+
+    CandidateBlock(ChainstateManager& chainman, const CTxMemPool& mempool, const CChainParams& params, const BlockAssembler::Options& options);
+
+    /** Construct a block template with coinbase to scriptPubKeyIn from the candidate, assembling it first if it is stale. */
+    std::unique_ptr<CBlockTemplate> CreateNewBlock(const CScript& scriptPubKeyIn) LOCKS_EXCLUDED(m_mutex);
+
+    /** Make the next CreateNewBlock call assemble the candidate from scratch. */
+    void Invalidate() LOCKS_EXCLUDED(m_mutex);
+
+protected:
+    void TransactionAddedToMempool(const CTransactionRef& tx, uint64_t mempool_sequence) override LOCKS_EXCLUDED(m_mutex);
+    void TransactionRemovedFromMempool(const CTransactionRef& tx, MemPoolRemovalReason reason, uint64_t mempool_sequence) override LOCKS_EXCLUDED(m_mutex);
+    void UpdatedBlockTip(const CBlockIndex* pindexNew, const CBlockIndex* pindexFork, bool fInitialDownload) override LOCKS_EXCLUDED(m_mutex);
+
+private:
+    struct Entry {
+        CTransactionRef tx;
+        CAmount fee;
+        int64_t sigops_cost;
+        int64_t weight;
+    };
+
+    ChainstateManager& m_chainman;
+    const CTxMemPool& m_mempool;
+    const CChainParams& m_params;
+    const BlockAssembler::Options m_options;
+    //! The weight limit BlockAssembler applies for m_options.
+    const uint64_t m_max_weight;
+
+    Mutex m_mutex;
+    //! Whether the candidate reflects the mempool on top of m_tip.
+    bool m_valid GUARDED_BY(m_mutex){false};
+    //! Whether a template was ever requested; until then, tip changes do not assemble a candidate.
+    bool m_requested GUARDED_BY(m_mutex){false};
+    uint256 m_tip GUARDED_BY(m_mutex);
+    int m_height GUARDED_BY(m_mutex){0};
+    int64_t m_lock_time_cutoff GUARDED_BY(m_mutex){0};
+    //! Transactions in block order. Dropped entries have a null tx until the vector is compacted.
+    std::vector<Entry> m_entries GUARDED_BY(m_mutex);
+    //! Position in m_entries of each transaction in the candidate.
+    std::unordered_map<uint256, size_t, SaltedTxidHasher> m_positions GUARDED_BY(m_mutex);
+    uint64_t m_weight GUARDED_BY(m_mutex){0};
+    int64_t m_sigops_cost GUARDED_BY(m_mutex){0};
+    CAmount m_fees GUARDED_BY(m_mutex){0};
+    //! The lowest package feerate selected by the last assembly, or the block minimum feerate.
+    CFeeRate m_lowest_feerate GUARDED_BY(m_mutex);
+    //! Upper bound on the fees a fresh assembly would collect on top of the candidate's.
+    CAmount m_fee_shortfall GUARDED_BY(m_mutex){0};
+
+    /** Assemble the candidate from scratch, and return the template BlockAssembler built for scriptPubKeyIn. */
+    std::unique_ptr<CBlockTemplate> Assemble(const CScript& scriptPubKeyIn) EXCLUSIVE_LOCKS_REQUIRED(::cs_main, m_mutex);
+    void Append(const CTransactionRef& tx, CAmount fee, int64_t sigops_cost, int64_t weight) EXCLUSIVE_LOCKS_REQUIRED(m_mutex);
+    /** Drop a transaction and its descendants from the candidate, returning the weight freed. */
+    uint64_t Drop(const uint256& txid) EXCLUSIVE_LOCKS_REQUIRED(m_mutex);
+    /**
+     * Drop the lowest feerate transactions with no spenders in the candidate or in spent, until a package of
+     * the given weight and sigops cost fits. Fails, dropping nothing, if that would lose at least fees.
+     */
+    bool MakeRoom(uint64_t weight, int64_t sigops_cost, CAmount fees, std::unordered_set<uint256, SaltedTxidHasher> spent) EXCLUSIVE_LOCKS_REQUIRED(m_mutex);
+    bool ShortfallExceeded() const EXCLUSIVE_LOCKS_REQUIRED(m_mutex);
+};
+} // namespace node
+
+#endif // BITCOIN_NODE_CANDIDATEBLOCK_H
@@ -9,6 +9,7 @@
 #include <interfaces/chain.h>
 #include <net.h>
 #include <net_processing.h>
+#include <node/candidateblock.h>
 #include <policy/fees.h>
 #include <scheduler.h>
 #include <txmempool.h>
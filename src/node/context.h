@@ -27,6 +27,8 @@ class WalletLoader;
 } // namespace interfaces
 
 namespace node {
+class CandidateBlock;
+
 //! NodeContext struct containing references to chain state and connection
 //! state.
 //!
@@ -46,6 +48,8 @@ struct NodeContext {
     std::unique_ptr<CBlockPolicyEstimator> fee_estimator;
     std::unique_ptr<PeerManager> peerman;
     std::unique_ptr<ChainstateManager> chainman;
+    //! Incrementally maintained block template, set with -incrementalblocktemplate.
+    std::unique_ptr<CandidateBlock> candidate_block;
     std::unique_ptr<BanMan> banman;
     ArgsManager* args{nullptr}; // Currently a raw pointer because the memory is not managed by this struct
     std::unique_ptr<interfaces::Chain> chain;
@@ -501,6 +501,11 @@ bool CBlockPolicyEstimator::_removeTx(const uint256& hash, bool inBlock)
     AssertLockHeld(m_cs_fee_estimator);
     std::map<uint256, TxStatsInfo>::iterator pos = mapMemPoolTxs.find(hash);
     if (pos != mapMemPoolTxs.end()) {
+        // Transactions that entered the mempool before the last block seen are
+        // counted by the estimates (still unconfirmed, or failed once removed).
+        if (nBestSeenHeight != 0 && pos->second.blockHeight < nBestSeenHeight) {
+            ClearSmartFeeEstimates();
+        }
         feeStats->removeTx(pos->second.blockHeight, nBestSeenHeight, pos->second.bucketIndex, inBlock);
         shortStats->removeTx(pos->second.blockHeight, nBestSeenHeight, pos->second.bucketIndex, inBlock);
         longStats->removeTx(pos->second.blockHeight, nBestSeenHeight, pos->second.bucketIndex, inBlock);
@@ -625,6 +630,7 @@ void CBlockPolicyEstimator::processBlock(unsigned int nBlockHeight,
     // calls to removeTx (via processBlockTx) correctly calculate age
     // of unconfirmed txs to remove from tracking.
     nBestSeenHeight = nBlockHeight;
+    ClearSmartFeeEstimates();
 
     // Update unconfirmed circular buffer
     feeStats->ClearCurrent(nBlockHeight);
@@ -812,7 +818,40 @@ double CBlockPolicyEstimator::estimateConservativeFee(unsigned int doubleTarget,
  */
 CFeeRate CBlockPolicyEstimator::estimateSmartFee(int confTarget, FeeCalculation *feeCalc, bool conservative) const
 {
+    // Serve an estimate calculated since the estimation data last changed, without locking.
+    if (const auto estimates{std::atomic_load(&m_smart_fee_estimates)}) {
+        const auto it{estimates->find({confTarget, conservative})};
+        if (it != estimates->end()) {
+            if (feeCalc) *feeCalc = it->second.calc;
+            return it->second.feerate;
+        }
+    }
+
     LOCK(m_cs_fee_estimator);
+    SmartFeeEstimate estimate;
+    estimate.feerate = _estimateSmartFee(confTarget, &estimate.calc, conservative);
+    if (feeCalc) *feeCalc = estimate.calc;
+
+    // Publish a new snapshot including this estimate. Targets that are not
+    // tracked are not cached, so the snapshot stays bounded.
+    if (confTarget > 0 && (unsigned int)confTarget <= longStats->GetMaxConfirms()) {
+        auto estimates{std::make_shared<SmartFeeEstimates>()};
+        if (const auto current{std::atomic_load(&m_smart_fee_estimates)}) *estimates = *current;
+        estimates->insert_or_assign({confTarget, conservative}, estimate);
+        std::atomic_store(&m_smart_fee_estimates, std::shared_ptr<const SmartFeeEstimates>{std::move(estimates)});
+    }
+    return estimate.feerate;
+}
+
+void CBlockPolicyEstimator::ClearSmartFeeEstimates() const
+{
+    AssertLockHeld(m_cs_fee_estimator);
+    std::atomic_store(&m_smart_fee_estimates, std::shared_ptr<const SmartFeeEstimates>{});
+}
+
+CFeeRate CBlockPolicyEstimator::_estimateSmartFee(int confTarget, FeeCalculation *feeCalc, bool conservative) const
+{
+    AssertLockHeld(m_cs_fee_estimator);
 
     if (feeCalc) {
         feeCalc->desiredTarget = confTarget;
@@ -976,6 +1015,7 @@ bool CBlockPolicyEstimator::Read(CAutoFile& filein)
             nBestSeenHeight = nFileBestSeenHeight;
             historicalFirst = nFileHistoricalFirst;
             historicalBest = nFileHistoricalBest;
+            ClearSmartFeeEstimates();
         }
     }
     catch (const std::exception& e) {
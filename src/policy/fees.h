@@ -15,6 +15,7 @@
 #include <map>
 #include <memory>
 #include <string>
+#include <utility>
 #include <vector>
 
 class CAutoFile;
@@ -205,6 +206,8 @@ public:
      *  blocks. If no answer can be given at confTarget, return an estimate at
      *  the closest target where one can be given.  'conservative' estimates are
      *  valid over longer time horizons also.
+     *  Estimates are calculated once for each target and mode until the
+     *  estimation data changes, and then served without locking.
      */
     CFeeRate estimateSmartFee(int confTarget, FeeCalculation *feeCalc, bool conservative) const
         EXCLUSIVE_LOCKS_REQUIRED(!m_cs_fee_estimator);
@@ -266,9 +269,26 @@ private:
     std::vector<double> buckets GUARDED_BY(m_cs_fee_estimator); // The upper-bound of the range for the bucket (inclusive)
     std::map<double, unsigned int> bucketMap GUARDED_BY(m_cs_fee_estimator); // Map of bucket upper-bound to index into all vectors by bucket
 
+    struct SmartFeeEstimate
+    {
+        CFeeRate feerate;
+        FeeCalculation calc;
+    };
+    /** Smart fee estimates by target and conservative mode */
+    using SmartFeeEstimates = std::map<std::pair<int, bool>, SmartFeeEstimate>;
+
+    /** Immutable snapshot of the smart fee estimates calculated since the estimation
+     *  data last changed. Read with std::atomic_load without holding m_cs_fee_estimator;
+     *  only replaced while holding it. */
+    mutable std::shared_ptr<const SmartFeeEstimates> m_smart_fee_estimates;
+
     /** Process a transaction confirmed in a block*/
     bool processBlockTx(unsigned int nBlockHeight, const CTxMemPoolEntry* entry) EXCLUSIVE_LOCKS_REQUIRED(m_cs_fee_estimator);
 
+    /** Calculate a smart fee estimate, see estimateSmartFee */
+    CFeeRate _estimateSmartFee(int confTarget, FeeCalculation* feeCalc, bool conservative) const EXCLUSIVE_LOCKS_REQUIRED(m_cs_fee_estimator);
+    /** Discard cached smart fee estimates after a change to the estimation data they depend on */
+    void ClearSmartFeeEstimates() const EXCLUSIVE_LOCKS_REQUIRED(m_cs_fee_estimator);
     /** Helper for estimateSmartFee */
     double estimateCombinedFee(unsigned int confTarget, double successThreshold, bool checkShorterHorizon, EstimationResult *result) const EXCLUSIVE_LOCKS_REQUIRED(m_cs_fee_estimator);
     /** Helper for estimateSmartFee */
@@ -59,6 +59,32 @@ public:
 };
 
 
+/**
+ * Formatter for the transactions of a block. Deserializes them as a batch, so
+ * that all their txids and wtxids are computed together, unless the stream
+ * asks for them to be computed lazily (SERIALIZE_TRANSACTION_LAZY_HASH).
+ */
+struct BlockTransactionsFormatter
+{
+    template <typename Stream>
+    void Ser(Stream& s, const std::vector<CTransactionRef>& vtx)
+    {
+        s << vtx;
+    }
+
+    template <typename Stream>
+    void Unser(Stream& s, std::vector<CTransactionRef>& vtx)
+    {
+        if (s.GetVersion() & SERIALIZE_TRANSACTION_LAZY_HASH) {
+            s >> vtx;
+            return;
+        }
+        std::vector<CMutableTransaction> txs;
+        s >> txs;
+        vtx = MakeTransactionRefs(std::move(txs));
+    }
+};
+
 class CBlock : public CBlockHeader
 {
 public:
@@ -82,7 +108,7 @@ public:
     SERIALIZE_METHODS(CBlock, obj)
     {
         READWRITEAS(CBlockHeader, obj);
-        READWRITE(obj.vtx);
+        READWRITE(Using<BlockTransactionsFormatter>(obj.vtx));
     }
 
     void SetNull()
@@ -6,12 +6,16 @@
 #include <primitives/transaction.h>
 
 #include <consensus/amount.h>
+#include <crypto/sha256.h>
 #include <hash.h>
+#include <streams.h>
 #include <tinyformat.h>
 #include <util/strencodings.h>
 
 #include <assert.h>
 
+#include <thread>
+
 std::string COutPoint::ToString() const
 {
     return strprintf("COutPoint(%s, %u)", hash.ToString().substr(0,10), n);
@@ -73,13 +77,88 @@ uint256 CTransaction::ComputeHash() const
 uint256 CTransaction::ComputeWitnessHash() const
 {
     if (!HasWitness()) {
-        return hash;
+        return GetHash();
     }
     return SerializeHash(*this, SER_GETHASH, 0);
 }
 
-CTransaction::CTransaction(const CMutableTransaction& tx) : vin(tx.vin), vout(tx.vout), nVersion(tx.nVersion), nLockTime(tx.nLockTime), hash{ComputeHash()}, m_witness_hash{ComputeWitnessHash()} {}
-CTransaction::CTransaction(CMutableTransaction&& tx) : vin(std::move(tx.vin)), vout(std::move(tx.vout)), nVersion(tx.nVersion), nLockTime(tx.nLockTime), hash{ComputeHash()}, m_witness_hash{ComputeWitnessHash()} {}
+const uint256& CTransaction::ComputeLazily(bool witness) const
+{
+    const uint8_t done{witness ? WTXID_DONE : TXID_DONE};
+    const uint8_t busy{witness ? WTXID_BUSY : TXID_BUSY};
+    uint256& out{witness ? m_witness_hash : hash};
+    // Hash outside of any critical section. Only the first thread to claim
+    // the hash writes it; any others wait for it to be published.
+    const uint256 computed{witness ? ComputeWitnessHash() : ComputeHash()};
+    if (!(m_hash_state.fetch_or(busy, std::memory_order_acquire) & busy)) {
+        out = computed;
+        m_hash_state.fetch_or(done, std::memory_order_release);
+    } else {
+        while (!(m_hash_state.load(std::memory_order_acquire) & done)) {
+            std::this_thread::yield();
+        }
+    }
+    return out;
+}
+
+CTransaction::CTransaction(const CMutableTransaction& tx) : CTransaction(CMutableTransaction{tx}, /*lazy_hashes=*/false) {}
+CTransaction::CTransaction(CMutableTransaction&& tx) : CTransaction(std::move(tx), /*lazy_hashes=*/false) {}
+CTransaction::CTransaction(CMutableTransaction&& tx, bool lazy_hashes) : vin(std::move(tx.vin)), vout(std::move(tx.vout)), nVersion(tx.nVersion), nLockTime(tx.nLockTime), m_hash_state{0}
+{
+    if (!lazy_hashes) {
+        hash = ComputeHash();
+        m_hash_state = TXID_DONE;
+        m_witness_hash = ComputeWitnessHash();
+        m_hash_state = TXID_DONE | WTXID_DONE;
+    }
+}
+CTransaction::CTransaction(const CTransaction& other) : vin(other.vin), vout(other.vout), nVersion(other.nVersion), nLockTime(other.nLockTime), hash{other.GetHash()}, m_witness_hash{other.GetWitnessHash()}, m_hash_state{TXID_DONE | WTXID_DONE} {}
+CTransaction::CTransaction(PrecomputedHashes, CMutableTransaction&& tx, const uint256& hash_in, const uint256& witness_hash_in) : vin(std::move(tx.vin)), vout(std::move(tx.vout)), nVersion(tx.nVersion), nLockTime(tx.nLockTime), hash{hash_in}, m_witness_hash{witness_hash_in}, m_hash_state{TXID_DONE | WTXID_DONE} {}
+
+std::vector<CTransactionRef> MakeTransactionRefs(std::vector<CMutableTransaction>&& txs)
+{
+    if (txs.empty()) return {};
+
+    // Serialize every transaction without witness, and again with witness if
+    // it has one, into a single buffer that is sized up front.
+    std::vector<bool> has_witness(txs.size());
+    std::vector<size_t> lengths;
+    lengths.reserve(2 * txs.size());
+    size_t total{0};
+    for (size_t i = 0; i < txs.size(); ++i) {
+        has_witness[i] = txs[i].HasWitness();
+        total += lengths.emplace_back(GetSerializeSize(txs[i], SERIALIZE_TRANSACTION_NO_WITNESS));
+        if (has_witness[i]) total += lengths.emplace_back(GetSerializeSize(txs[i], 0));
+    }
+    std::vector<unsigned char> data(total);
+    std::vector<const unsigned char*> inputs;
+    inputs.reserve(lengths.size());
+    size_t pos{0};
+    for (size_t i = 0; i < txs.size(); ++i) {
+        inputs.push_back(data.data() + pos);
+        CVectorWriter{SER_GETHASH, SERIALIZE_TRANSACTION_NO_WITNESS, data, pos, txs[i]};
+        pos += lengths[inputs.size() - 1];
+        if (has_witness[i]) {
+            inputs.push_back(data.data() + pos);
+            CVectorWriter{SER_GETHASH, 0, data, pos, txs[i]};
+            pos += lengths[inputs.size() - 1];
+        }
+    }
+    assert(pos == total);
+
+    std::vector<uint256> hashes(lengths.size());
+    SHA256DMulti(hashes.front().begin(), inputs.data(), lengths.data(), hashes.size());
+
+    std::vector<CTransactionRef> ret;
+    ret.reserve(txs.size());
+    auto hash{hashes.cbegin()};
+    for (size_t i = 0; i < txs.size(); ++i) {
+        const uint256& txid{*hash++};
+        const uint256& wtxid{has_witness[i] ? *hash++ : txid};
+        ret.push_back(std::make_shared<const CTransaction>(CTransaction::PrecomputedHashes{}, std::move(txs[i]), txid, wtxid));
+    }
+    return ret;
+}
 
 CAmount CTransaction::GetValueOut() const
 {
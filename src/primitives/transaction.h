@@ -12,7 +12,10 @@
 #include <serialize.h>
 #include <uint256.h>
 
+#include <atomic>
+#include <memory>
 #include <tuple>
+#include <vector>
 
 /**
  * A flag that is ORed into the protocol version to designate that a transaction
@@ -22,6 +25,16 @@
  */
 static const int SERIALIZE_TRANSACTION_NO_WITNESS = 0x40000000;
 
+/**
+ * A flag that is ORed into the protocol version to designate that deserialized
+ * transactions should compute their txid and wtxid on first use rather than
+ * right away. This saves the hashing for callers that never look at them, e.g.
+ * when a block is only deserialized to be serialized again.
+ * Make sure that this does not collide with any of the values in `version.h`,
+ * with `SERIALIZE_TRANSACTION_NO_WITNESS` or with `ADDRV2_FORMAT`.
+ */
+static const int SERIALIZE_TRANSACTION_LAZY_HASH = 0x10000000;
+
 /** An outpoint - a combination of a transaction hash and an index n into its vout */
 class COutPoint
 {
@@ -186,6 +199,8 @@ public:
 };
 
 struct CMutableTransaction;
+class CTransaction;
+typedef std::shared_ptr<const CTransaction> CTransactionRef;
 
 /**
  * Basic transaction serialization format:
@@ -293,17 +308,36 @@ public:
     const uint32_t nLockTime;
 
 private:
-    /** Memory only. */
-    const uint256 hash;
-    const uint256 m_witness_hash;
+    /** Memory only. Computed on construction, or on first use for lazily hashed transactions. */
+    mutable uint256 hash;
+    mutable uint256 m_witness_hash;
+    //! Which of the hashes have been computed (*_DONE), or are being computed (*_BUSY).
+    mutable std::atomic<uint8_t> m_hash_state;
+
+    static constexpr uint8_t TXID_DONE{1};
+    static constexpr uint8_t TXID_BUSY{2};
+    static constexpr uint8_t WTXID_DONE{4};
+    static constexpr uint8_t WTXID_BUSY{8};
 
     uint256 ComputeHash() const;
     uint256 ComputeWitnessHash() const;
+    /** Compute the txid or wtxid of a lazily hashed transaction. Safe to call from several threads at once. */
+    const uint256& ComputeLazily(bool witness) const;
+
+    /** Convert a CMutableTransaction into a CTransaction, computing its hashes now or on first use. */
+    CTransaction(CMutableTransaction&& tx, bool lazy_hashes);
+
+    /** Restricts construction from precomputed hashes to MakeTransactionRefs. */
+    struct PrecomputedHashes {
+        explicit PrecomputedHashes() = default;
+    };
+    friend std::vector<CTransactionRef> MakeTransactionRefs(std::vector<CMutableTransaction>&& txs);
 
 public:
     /** Convert a CMutableTransaction into a CTransaction. */
     explicit CTransaction(const CMutableTransaction& tx);
     CTransaction(CMutableTransaction&& tx);
+    CTransaction(PrecomputedHashes, CMutableTransaction&& tx, const uint256& hash_in, const uint256& witness_hash_in);
 
     template <typename Stream>
     inline void Serialize(Stream& s) const {
@@ -313,14 +347,25 @@ public:
     /** This deserializing constructor is provided instead of an Unserialize method.
      *  Unserialize is not possible, since it would require overwriting const fields. */
     template <typename Stream>
-    CTransaction(deserialize_type, Stream& s) : CTransaction(CMutableTransaction(deserialize, s)) {}
+    CTransaction(deserialize_type, Stream& s) : CTransaction(CMutableTransaction(deserialize, s), s.GetVersion() & SERIALIZE_TRANSACTION_LAZY_HASH) {}
+
+    /** A copy has both hashes computed, even if the original is lazily hashed. */
+    CTransaction(const CTransaction& other);
 
     bool IsNull() const {
         return vin.empty() && vout.empty();
     }
 
-    const uint256& GetHash() const { return hash; }
-    const uint256& GetWitnessHash() const { return m_witness_hash; };
+    const uint256& GetHash() const
+    {
+        if (m_hash_state.load(std::memory_order_acquire) & TXID_DONE) return hash;
+        return ComputeLazily(/*witness=*/false);
+    }
+    const uint256& GetWitnessHash() const
+    {
+        if (m_hash_state.load(std::memory_order_acquire) & WTXID_DONE) return m_witness_hash;
+        return ComputeLazily(/*witness=*/true);
+    }
 
     // Return sum of txouts.
     CAmount GetValueOut() const;
@@ -339,12 +384,12 @@ public:
 
     friend bool operator==(const CTransaction& a, const CTransaction& b)
     {
-        return a.hash == b.hash;
+        return a.GetHash() == b.GetHash();
     }
 
     friend bool operator!=(const CTransaction& a, const CTransaction& b)
     {
-        return a.hash != b.hash;
+        return a.GetHash() != b.GetHash();
     }
 
     std::string ToString() const;
@@ -403,9 +448,15 @@ struct CMutableTransaction
     }
 };
 
-typedef std::shared_ptr<const CTransaction> CTransactionRef;
 template <typename Tx> static inline CTransactionRef MakeTransactionRef(Tx&& txIn) { return std::make_shared<const CTransaction>(std::forward<Tx>(txIn)); }
 
+/**
+ * Convert a batch of transactions into CTransactionRefs. Their txids and
+ * wtxids are computed together, which lets SHA256DMulti hash several
+ * serializations in parallel.
+ */
+std::vector<CTransactionRef> MakeTransactionRefs(std::vector<CMutableTransaction>&& txs);
+
 /** A generic txid reference (txid or wtxid). */
 class GenTxid
 {
@@ -578,7 +578,69 @@ static void ProcRand(unsigned char* out, int num, RNGLevel level) noexcept
     }
 }
 
+#if defined(HAVE_THREAD_LOCAL)
+namespace {
+
+/** A per-thread ChaCha20 stream, so that RNGLevel::FAST requests do not contend on RNGState's lock.
+ *
+ * The stream is keyed with fast-seeded output of the global RNG, and rekeyed from it after
+ * RESEED_REFILLS buffer refills or RESEED_INTERVAL, whichever comes first. Each refill replaces
+ * the key with the first 32 bytes of its own keystream, and bytes are wiped from the buffer as
+ * they are handed out, so the thread's state never reveals past outputs.
+ */
+class ThreadRNG
+{
+    static constexpr int RESEED_REFILLS{64};
+    static constexpr std::chrono::seconds RESEED_INTERVAL{1};
+
+    ChaCha20 m_stream;
+    unsigned char m_buffer[256];
+    size_t m_buffer_left{0};
+    int m_refills_left{0};
+    std::chrono::steady_clock::time_point m_reseed_time;
+
+    void Refill() noexcept
+    {
+        const auto now{std::chrono::steady_clock::now()};
+        if (m_refills_left == 0 || now >= m_reseed_time) {
+            unsigned char seed[32];
+            ProcRand(seed, sizeof(seed), RNGLevel::FAST);
+            m_stream.SetKey(seed, sizeof(seed));
+            memory_cleanse(seed, sizeof(seed));
+            m_refills_left = RESEED_REFILLS;
+            m_reseed_time = now + RESEED_INTERVAL;
+        }
+        --m_refills_left;
+        m_stream.Keystream(m_buffer, sizeof(m_buffer));
+        m_stream.SetKey(m_buffer, 32);
+        memory_cleanse(m_buffer, 32);
+        m_buffer_left = sizeof(m_buffer) - 32;
+    }
+
+public:
+    ~ThreadRNG() { memory_cleanse(m_buffer, sizeof(m_buffer)); }
+
+    void Generate(unsigned char* out, size_t num) noexcept
+    {
+        if (m_buffer_left < num) Refill();
+        unsigned char* pos = m_buffer + sizeof(m_buffer) - m_buffer_left;
+        memcpy(out, pos, num);
+        memory_cleanse(pos, num);
+        m_buffer_left -= num;
+    }
+};
+
+thread_local ThreadRNG g_thread_rng;
+} // namespace
+
+void GetRandBytes(unsigned char* buf, int num) noexcept
+{
+    assert(num <= 32);
+    g_thread_rng.Generate(buf, num);
+}
+#else
 void GetRandBytes(unsigned char* buf, int num) noexcept { ProcRand(buf, num, RNGLevel::FAST); }
+#endif
 void GetStrongRandBytes(unsigned char* buf, int num) noexcept { ProcRand(buf, num, RNGLevel::SLOW); }
 void RandAddPeriodic() noexcept { ProcRand(nullptr, 0, RNGLevel::PERIODIC); }
 void RandAddEvent(const uint32_t event_info) noexcept { GetRNGState().AddEvent(event_info); }
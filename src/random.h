@@ -28,6 +28,10 @@
  *   - 64 bits from the hardware RNG (rdrand) when available.
  *   These entropy sources are very fast, and only designed to protect against situations
  *   where a VM state restore/copy results in multiple systems with the same randomness.
+ *   To avoid contention on the global state, each thread serves these requests from its
+ *   own ChaCha20 stream, which is keyed from the global state this way at least every
+ *   second. The stream erases its key and handed-out bytes as it goes, so its state
+ *   does not reveal past output.
  *   FastRandomContext on the other hand does not protect against this once created, but
  *   is even faster (and acceptable to use inside tight loops).
  *
@@ -28,6 +28,7 @@
 #include <version.h>
 
 #include <any>
+#include <optional>
 
 #include <boost/algorithm/string.hpp>
 
@@ -300,7 +301,7 @@ static bool rest_block(const std::any& context,
         if (IsBlockPruned(pblockindex))
             return RESTERR(req, HTTP_NOT_FOUND, hashStr + " not available (pruned data)");
 
-        if (!ReadBlockFromDisk(block, pblockindex, Params().GetConsensus()))
+        if (!ReadBlockFromDisk(block, pblockindex, Params().GetConsensus(), /*lazy_hashes=*/true))
             return RESTERR(req, HTTP_NOT_FOUND, hashStr + " not found");
     }
 
@@ -624,6 +625,49 @@ static bool rest_mempool_contents(const std::any& context, HTTPRequest* req, con
     }
 }
 
+static bool rest_mempool_snapshot(const std::any& context, HTTPRequest* req, const std::string& strURIPart)
+{
+    if (!CheckWarmup(req)) return false;
+    const CTxMemPool* mempool = GetMemPool(context, req);
+    if (!mempool) return false;
+    std::string param;
+    const RetFormat rf = ParseDataFormat(param, strURIPart);
+
+    // A sequence number may follow the endpoint to get the changes since an earlier snapshot:
+    // /rest/mempool/snapshot/<since>.<bin|hex>
+    std::optional<uint64_t> since;
+    if (!param.empty()) {
+        uint64_t since_param;
+        if (param[0] != '/' || !ParseUInt64(param.substr(1), &since_param)) {
+            return RESTERR(req, HTTP_BAD_REQUEST, "Invalid sequence number: " + SanitizeString(param));
+        }
+        since = since_param;
+    }
+
+    switch (rf) {
+    case RetFormat::BINARY:
+    case RetFormat::HEX: {
+        const std::optional<MempoolSnapshot> snapshot{mempool->GetSnapshot(since)};
+        if (!snapshot) {
+            return RESTERR(req, HTTP_NOT_FOUND, strprintf("Changes since mempool sequence %d are not available", *since));
+        }
+        CDataStream ssSnapshot(SER_NETWORK, PROTOCOL_VERSION);
+        ssSnapshot << *snapshot;
+        if (rf == RetFormat::BINARY) {
+            req->WriteHeader("Content-Type", "application/octet-stream");
+            req->WriteReply(HTTP_OK, ssSnapshot.str());
+        } else {
+            req->WriteHeader("Content-Type", "text/plain");
+            req->WriteReply(HTTP_OK, HexStr(ssSnapshot) + "\n");
+        }
+        return true;
+    }
+    default: {
+        return RESTERR(req, HTTP_NOT_FOUND, "output format not found (available: bin, hex)");
+    }
+    }
+}
+
 static bool rest_tx(const std::any& context, HTTPRequest* req, const std::string& strURIPart)
 {
     if (!CheckWarmup(req))
@@ -935,6 +979,7 @@ static const struct {
       {"/rest/chaininfo", rest_chaininfo},
       {"/rest/mempool/info", rest_mempool_info},
       {"/rest/mempool/contents", rest_mempool_contents},
+      {"/rest/mempool/snapshot", rest_mempool_snapshot},
       {"/rest/headers/", rest_headers},
       {"/rest/getutxos", rest_getutxos},
       {"/rest/blockhashbyheight/", rest_blockhash_by_height},
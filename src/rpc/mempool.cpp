@@ -12,9 +12,14 @@
 #include <rpc/server.h>
 #include <rpc/server_util.h>
 #include <rpc/util.h>
+#include <streams.h>
 #include <txmempool.h>
 #include <univalue.h>
+#include <util/strencodings.h>
 #include <validation.h>
+#include <version.h>
+
+#include <optional>
 
 static std::vector<RPCResult> MempoolEntryDescription() { return {
         RPCResult{RPCResult::Type::NUM, "vsize", "virtual transaction size as defined in BIP 141. This is different from actual serialized size for witness transactions as witness data is discounted."},
@@ -214,6 +219,50 @@ RPCHelpMan getrawmempool()
     };
 }
 
+RPCHelpMan getmempoolsnapshot()
+{
+    return RPCHelpMan{"getmempoolsnapshot",
+        "\nReturns a compact binary snapshot of the mempool entries, cheaper to produce than getrawmempool true.\n"
+        "The snapshot is serialized as: the mempool sequence number it is consistent with (8 bytes); the number of\n"
+        "entries (compact size), each with txid (32 bytes), fee and modified fee (8 bytes each), vsize (4 bytes),\n"
+        "ancestor count, size and modified fees, and descendant count, size and modified fees (8 bytes each);\n"
+        "the number of removed transactions (compact size), each a txid (32 bytes). Integers are little-endian\n"
+        "and fees are in " + CURRENCY_ATOM + "s.\n"
+        "Given the sequence number of an earlier snapshot, only returns the entries added or changed since, and the\n"
+        "txids of the transactions removed since, which should be applied first.\n",
+        {
+            {"since", RPCArg::Type::NUM, RPCArg::Optional::OMITTED_NAMED_ARG, "The sequence number of an earlier snapshot. Fails if the changes since are no longer known."},
+        },
+        RPCResult{
+            RPCResult::Type::STR_HEX, "", "The serialized snapshot"},
+        RPCExamples{
+            HelpExampleCli("getmempoolsnapshot", "")
+            + HelpExampleCli("getmempoolsnapshot", "42")
+            + HelpExampleRpc("getmempoolsnapshot", "42")
+        },
+        [&](const RPCHelpMan& self, const JSONRPCRequest& request) -> UniValue
+{
+    std::optional<uint64_t> since;
+    if (!request.params[0].isNull()) {
+        const int64_t since_param{request.params[0].get_int64()};
+        if (since_param < 0) {
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid sequence number, must be non-negative");
+        }
+        since = since_param;
+    }
+
+    const std::optional<MempoolSnapshot> snapshot{EnsureAnyMemPool(request.context).GetSnapshot(since)};
+    if (!snapshot) {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, strprintf("Changes since mempool sequence %d are not available, get a full snapshot", *since));
+    }
+
+    CDataStream ssSnapshot(SER_NETWORK, PROTOCOL_VERSION);
+    ssSnapshot << *snapshot;
+    return HexStr(ssSnapshot);
+},
+    };
+}
+
 RPCHelpMan getmempoolancestors()
 {
     return RPCHelpMan{"getmempoolancestors",
@@ -385,6 +434,7 @@ UniValue MempoolInfoToJSON(const CTxMemPool& pool)
     ret.pushKV("size", (int64_t)pool.size());
     ret.pushKV("bytes", (int64_t)pool.GetTotalTxSize());
     ret.pushKV("usage", (int64_t)pool.DynamicMemoryUsage());
+    ret.pushKV("entryoverhead", uint64_t{pool.GetEntryOverhead()});
     ret.pushKV("total_fee", ValueFromAmount(pool.GetTotalFee()));
     int64_t maxmempool{gArgs.GetIntArg("-maxmempool", DEFAULT_MAX_MEMPOOL_SIZE) * 1000000};
     ret.pushKV("maxmempool", maxmempool);
@@ -406,6 +456,7 @@ RPCHelpMan getmempoolinfo()
                 {RPCResult::Type::NUM, "size", "Current tx count"},
                 {RPCResult::Type::NUM, "bytes", "Sum of all virtual transaction sizes as defined in BIP 141. Differs from actual serialized size because witness data is discounted"},
                 {RPCResult::Type::NUM, "usage", "Total memory usage for the mempool"},
+                {RPCResult::Type::NUM, "entryoverhead", "Average memory usage per transaction, beyond that of the transaction itself"},
                 {RPCResult::Type::STR_AMOUNT, "total_fee", "Total fees for the mempool in " + CURRENCY_UNIT + ", ignoring modified fees through prioritisetransaction"},
                 {RPCResult::Type::NUM, "maxmempool", "Maximum memory usage for the mempool"},
                 {RPCResult::Type::STR_AMOUNT, "mempoolminfee", "Minimum fee rate in " + CURRENCY_UNIT + "/kvB for tx to be accepted. Is the maximum of minrelaytxfee and minimum mempool fee"},
@@ -467,6 +518,7 @@ void RegisterMempoolRPCCommands(CRPCTable& t)
         {"blockchain", &getmempooldescendants},
         {"blockchain", &getmempoolentry},
         {"blockchain", &getmempoolinfo},
+        {"blockchain", &getmempoolsnapshot},
         {"blockchain", &getrawmempool},
         {"blockchain", &savemempool},
     };
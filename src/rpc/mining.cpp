@@ -14,6 +14,7 @@
 #include <deploymentstatus.h>
 #include <key_io.h>
 #include <net.h>
+#include <node/candidateblock.h>
 #include <node/context.h>
 #include <node/miner.h>
 #include <policy/fees.h>
@@ -486,6 +487,9 @@ static RPCHelpMan prioritisetransaction()
     }
 
     EnsureAnyMemPool(request.context).PrioritiseTransaction(hash, nAmount);
+    // The mempool does not signal fee delta changes.
+    const NodeContext& node = EnsureAnyNodeContext(request.context);
+    if (node.candidate_block) node.candidate_block->Invalidate();
     return true;
 },
     };
@@ -760,7 +764,7 @@ static RPCHelpMan getblocktemplate()
     static int64_t nStart;
     static std::unique_ptr<CBlockTemplate> pblocktemplate;
     if (pindexPrev != active_chain.Tip() ||
-        (mempool.GetTransactionsUpdated() != nTransactionsUpdatedLast && GetTime() - nStart > 5))
+        (mempool.GetTransactionsUpdated() != nTransactionsUpdatedLast && (node.candidate_block || GetTime() - nStart > 5)))
     {
         // Clear pindexPrev so future calls make a new block, despite any failures from here on
         pindexPrev = nullptr;
@@ -772,7 +776,12 @@ static RPCHelpMan getblocktemplate()
 
         // Create new block
         CScript scriptDummy = CScript() << OP_TRUE;
-        pblocktemplate = BlockAssembler(active_chainstate, mempool, Params()).CreateNewBlock(scriptDummy);
+        if (node.candidate_block) {
+            // The candidate is kept up to date, so serving it is cheap enough to skip the 5 second throttle.
+            pblocktemplate = node.candidate_block->CreateNewBlock(scriptDummy);
+        } else {
+            pblocktemplate = BlockAssembler(active_chainstate, mempool, Params()).CreateNewBlock(scriptDummy);
+        }
         if (!pblocktemplate)
             throw JSONRPCError(RPC_OUT_OF_MEMORY, "Out of memory");
 
@@ -10,8 +10,12 @@
 #include <crypto/sha256.h>
 #include <pubkey.h>
 #include <script/script.h>
+#include <span.h>
+#include <streams.h>
 #include <uint256.h>
 
+#include <array>
+
 typedef std::vector<unsigned char> valtype;
 
 namespace {
@@ -60,6 +64,55 @@ static inline void popstack(std::vector<valtype>& stack)
     stack.pop_back();
 }
 
+namespace {
+
+/**
+ * Spare buffers of elements popped off the stacks during one EvalScript call.
+ * Pushes take a buffer from here instead of allocating a new one, so scripts
+ * that keep popping and pushing small elements (hashes, booleans, keys) mostly
+ * reuse the same few allocations.
+ */
+class StackBufferPool
+{
+    static constexpr size_t MAX_BUFFERS{8};
+    std::array<valtype, MAX_BUFFERS> m_buffers;
+    size_t m_count{0};
+
+public:
+    //! Return an empty element, reusing a spare buffer if there is one.
+    valtype Take()
+    {
+        if (m_count == 0) return {};
+        valtype vch{std::move(m_buffers[--m_count])};
+        vch.clear();
+        return vch;
+    }
+
+    //! Keep the buffer of an element that is no longer needed.
+    void Give(valtype&& vch)
+    {
+        if (m_count < MAX_BUFFERS && vch.capacity() > 0) m_buffers[m_count++] = std::move(vch);
+    }
+};
+
+} // namespace
+
+static inline void popstack(std::vector<valtype>& stack, StackBufferPool& pool)
+{
+    if (stack.empty())
+        throw std::runtime_error("popstack(): stack empty");
+    pool.Give(std::move(stack.back()));
+    stack.pop_back();
+}
+
+/** Push a copy of data, which may refer to an element of the stack itself. */
+static inline void pushstack(std::vector<valtype>& stack, Span<const unsigned char> data, StackBufferPool& pool)
+{
+    valtype vch{pool.Take()};
+    vch.assign(data.begin(), data.end());
+    stack.push_back(std::move(vch));
+}
+
 bool static IsCompressedOrUncompressedPubKey(const valtype &vchPubKey) {
     if (vchPubKey.size() < CPubKey::COMPRESSED_SIZE) {
         //  Non-canonical public key: too short
@@ -448,6 +501,7 @@ bool EvalScript(std::vector<std::vector<unsigned char> >& stack, const CScript&
     valtype vchPushValue;
     ConditionStack vfExec;
     std::vector<valtype> altstack;
+    StackBufferPool buffers;
     set_error(serror, SCRIPT_ERR_UNKNOWN_ERROR);
     if ((sigversion == SigVersion::BASE || sigversion == SigVersion::WITNESS_V0) && script.size() > MAX_SCRIPT_SIZE) {
         return set_error(serror, SCRIPT_ERR_SCRIPT_SIZE);
@@ -503,7 +557,7 @@ bool EvalScript(std::vector<std::vector<unsigned char> >& stack, const CScript&
                 if (fRequireMinimal && !CheckMinimalPush(vchPushValue, opcode)) {
                     return set_error(serror, SCRIPT_ERR_MINIMALDATA);
                 }
-                stack.push_back(vchPushValue);
+                pushstack(stack, vchPushValue, buffers);
             } else if (fExec || (OP_IF <= opcode && opcode <= OP_ENDIF))
             switch (opcode)
             {
@@ -652,7 +706,7 @@ bool EvalScript(std::vector<std::vector<unsigned char> >& stack, const CScript&
                         fValue = CastToBool(vch);
                         if (opcode == OP_NOTIF)
                             fValue = !fValue;
-                        popstack(stack);
+                        popstack(stack, buffers);
                     }
                     vfExec.push_back(fValue);
                 }
@@ -682,7 +736,7 @@ bool EvalScript(std::vector<std::vector<unsigned char> >& stack, const CScript&
                         return set_error(serror, SCRIPT_ERR_INVALID_STACK_OPERATION);
                     bool fValue = CastToBool(stacktop(-1));
                     if (fValue)
-                        popstack(stack);
+                        popstack(stack, buffers);
                     else
                         return set_error(serror, SCRIPT_ERR_VERIFY);
                 }
@@ -702,8 +756,8 @@ bool EvalScript(std::vector<std::vector<unsigned char> >& stack, const CScript&
                 {
                     if (stack.size() < 1)
                         return set_error(serror, SCRIPT_ERR_INVALID_STACK_OPERATION);
-                    altstack.push_back(stacktop(-1));
-                    popstack(stack);
+                    altstack.push_back(std::move(stacktop(-1)));
+                    popstack(stack, buffers);
                 }
                 break;
 
@@ -711,8 +765,8 @@ bool EvalScript(std::vector<std::vector<unsigned char> >& stack, const CScript&
                 {
                     if (altstack.size() < 1)
                         return set_error(serror, SCRIPT_ERR_INVALID_ALTSTACK_OPERATION);
-                    stack.push_back(altstacktop(-1));
-                    popstack(altstack);
+                    stack.push_back(std::move(altstacktop(-1)));
+                    popstack(altstack, buffers);
                 }
                 break;
 
@@ -721,8 +775,8 @@ bool EvalScript(std::vector<std::vector<unsigned char> >& stack, const CScript&
                     // (x1 x2 -- )
                     if (stack.size() < 2)
                         return set_error(serror, SCRIPT_ERR_INVALID_STACK_OPERATION);
-                    popstack(stack);
-                    popstack(stack);
+                    popstack(stack, buffers);
+                    popstack(stack, buffers);
                 }
                 break;
 
@@ -731,10 +785,8 @@ bool EvalScript(std::vector<std::vector<unsigned char> >& stack, const CScript&
                     // (x1 x2 -- x1 x2 x1 x2)
                     if (stack.size() < 2)
                         return set_error(serror, SCRIPT_ERR_INVALID_STACK_OPERATION);
-                    valtype vch1 = stacktop(-2);
-                    valtype vch2 = stacktop(-1);
-                    stack.push_back(vch1);
-                    stack.push_back(vch2);
+                    pushstack(stack, stacktop(-2), buffers);
+                    pushstack(stack, stacktop(-2), buffers);
                 }
                 break;
 
@@ -743,12 +795,9 @@ bool EvalScript(std::vector<std::vector<unsigned char> >& stack, const CScript&
                     // (x1 x2 x3 -- x1 x2 x3 x1 x2 x3)
                     if (stack.size() < 3)
                         return set_error(serror, SCRIPT_ERR_INVALID_STACK_OPERATION);
-                    valtype vch1 = stacktop(-3);
-                    valtype vch2 = stacktop(-2);
-                    valtype vch3 = stacktop(-1);
-                    stack.push_back(vch1);
-                    stack.push_back(vch2);
-                    stack.push_back(vch3);
+                    pushstack(stack, stacktop(-3), buffers);
+                    pushstack(stack, stacktop(-3), buffers);
+                    pushstack(stack, stacktop(-3), buffers);
                 }
                 break;
 
@@ -757,10 +806,8 @@ bool EvalScript(std::vector<std::vector<unsigned char> >& stack, const CScript&
                     // (x1 x2 x3 x4 -- x1 x2 x3 x4 x1 x2)
                     if (stack.size() < 4)
                         return set_error(serror, SCRIPT_ERR_INVALID_STACK_OPERATION);
-                    valtype vch1 = stacktop(-4);
-                    valtype vch2 = stacktop(-3);
-                    stack.push_back(vch1);
-                    stack.push_back(vch2);
+                    pushstack(stack, stacktop(-4), buffers);
+                    pushstack(stack, stacktop(-4), buffers);
                 }
                 break;
 
@@ -769,11 +816,11 @@ bool EvalScript(std::vector<std::vector<unsigned char> >& stack, const CScript&
                     // (x1 x2 x3 x4 x5 x6 -- x3 x4 x5 x6 x1 x2)
                     if (stack.size() < 6)
                         return set_error(serror, SCRIPT_ERR_INVALID_STACK_OPERATION);
-                    valtype vch1 = stacktop(-6);
-                    valtype vch2 = stacktop(-5);
+                    valtype vch1 = std::move(stacktop(-6));
+                    valtype vch2 = std::move(stacktop(-5));
                     stack.erase(stack.end()-6, stack.end()-4);
-                    stack.push_back(vch1);
-                    stack.push_back(vch2);
+                    stack.push_back(std::move(vch1));
+                    stack.push_back(std::move(vch2));
                 }
                 break;
 
@@ -792,9 +839,8 @@ bool EvalScript(std::vector<std::vector<unsigned char> >& stack, const CScript&
                     // (x - 0 | x x)
                     if (stack.size() < 1)
                         return set_error(serror, SCRIPT_ERR_INVALID_STACK_OPERATION);
-                    valtype vch = stacktop(-1);
-                    if (CastToBool(vch))
-                        stack.push_back(vch);
+                    if (CastToBool(stacktop(-1)))
+                        pushstack(stack, stacktop(-1), buffers);
                 }
                 break;
 
@@ -811,7 +857,7 @@ bool EvalScript(std::vector<std::vector<unsigned char> >& stack, const CScript&
                     // (x -- )
                     if (stack.size() < 1)
                         return set_error(serror, SCRIPT_ERR_INVALID_STACK_OPERATION);
-                    popstack(stack);
+                    popstack(stack, buffers);
                 }
                 break;
 
@@ -820,8 +866,7 @@ bool EvalScript(std::vector<std::vector<unsigned char> >& stack, const CScript&
                     // (x -- x x)
                     if (stack.size() < 1)
                         return set_error(serror, SCRIPT_ERR_INVALID_STACK_OPERATION);
-                    valtype vch = stacktop(-1);
-                    stack.push_back(vch);
+                    pushstack(stack, stacktop(-1), buffers);
                 }
                 break;
 
@@ -839,8 +884,7 @@ bool EvalScript(std::vector<std::vector<unsigned char> >& stack, const CScript&
                     // (x1 x2 -- x1 x2 x1)
                     if (stack.size() < 2)
                         return set_error(serror, SCRIPT_ERR_INVALID_STACK_OPERATION);
-                    valtype vch = stacktop(-2);
-                    stack.push_back(vch);
+                    pushstack(stack, stacktop(-2), buffers);
                 }
                 break;
 
@@ -852,13 +896,16 @@ bool EvalScript(std::vector<std::vector<unsigned char> >& stack, const CScript&
                     if (stack.size() < 2)
                         return set_error(serror, SCRIPT_ERR_INVALID_STACK_OPERATION);
                     int n = CScriptNum(stacktop(-1), fRequireMinimal).getint();
-                    popstack(stack);
+                    popstack(stack, buffers);
                     if (n < 0 || n >= (int)stack.size())
                         return set_error(serror, SCRIPT_ERR_INVALID_STACK_OPERATION);
-                    valtype vch = stacktop(-n-1);
-                    if (opcode == OP_ROLL)
+                    if (opcode == OP_ROLL) {
+                        valtype vch = std::move(stacktop(-n-1));
                         stack.erase(stack.end()-n-1);
-                    stack.push_back(vch);
+                        stack.push_back(std::move(vch));
+                    } else {
+                        pushstack(stack, stacktop(-n-1), buffers);
+                    }
                 }
                 break;
 
@@ -923,13 +970,13 @@ bool EvalScript(std::vector<std::vector<unsigned char> >& stack, const CScript&
                     // zero bytes after it (numerically, 0x01 == 0x0001 == 0x000001)
                     //if (opcode == OP_NOTEQUAL)
                     //    fEqual = !fEqual;
-                    popstack(stack);
-                    popstack(stack);
-                    stack.push_back(fEqual ? vchTrue : vchFalse);
+                    popstack(stack, buffers);
+                    popstack(stack, buffers);
+                    pushstack(stack, fEqual ? vchTrue : vchFalse, buffers);
                     if (opcode == OP_EQUALVERIFY)
                     {
                         if (fEqual)
-                            popstack(stack);
+                            popstack(stack, buffers);
                         else
                             return set_error(serror, SCRIPT_ERR_EQUALVERIFY);
                     }
@@ -961,7 +1008,7 @@ bool EvalScript(std::vector<std::vector<unsigned char> >& stack, const CScript&
                     case OP_0NOTEQUAL:  bn = (bn != bnZero); break;
                     default:            assert(!"invalid opcode"); break;
                     }
-                    popstack(stack);
+                    popstack(stack, buffers);
                     stack.push_back(bn.getvch());
                 }
                 break;
@@ -1009,14 +1056,14 @@ bool EvalScript(std::vector<std::vector<unsigned char> >& stack, const CScript&
                     case OP_MAX:                 bn = (bn1 > bn2 ? bn1 : bn2); break;
                     default:                     assert(!"invalid opcode"); break;
                     }
-                    popstack(stack);
-                    popstack(stack);
+                    popstack(stack, buffers);
+                    popstack(stack, buffers);
                     stack.push_back(bn.getvch());
 
                     if (opcode == OP_NUMEQUALVERIFY)
                     {
                         if (CastToBool(stacktop(-1)))
-                            popstack(stack);
+                            popstack(stack, buffers);
                         else
                             return set_error(serror, SCRIPT_ERR_NUMEQUALVERIFY);
                     }
@@ -1032,10 +1079,10 @@ bool EvalScript(std::vector<std::vector<unsigned char> >& stack, const CScript&
                     CScriptNum bn2(stacktop(-2), fRequireMinimal);
                     CScriptNum bn3(stacktop(-1), fRequireMinimal);
                     bool fValue = (bn2 <= bn1 && bn1 < bn3);
-                    popstack(stack);
-                    popstack(stack);
-                    popstack(stack);
-                    stack.push_back(fValue ? vchTrue : vchFalse);
+                    popstack(stack, buffers);
+                    popstack(stack, buffers);
+                    popstack(stack, buffers);
+                    pushstack(stack, fValue ? vchTrue : vchFalse, buffers);
                 }
                 break;
 
@@ -1053,7 +1100,8 @@ bool EvalScript(std::vector<std::vector<unsigned char> >& stack, const CScript&
                     if (stack.size() < 1)
                         return set_error(serror, SCRIPT_ERR_INVALID_STACK_OPERATION);
                     valtype& vch = stacktop(-1);
-                    valtype vchHash((opcode == OP_RIPEMD160 || opcode == OP_SHA1 || opcode == OP_HASH160) ? 20 : 32);
+                    valtype vchHash{buffers.Take()};
+                    vchHash.resize((opcode == OP_RIPEMD160 || opcode == OP_SHA1 || opcode == OP_HASH160) ? 20 : 32);
                     if (opcode == OP_RIPEMD160)
                         CRIPEMD160().Write(vch.data(), vch.size()).Finalize(vchHash.data());
                     else if (opcode == OP_SHA1)
@@ -1064,8 +1112,8 @@ bool EvalScript(std::vector<std::vector<unsigned char> >& stack, const CScript&
                         CHash160().Write(vch).Finalize(vchHash);
                     else if (opcode == OP_HASH256)
                         CHash256().Write(vch).Finalize(vchHash);
-                    popstack(stack);
-                    stack.push_back(vchHash);
+                    popstack(stack, buffers);
+                    stack.push_back(std::move(vchHash));
                 }
                 break;
 
@@ -1092,13 +1140,13 @@ bool EvalScript(std::vector<std::vector<unsigned char> >& stack, const CScript&
 
                     bool fSuccess = true;
                     if (!EvalChecksig(vchSig, vchPubKey, pbegincodehash, pend, execdata, flags, checker, sigversion, serror, fSuccess)) return false;
-                    popstack(stack);
-                    popstack(stack);
-                    stack.push_back(fSuccess ? vchTrue : vchFalse);
+                    popstack(stack, buffers);
+                    popstack(stack, buffers);
+                    pushstack(stack, fSuccess ? vchTrue : vchFalse, buffers);
                     if (opcode == OP_CHECKSIGVERIFY)
                     {
                         if (fSuccess)
-                            popstack(stack);
+                            popstack(stack, buffers);
                         else
                             return set_error(serror, SCRIPT_ERR_CHECKSIGVERIFY);
                     }
@@ -1119,9 +1167,9 @@ bool EvalScript(std::vector<std::vector<unsigned char> >& stack, const CScript&
 
                     bool success = true;
                     if (!EvalChecksig(sig, pubkey, pbegincodehash, pend, execdata, flags, checker, sigversion, serror, success)) return false;
-                    popstack(stack);
-                    popstack(stack);
-                    popstack(stack);
+                    popstack(stack, buffers);
+                    popstack(stack, buffers);
+                    popstack(stack, buffers);
                     stack.push_back((num + (success ? 1 : 0)).getvch());
                 }
                 break;
@@ -1211,7 +1259,7 @@ bool EvalScript(std::vector<std::vector<unsigned char> >& stack, const CScript&
                             return set_error(serror, SCRIPT_ERR_SIG_NULLFAIL);
                         if (ikey2 > 0)
                             ikey2--;
-                        popstack(stack);
+                        popstack(stack, buffers);
                     }
 
                     // A bug causes CHECKMULTISIG to consume one extra argument
@@ -1224,14 +1272,14 @@ bool EvalScript(std::vector<std::vector<unsigned char> >& stack, const CScript&
                         return set_error(serror, SCRIPT_ERR_INVALID_STACK_OPERATION);
                     if ((flags & SCRIPT_VERIFY_NULLDUMMY) && stacktop(-1).size())
                         return set_error(serror, SCRIPT_ERR_SIG_NULLDUMMY);
-                    popstack(stack);
+                    popstack(stack, buffers);
 
-                    stack.push_back(fSuccess ? vchTrue : vchFalse);
+                    pushstack(stack, fSuccess ? vchTrue : vchFalse, buffers);
 
                     if (opcode == OP_CHECKMULTISIGVERIFY)
                     {
                         if (fSuccess)
-                            popstack(stack);
+                            popstack(stack, buffers);
                         else
                             return set_error(serror, SCRIPT_ERR_CHECKMULTISIGVERIFY);
                     }
@@ -1419,6 +1467,15 @@ uint256 GetSpentScriptsSHA256(const std::vector<CTxOut>& outputs_spent)
 
 } // namespace
 
+/** Serialized size of a transaction input with an empty script: prevout, script length and nSequence. */
+static constexpr size_t LEGACY_EMPTY_INPUT_SIZE{32 + 4 + 1 + 4};
+/**
+ * Minimum number of inputs without witness for which legacy signature hash
+ * data is precomputed. Below it, serializing the whole transaction for every
+ * signature costs about as much as the precomputation.
+ */
+static constexpr size_t LEGACY_PRECOMPUTE_MIN_INPUTS{4};
+
 template <class T>
 void PrecomputedTransactionData::Init(const T& txTo, std::vector<CTxOut>&& spent_outputs, bool force)
 {
@@ -1433,8 +1490,11 @@ void PrecomputedTransactionData::Init(const T& txTo, std::vector<CTxOut>&& spent
     // Determine which precomputation-impacting features this transaction uses.
     bool uses_bip143_segwit = force;
     bool uses_bip341_taproot = force;
-    for (size_t inpos = 0; inpos < txTo.vin.size() && !(uses_bip143_segwit && uses_bip341_taproot); ++inpos) {
-        if (!txTo.vin[inpos].scriptWitness.IsNull()) {
+    size_t legacy_inputs = 0;
+    for (size_t inpos = 0; inpos < txTo.vin.size(); ++inpos) {
+        if (txTo.vin[inpos].scriptWitness.IsNull()) {
+            ++legacy_inputs;
+        } else {
             if (m_spent_outputs_ready && m_spent_outputs[inpos].scriptPubKey.size() == 2 + WITNESS_V1_TAPROOT_SIZE &&
                 m_spent_outputs[inpos].scriptPubKey[0] == OP_1) {
                 // Treat every witness-bearing spend with 34-byte scriptPubKey that starts with OP_1 as a Taproot
@@ -1449,10 +1509,15 @@ void PrecomputedTransactionData::Init(const T& txTo, std::vector<CTxOut>&& spent
                 uses_bip143_segwit = true;
             }
         }
-        if (uses_bip341_taproot && uses_bip143_segwit) break; // No need to scan further if we already need all.
     }
+    bool uses_legacy = legacy_inputs >= LEGACY_PRECOMPUTE_MIN_INPUTS;
 
-    if (uses_bip143_segwit || uses_bip341_taproot) {
+    // Skip whatever is initialized already.
+    uses_bip143_segwit &= !m_bip143_segwit_ready;
+    uses_bip341_taproot &= !m_bip341_taproot_ready;
+    uses_legacy &= !m_legacy_ready;
+
+    if ((uses_bip143_segwit && !m_bip341_taproot_ready) || uses_bip341_taproot) {
         // Computations shared between both sighash schemes.
         m_prevouts_single_hash = GetPrevoutsSHA256(txTo);
         m_sequences_single_hash = GetSequencesSHA256(txTo);
@@ -1469,6 +1534,26 @@ void PrecomputedTransactionData::Init(const T& txTo, std::vector<CTxOut>&& spent
         m_spent_scripts_single_hash = GetSpentScriptsSHA256(m_spent_outputs);
         m_bip341_taproot_ready = true;
     }
+    if (uses_legacy) {
+        // Every input's signature hash covers the other inputs with empty
+        // scripts, so hash the part before each input once, and keep the
+        // serialization of the part after it.
+        std::vector<unsigned char> header;
+        CVectorWriter header_writer(SER_GETHASH, 0, header, 0, txTo.nVersion);
+        WriteCompactSize(header_writer, txTo.vin.size());
+        CSHA256 sha;
+        sha.Write(header.data(), header.size());
+        m_legacy_prefixes.reserve(txTo.vin.size());
+        m_legacy_suffix.reserve(txTo.vin.size() * LEGACY_EMPTY_INPUT_SIZE + ::GetSerializeSize(txTo.vout, PROTOCOL_VERSION) + 4);
+        for (const CTxIn& txin : txTo.vin) {
+            m_legacy_prefixes.push_back(sha);
+            const size_t pos = m_legacy_suffix.size();
+            CVectorWriter(SER_GETHASH, 0, m_legacy_suffix, pos, txin.prevout, CScript(), txin.nSequence);
+            sha.Write(m_legacy_suffix.data() + pos, LEGACY_EMPTY_INPUT_SIZE);
+        }
+        CVectorWriter(SER_GETHASH, 0, m_legacy_suffix, m_legacy_suffix.size(), txTo.vout, txTo.nLockTime);
+        m_legacy_ready = true;
+    }
 }
 
 template <class T>
@@ -1651,6 +1736,24 @@ uint256 SignatureHash(const CScript& scriptCode, const T& txTo, unsigned int nIn
     // Wrapper to serialize only the necessary parts of the transaction being signed
     CTransactionSignatureSerializer<T> txTmp(txTo, scriptCode, nIn, nHashType);
 
+    if (cache && cache->m_legacy_ready && !(nHashType & SIGHASH_ANYONECANPAY) && (nHashType & 0x1f) != SIGHASH_SINGLE && (nHashType & 0x1f) != SIGHASH_NONE) {
+        // Only the input being signed differs from the precomputed serialization.
+        assert(cache->m_legacy_prefixes.size() == txTo.vin.size());
+        std::vector<unsigned char> input;
+        CVectorWriter input_writer(SER_GETHASH, 0, input, 0);
+        txTmp.SerializeInput(input_writer, nIn);
+        const size_t suffix_pos{(nIn + 1) * LEGACY_EMPTY_INPUT_SIZE};
+        unsigned char hash_type[4];
+        WriteLE32(hash_type, nHashType);
+        uint256 hash;
+        CSHA256 sha{cache->m_legacy_prefixes[nIn]};
+        sha.Write(input.data(), input.size());
+        sha.Write(cache->m_legacy_suffix.data() + suffix_pos, cache->m_legacy_suffix.size() - suffix_pos);
+        sha.Write(hash_type, sizeof(hash_type)).Finalize(hash.begin());
+        CSHA256().Write(hash.begin(), CSHA256::OUTPUT_SIZE).Finalize(hash.begin());
+        return hash;
+    }
+
     // Serialize and hash
     CHashWriter ss(SER_GETHASH, 0);
     ss << txTmp << nHashType;
@@ -1886,7 +1989,30 @@ static bool VerifyTaprootCommitment(const std::vector<unsigned char>& control, c
     return q.CheckTapTweak(p, merkle_root, control[0] & 1);
 }
 
-static bool VerifyWitnessProgram(const CScriptWitness& witness, int witversion, const std::vector<unsigned char>& program, unsigned int flags, const BaseSignatureChecker& checker, ScriptError* serror, bool is_p2sh)
+/**
+ * Verify a P2WPKH spend without running its implied script (script_code) through
+ * ExecuteWitnessScript, with the same result and error as doing so.
+ */
+static bool VerifyWitnessKeyHash(const valtype& sig, const valtype& pubkey, const std::vector<unsigned char>& program, const CScript& script_code, unsigned int flags, const BaseSignatureChecker& checker, ScriptError* serror)
+{
+    if (sig.size() > MAX_SCRIPT_ELEMENT_SIZE || pubkey.size() > MAX_SCRIPT_ELEMENT_SIZE) {
+        return set_error(serror, SCRIPT_ERR_PUSH_SIZE);
+    }
+    // OP_DUP OP_HASH160 <program> OP_EQUALVERIFY
+    const uint160 pubkey_hash{Hash160(pubkey)};
+    if (memcmp(pubkey_hash.begin(), program.data(), WITNESS_V0_KEYHASH_SIZE)) {
+        return set_error(serror, SCRIPT_ERR_EQUALVERIFY);
+    }
+    // OP_CHECKSIG, and the cleanstack and true result required of witness scripts
+    bool success = true;
+    if (!EvalChecksigPreTapscript(sig, pubkey, script_code.begin(), script_code.end(), flags, checker, SigVersion::WITNESS_V0, serror, success)) {
+        return false;
+    }
+    if (!success) return set_error(serror, SCRIPT_ERR_EVAL_FALSE);
+    return set_success(serror);
+}
+
+static bool VerifyWitnessProgram(const CScriptWitness& witness, int witversion, const std::vector<unsigned char>& program, unsigned int flags, const BaseSignatureChecker& checker, ScriptError* serror, bool is_p2sh, bool use_templates)
 {
     CScript exec_script; //!< Actually executed script (last stack item in P2WSH; implied P2PKH script in P2WPKH; leaf script in P2TR)
     Span stack{witness.stack};
@@ -1912,6 +2038,9 @@ static bool VerifyWitnessProgram(const CScriptWitness& witness, int witversion,
                 return set_error(serror, SCRIPT_ERR_WITNESS_PROGRAM_MISMATCH); // 2 items in witness
             }
             exec_script << OP_DUP << OP_HASH160 << program << OP_EQUALVERIFY << OP_CHECKSIG;
+            if (use_templates) {
+                return VerifyWitnessKeyHash(stack[0], stack[1], program, exec_script, flags, checker, serror);
+            }
             return ExecuteWitnessScript(stack, exec_script, flags, SigVersion::WITNESS_V0, checker, execdata, serror);
         } else {
             return set_error(serror, SCRIPT_ERR_WITNESS_PROGRAM_WRONG_LENGTH);
@@ -1969,7 +2098,7 @@ static bool VerifyWitnessProgram(const CScriptWitness& witness, int witversion,
     // There is intentionally no return statement here, to be able to use "control reaches end of non-void function" warnings to detect gaps in the logic above.
 }
 
-bool VerifyScript(const CScript& scriptSig, const CScript& scriptPubKey, const CScriptWitness* witness, unsigned int flags, const BaseSignatureChecker& checker, ScriptError* serror)
+static bool VerifyScript(const CScript& scriptSig, const CScript& scriptPubKey, const CScriptWitness* witness, unsigned int flags, const BaseSignatureChecker& checker, ScriptError* serror, bool use_templates)
 {
     static const CScriptWitness emptyWitness;
     if (witness == nullptr) {
@@ -1983,6 +2112,36 @@ bool VerifyScript(const CScript& scriptSig, const CScript& scriptPubKey, const C
         return set_error(serror, SCRIPT_ERR_SIG_PUSHONLY);
     }
 
+    // Witness programs, bare or nested in P2SH, can only end the evaluation
+    // below in a few ways, which are checked directly here instead.
+    if (use_templates && (flags & SCRIPT_VERIFY_WITNESS) && (flags & SCRIPT_VERIFY_P2SH)) {
+        int witnessversion;
+        std::vector<unsigned char> witnessprogram;
+        if (scriptSig.empty() && scriptPubKey.IsWitnessProgram(witnessversion, witnessprogram)) {
+            // The scriptPubKey leaves the program on top of the stack.
+            if (!CastToBool(witnessprogram)) return set_error(serror, SCRIPT_ERR_EVAL_FALSE);
+            if (!VerifyWitnessProgram(*witness, witnessversion, witnessprogram, flags, checker, serror, /*is_p2sh=*/false, use_templates)) {
+                return false;
+            }
+            return set_success(serror);
+        }
+        // A scriptSig that is exactly a single push of the redeemScript
+        if (scriptPubKey.IsPayToScriptHash() && !scriptSig.empty() && size_t{scriptSig[0]} == scriptSig.size() - 1) {
+            const CScript redeem_script(scriptSig.begin() + 1, scriptSig.end());
+            if (redeem_script.IsWitnessProgram(witnessversion, witnessprogram)) {
+                const uint160 redeem_script_hash{Hash160(redeem_script)};
+                if (memcmp(redeem_script_hash.begin(), scriptPubKey.data() + 2, uint160::size())) {
+                    return set_error(serror, SCRIPT_ERR_EVAL_FALSE);
+                }
+                if (!CastToBool(witnessprogram)) return set_error(serror, SCRIPT_ERR_EVAL_FALSE);
+                if (!VerifyWitnessProgram(*witness, witnessversion, witnessprogram, flags, checker, serror, /*is_p2sh=*/true, use_templates)) {
+                    return false;
+                }
+                return set_success(serror);
+            }
+        }
+    }
+
     // scriptSig and scriptPubKey must be evaluated sequentially on the same stack
     // rather than being simply concatenated (see CVE-2010-5141)
     std::vector<std::vector<unsigned char> > stack, stackCopy;
@@ -2009,7 +2168,7 @@ bool VerifyScript(const CScript& scriptSig, const CScript& scriptPubKey, const C
                 // The scriptSig must be _exactly_ CScript(), otherwise we reintroduce malleability.
                 return set_error(serror, SCRIPT_ERR_WITNESS_MALLEATED);
             }
-            if (!VerifyWitnessProgram(*witness, witnessversion, witnessprogram, flags, checker, serror, /* is_p2sh */ false)) {
+            if (!VerifyWitnessProgram(*witness, witnessversion, witnessprogram, flags, checker, serror, /* is_p2sh */ false, use_templates)) {
                 return false;
             }
             // Bypass the cleanstack check at the end. The actual stack is obviously not clean
@@ -2054,7 +2213,7 @@ bool VerifyScript(const CScript& scriptSig, const CScript& scriptPubKey, const C
                     // reintroduce malleability.
                     return set_error(serror, SCRIPT_ERR_WITNESS_MALLEATED_P2SH);
                 }
-                if (!VerifyWitnessProgram(*witness, witnessversion, witnessprogram, flags, checker, serror, /* is_p2sh */ true)) {
+                if (!VerifyWitnessProgram(*witness, witnessversion, witnessprogram, flags, checker, serror, /* is_p2sh */ true, use_templates)) {
                     return false;
                 }
                 // Bypass the cleanstack check at the end. The actual stack is obviously not clean
@@ -2090,6 +2249,16 @@ bool VerifyScript(const CScript& scriptSig, const CScript& scriptPubKey, const C
     return set_success(serror);
 }
 
+bool VerifyScript(const CScript& scriptSig, const CScript& scriptPubKey, const CScriptWitness* witness, unsigned int flags, const BaseSignatureChecker& checker, ScriptError* serror)
+{
+    return VerifyScript(scriptSig, scriptPubKey, witness, flags, checker, serror, /*use_templates=*/true);
+}
+
+bool VerifyScriptGeneric(const CScript& scriptSig, const CScript& scriptPubKey, const CScriptWitness* witness, unsigned int flags, const BaseSignatureChecker& checker, ScriptError* serror)
+{
+    return VerifyScript(scriptSig, scriptPubKey, witness, flags, checker, serror, /*use_templates=*/false);
+}
+
 size_t static WitnessSigOps(int witversion, const std::vector<unsigned char>& witprogram, const CScriptWitness& witness)
 {
     if (witversion == 0) {
@@ -165,6 +165,14 @@ struct PrecomputedTransactionData
     //! Whether the 3 fields above are initialized.
     bool m_bip143_segwit_ready = false;
 
+    // Legacy (pre-segwit) precomputed data, for SIGHASH_ALL without ANYONECANPAY.
+    //! SHA256 state after the version and the inputs before each input, with empty scripts.
+    std::vector<CSHA256> m_legacy_prefixes;
+    //! The inputs serialized with empty scripts, followed by the outputs and the lock time.
+    std::vector<unsigned char> m_legacy_suffix;
+    //! Whether the 2 fields above are initialized.
+    bool m_legacy_ready = false;
+
     std::vector<CTxOut> m_spent_outputs;
     //! Whether m_spent_outputs is initialized.
     bool m_spent_outputs_ready = false;
@@ -177,7 +185,10 @@ struct PrecomputedTransactionData
      * @param[in]   spent_outputs  The CTxOuts being spent, one for each tx.vin, in order.
      * @param[in]   force          Whether to precompute data for all optional features,
      *                             regardless of what is in the inputs (used at signing
-     *                             time, when the inputs aren't filled in yet). */
+     *                             time, when the inputs aren't filled in yet).
+     *
+     * Precomputed data that is already initialized, e.g. because it was copied from an
+     * earlier validation of the same transaction, is kept rather than computed again. */
     template <class T>
     void Init(const T& tx, std::vector<CTxOut>&& spent_outputs, bool force = false);
 
@@ -342,6 +353,9 @@ bool EvalScript(std::vector<std::vector<unsigned char> >& stack, const CScript&
 bool EvalScript(std::vector<std::vector<unsigned char> >& stack, const CScript& script, unsigned int flags, const BaseSignatureChecker& checker, SigVersion sigversion, ScriptError* error = nullptr);
 bool VerifyScript(const CScript& scriptSig, const CScript& scriptPubKey, const CScriptWitness* witness, unsigned int flags, const BaseSignatureChecker& checker, ScriptError* serror = nullptr);
 
+/** VerifyScript without its fast paths for standard witness templates. Only used to test that they give the same results. */
+bool VerifyScriptGeneric(const CScript& scriptSig, const CScript& scriptPubKey, const CScriptWitness* witness, unsigned int flags, const BaseSignatureChecker& checker, ScriptError* serror = nullptr);
+
 size_t CountWitnessSigOps(const CScript& scriptSig, const CScript& scriptPubKey, const CScriptWitness* witness, unsigned int flags);
 
 bool CheckMinimalPush(const std::vector<unsigned char>& data, opcodetype opcode);
@@ -357,7 +357,7 @@ BOOST_AUTO_TEST_CASE(caddrinfo_get_tried_bucket_legacy)
     uint256 nKey1 = (uint256)(CHashWriter(SER_GETHASH, 0) << 1).GetHash();
     uint256 nKey2 = (uint256)(CHashWriter(SER_GETHASH, 0) << 2).GetHash();
 
-    std::vector<bool> asmap; // use /16
+    CompiledASMap asmap; // use /16
 
     BOOST_CHECK_EQUAL(info1.GetTriedBucket(nKey1, asmap), 40);
 
@@ -409,7 +409,7 @@ BOOST_AUTO_TEST_CASE(caddrinfo_get_new_bucket_legacy)
     uint256 nKey1 = (uint256)(CHashWriter(SER_GETHASH, 0) << 1).GetHash();
     uint256 nKey2 = (uint256)(CHashWriter(SER_GETHASH, 0) << 2).GetHash();
 
-    std::vector<bool> asmap; // use /16
+    CompiledASMap asmap; // use /16
 
     // Test: Make sure the buckets are what we expect
     BOOST_CHECK_EQUAL(info1.GetNewBucket(nKey1, asmap), 786);
@@ -486,7 +486,7 @@ BOOST_AUTO_TEST_CASE(caddrinfo_get_tried_bucket)
     uint256 nKey1 = (uint256)(CHashWriter(SER_GETHASH, 0) << 1).GetHash();
     uint256 nKey2 = (uint256)(CHashWriter(SER_GETHASH, 0) << 2).GetHash();
 
-    std::vector<bool> asmap = FromBytes(asmap_raw, sizeof(asmap_raw) * 8);
+    const CompiledASMap asmap{FromBytes(asmap_raw, sizeof(asmap_raw) * 8)};
 
     BOOST_CHECK_EQUAL(info1.GetTriedBucket(nKey1, asmap), 236);
 
@@ -538,7 +538,7 @@ BOOST_AUTO_TEST_CASE(caddrinfo_get_new_bucket)
     uint256 nKey1 = (uint256)(CHashWriter(SER_GETHASH, 0) << 1).GetHash();
     uint256 nKey2 = (uint256)(CHashWriter(SER_GETHASH, 0) << 2).GetHash();
 
-    std::vector<bool> asmap = FromBytes(asmap_raw, sizeof(asmap_raw) * 8);
+    const CompiledASMap asmap{FromBytes(asmap_raw, sizeof(asmap_raw) * 8)};
 
     // Test: Make sure the buckets are what we expect
     BOOST_CHECK_EQUAL(info1.GetNewBucket(nKey1, asmap), 795);
@@ -603,6 +603,38 @@ BOOST_AUTO_TEST_CASE(caddrinfo_get_new_bucket)
     BOOST_CHECK(buckets.size() == 1);
 }
 
+BOOST_AUTO_TEST_CASE(compiled_asmap)
+{
+    const std::vector<bool> asmap_bits{FromBytes(asmap_raw, sizeof(asmap_raw) * 8)};
+    const CompiledASMap asmap{asmap_bits};
+    BOOST_CHECK(!asmap.IsEmpty());
+    BOOST_CHECK(CompiledASMap{}.IsEmpty());
+
+    BOOST_CHECK_EQUAL(ResolveIP("250.1.1.1").GetMappedAS(asmap), 1000U);
+    BOOST_CHECK_EQUAL(ResolveIP("101.1.2.3").GetMappedAS(asmap), 1U);
+    BOOST_CHECK_EQUAL(ResolveIP("101.8.255.255").GetMappedAS(asmap), 8U);
+    BOOST_CHECK_EQUAL(ResolveIP("::FFFF:0:6501:0203").GetMappedAS(asmap), 1U); // RFC6145 form of 101.1.2.3
+    BOOST_CHECK_EQUAL(ResolveIP("250.1.1.1").GetMappedAS(CompiledASMap{}), 0U);
+
+    // Lookups must agree with the bytecode interpreter on any input.
+    FastRandomContext rng{/*fDeterministic=*/true};
+    for (int i = 0; i < 10000; ++i) {
+        std::array<uint8_t, 16> ip;
+        for (auto& byte : ip) byte = rng.randbits(8);
+        if (i % 2 == 0) {
+            // Concentrate on the IPv4-mapped range, where the mock mapping has entries.
+            std::copy(IPV4_IN_IPV6_PREFIX.begin(), IPV4_IN_IPV6_PREFIX.end(), ip.begin());
+            ip[12] = rng.randbool() ? 250 : 101;
+            ip[13] = rng.randrange(10);
+        }
+        std::vector<bool> ip_bits(128);
+        for (size_t bit = 0; bit < ip_bits.size(); ++bit) {
+            ip_bits[bit] = (ip[bit / 8] >> (7 - bit % 8)) & 1;
+        }
+        BOOST_CHECK_EQUAL(asmap.Lookup(ip), Interpret(asmap_bits, ip_bits));
+    }
+}
+
 BOOST_AUTO_TEST_CASE(addrman_serialization)
 {
     std::vector<bool> asmap1 = FromBytes(asmap_raw, sizeof(asmap_raw) * 8);
@@ -667,6 +699,39 @@ BOOST_AUTO_TEST_CASE(addrman_serialization)
     BOOST_CHECK(addr_pos7.position != addr_pos8.position);
 }
 
+BOOST_AUTO_TEST_CASE(addrman_serialization_positions)
+{
+    // Stored bucket positions are used on load, so every entry must end up
+    // exactly where it was before serialization.
+    std::vector<bool> asmap1 = FromBytes(asmap_raw, sizeof(asmap_raw) * 8);
+    const auto ratio = GetCheckRatio(m_node);
+
+    for (const auto& asmap : {EMPTY_ASMAP, asmap1}) {
+        auto addrman = std::make_unique<AddrMan>(asmap, DETERMINISTIC, ratio);
+        std::vector<CAddress> addrs;
+        for (int i = 1; i < 200; ++i) {
+            addrs.emplace_back(ResolveService(strprintf("250.%i.%i.1", i % 16, i)), NODE_NONE);
+        }
+        addrman->Add(addrs, ResolveIP("252.2.2.2"));
+        for (size_t i = 0; i < addrs.size(); i += 3) {
+            addrman->Good(addrs[i]);
+        }
+
+        CDataStream stream(SER_NETWORK, PROTOCOL_VERSION);
+        stream << *addrman;
+        auto addrman_dup = std::make_unique<AddrMan>(asmap, DETERMINISTIC, ratio);
+        stream >> *addrman_dup;
+
+        BOOST_CHECK_EQUAL(addrman->size(), addrman_dup->size());
+        for (const CAddress& addr : addrs) {
+            auto pos{addrman->FindAddressEntry(addr)};
+            const auto pos_dup{addrman_dup->FindAddressEntry(addr)};
+            BOOST_REQUIRE_EQUAL(pos.has_value(), pos_dup.has_value());
+            if (pos) BOOST_CHECK(*pos == *pos_dup);
+        }
+    }
+}
+
 BOOST_AUTO_TEST_CASE(remove_invalid)
 {
     // Confirm that invalid addresses are ignored in unserialization.
@@ -2,9 +2,11 @@
 // Distributed under the MIT software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
+#include <banindex.h>
 #include <banman.h>
 #include <chainparams.h>
 #include <netbase.h>
+#include <random.h>
 #include <streams.h>
 #include <test/util/logging.h>
 #include <test/util/setup_common.h>
@@ -15,6 +17,20 @@
 
 BOOST_FIXTURE_TEST_SUITE(banman_tests, BasicTestingSetup)
 
+static CNetAddr ResolveIP(const std::string& ip)
+{
+    CNetAddr addr;
+    LookupHost(ip, addr, false);
+    return addr;
+}
+
+static CSubNet ResolveSubNet(const std::string& subnet)
+{
+    CSubNet ret;
+    LookupSubNet(subnet, ret);
+    return ret;
+}
+
 BOOST_AUTO_TEST_CASE(file)
 {
     SetMockTime(777s);
@@ -40,4 +56,99 @@ BOOST_AUTO_TEST_CASE(file)
     }
 }
 
+BOOST_AUTO_TEST_CASE(ban_index)
+{
+    BanIndex index;
+    const CSubNet net_8{ResolveSubNet("10.0.0.0/8")};
+    const CSubNet net_16{ResolveSubNet("10.1.0.0/16")};
+    const CSubNet host_32{ResolveSubNet("10.1.2.3/32")};
+    const CSubNet net_v6{ResolveSubNet("2001:470::/32")};
+    const CSubNet onion{ResolveSubNet("pg6mmjiyjmcrsslvykfwnntlaru7p5svn6y2ymmju6nubxndf4pscryd.onion")};
+    BOOST_REQUIRE(net_8.IsValid() && net_16.IsValid() && host_32.IsValid() && net_v6.IsValid() && onion.IsValid());
+
+    index.Insert(net_16, 100);
+    index.Insert(host_32, 100);
+    index.Insert(net_8, 50);
+    index.Insert(net_v6, 100);
+    index.Insert(onion, 100);
+    index.Insert(CSubNet{}, 100); // invalid subnets are ignored
+    BOOST_CHECK_EQUAL(index.Size(), 5U);
+
+    const CNetAddr host{ResolveIP("10.1.2.3")};
+    const CNetAddr in_16{ResolveIP("10.1.200.1")};
+    const CNetAddr in_8{ResolveIP("10.200.0.1")};
+    const CNetAddr outside{ResolveIP("11.0.0.1")};
+    BOOST_CHECK(index.IsBanned(host, 0));
+    BOOST_CHECK(index.IsBanned(in_16, 0));
+    BOOST_CHECK(index.IsBanned(in_8, 0));
+    BOOST_CHECK(!index.IsBanned(outside, 0));
+    BOOST_CHECK(index.FindLongestMatch(host, 0) == host_32);
+    BOOST_CHECK(index.FindLongestMatch(in_16, 0) == net_16);
+    BOOST_CHECK(index.FindLongestMatch(in_8, 0) == net_8);
+    BOOST_CHECK(!index.FindLongestMatch(outside, 0));
+
+    // Expired entries do not match, but less specific unexpired ones still do.
+    BOOST_CHECK(!index.IsBanned(in_8, 50));
+    index.Insert(net_16, 10);
+    BOOST_CHECK(index.FindLongestMatch(in_16, 20) == net_8);
+    BOOST_CHECK(!index.IsBanned(in_16, 60));
+    BOOST_CHECK(index.IsBanned(host, 60));
+
+    BOOST_CHECK(index.IsBanned(ResolveIP("2001:470::1"), 0));
+    BOOST_CHECK(!index.IsBanned(ResolveIP("2001:471::1"), 0));
+
+    CNetAddr onion_addr;
+    BOOST_REQUIRE(onion_addr.SetSpecial("pg6mmjiyjmcrsslvykfwnntlaru7p5svn6y2ymmju6nubxndf4pscryd.onion"));
+    BOOST_CHECK(index.IsBanned(onion_addr, 0));
+
+    BOOST_CHECK(index.Erase(net_16));
+    BOOST_CHECK(!index.Erase(net_16));
+    BOOST_CHECK(index.Erase(onion));
+    BOOST_CHECK(!index.IsBanned(onion_addr, 0));
+    BOOST_CHECK(index.FindLongestMatch(in_16, 0) == net_8);
+    BOOST_CHECK(index.FindLongestMatch(host, 0) == host_32);
+    BOOST_CHECK_EQUAL(index.Size(), 3U);
+
+    index.Clear();
+    BOOST_CHECK_EQUAL(index.Size(), 0U);
+    BOOST_CHECK(!index.IsBanned(host, 0));
+}
+
+BOOST_AUTO_TEST_CASE(ban_index_matches_linear_scan)
+{
+    FastRandomContext rng{/*fDeterministic=*/true};
+    // Draw addresses from a small space so that subnets overlap and nest.
+    const auto random_addr = [&] {
+        in_addr addr;
+        addr.s_addr = htonl(0x0a000000 | rng.randbits(12) << 12 | rng.randbits(4));
+        return CNetAddr{addr};
+    };
+
+    banmap_t banmap;
+    BanIndex index;
+    for (int i = 0; i < 1000; ++i) {
+        const CSubNet sub_net{random_addr(), (uint8_t)(8 + rng.randrange(25))};
+        if (rng.randrange(4) == 0 && !banmap.empty()) {
+            const CSubNet banned_sub_net{std::next(banmap.begin(), rng.randrange(banmap.size()))->first};
+            banmap.erase(banned_sub_net);
+            BOOST_CHECK(index.Erase(banned_sub_net));
+            BOOST_CHECK(!index.Erase(banned_sub_net));
+        } else {
+            CBanEntry entry;
+            entry.nBanUntil = rng.randrange(100);
+            banmap[sub_net] = entry;
+            index.Insert(sub_net, entry.nBanUntil);
+        }
+        BOOST_CHECK_EQUAL(index.Size(), banmap.size());
+
+        const CNetAddr addr{random_addr()};
+        const int64_t now = rng.randrange(100);
+        bool banned{false};
+        for (const auto& [ban_sub_net, entry] : banmap) {
+            banned |= now < entry.nBanUntil && ban_sub_net.Match(addr);
+        }
+        BOOST_CHECK_EQUAL(index.IsBanned(addr, now), banned);
+    }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -7,7 +7,10 @@
 #include <stdlib.h>
 
 #include <chain.h>
+#include <clientversion.h>
+#include <primitives/block.h>
 #include <rpc/blockchain.h>
+#include <streams.h>
 #include <test/util/setup_common.h>
 #include <util/string.h>
 
@@ -74,4 +77,35 @@ BOOST_AUTO_TEST_CASE(get_difficulty_for_very_high_target)
     TestDifficulty(0x12345678, 5913134931067755359633408.0);
 }
 
+BOOST_AUTO_TEST_CASE(disk_block_index_ends_with_header)
+{
+    // CBlockTreeDB::LoadBlockIndexGuts hashes the last 80 bytes of a serialized
+    // CDiskBlockIndex as the block header.
+    CBlockHeader header;
+    header.nVersion = 0x20000000;
+    header.hashPrevBlock = InsecureRand256();
+    header.hashMerkleRoot = InsecureRand256();
+    header.nTime = 1269211443;
+    header.nBits = 0x1d00ffff;
+    header.nNonce = 42;
+
+    const uint256 hash{header.GetHash()};
+    CBlockIndex prev;
+    prev.phashBlock = &header.hashPrevBlock;
+    CBlockIndex index{header};
+    index.phashBlock = &hash;
+    index.pprev = &prev;
+    index.nHeight = 46367;
+    index.nTx = 7;
+    WITH_LOCK(::cs_main, index.nStatus = BLOCK_VALID_SCRIPTS | BLOCK_HAVE_DATA | BLOCK_HAVE_UNDO; index.nFile = 3; index.nDataPos = 1234; index.nUndoPos = 567);
+
+    CDataStream index_stream{SER_DISK, CLIENT_VERSION};
+    WITH_LOCK(::cs_main, index_stream << CDiskBlockIndex{&index});
+    CDataStream header_stream{SER_DISK, CLIENT_VERSION};
+    header_stream << header;
+
+    BOOST_REQUIRE(index_stream.size() > header_stream.size());
+    BOOST_CHECK(std::equal(header_stream.begin(), header_stream.end(), index_stream.end() - header_stream.size()));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,120 @@
+// Copyright (c) 2022 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <chain.h>
+#include <node/blockmap.h>
+#include <test/util/setup_common.h>
+#include <uint256.h>
+
+#include <boost/test/unit_test.hpp>
+
+#include <algorithm>
+#include <vector>
+
+using node::BlockMap;
+
+BOOST_FIXTURE_TEST_SUITE(blockmap_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(blockmap_insert_find)
+{
+    BlockMap map;
+    BOOST_CHECK(map.empty());
+    BOOST_CHECK(map.begin() == map.end());
+
+    // Insert enough entries to span several arena chunks and table resizes.
+    std::vector<uint256> hashes;
+    std::vector<CBlockIndex*> pointers;
+    for (int i = 0; i < 10000; ++i) {
+        hashes.push_back(InsecureRand256());
+        const auto [it, inserted]{map.try_emplace(hashes.back())};
+        BOOST_CHECK(inserted);
+        BOOST_CHECK(it->first == hashes.back());
+        it->second.nHeight = i;
+        pointers.push_back(&it->second);
+    }
+    BOOST_CHECK_EQUAL(map.size(), hashes.size());
+
+    for (size_t i = 0; i < hashes.size(); ++i) {
+        const auto it{map.find(hashes[i])};
+        BOOST_REQUIRE(it != map.end());
+        // Entries never move once inserted.
+        BOOST_CHECK_EQUAL(&it->second, pointers[i]);
+        BOOST_CHECK_EQUAL(it->second.nHeight, int(i));
+        BOOST_CHECK_EQUAL(map.count(hashes[i]), 1U);
+    }
+    BOOST_CHECK(map.find(InsecureRand256()) == map.end());
+    BOOST_CHECK_EQUAL(map.count(InsecureRand256()), 0U);
+
+    // Inserting an existing hash returns the existing entry.
+    const auto [it, inserted]{map.try_emplace(hashes[42])};
+    BOOST_CHECK(!inserted);
+    BOOST_CHECK_EQUAL(&it->second, pointers[42]);
+    BOOST_CHECK_EQUAL(map.size(), hashes.size());
+
+    // Iteration visits every entry once, in insertion order.
+    size_t n{0};
+    for (const auto& [hash, index] : map) {
+        BOOST_CHECK(hash == hashes[n]);
+        BOOST_CHECK_EQUAL(&index, pointers[n]);
+        ++n;
+    }
+    BOOST_CHECK_EQUAL(n, hashes.size());
+
+    map.clear();
+    BOOST_CHECK(map.empty());
+    BOOST_CHECK(map.find(hashes[0]) == map.end());
+}
+
+BOOST_AUTO_TEST_CASE(blockmap_reorder_by_height)
+{
+    // Build a chain with a fork, inserting entries in random order as the
+    // block tree database does.
+    std::vector<uint256> hashes;
+    for (int i = 0; i < 6000; ++i) hashes.push_back(InsecureRand256());
+    std::vector<int> order(hashes.size());
+    for (size_t i = 0; i < order.size(); ++i) order[i] = i;
+    Shuffle(order.begin(), order.end(), g_insecure_rand_ctx);
+
+    // Block i has height i, except for a fork of blocks 5000.. off block 4000.
+    const auto parent = [](int i) { return i == 5000 ? 4000 : i - 1; };
+    const auto height = [](int i) { return i >= 5000 ? i - 999 : i; };
+
+    BlockMap map;
+    for (const int i : order) {
+        CBlockIndex& index{map.try_emplace(hashes[i]).first->second};
+        index.phashBlock = &map.find(hashes[i])->first;
+        index.nHeight = height(i);
+        if (i > 0) {
+            index.pprev = &map.try_emplace(hashes[parent(i)]).first->second;
+        }
+    }
+    for (auto& [_, index] : map) {
+        if (index.pprev) index.BuildSkip();
+    }
+
+    map.ReorderByHeight();
+    BOOST_CHECK_EQUAL(map.size(), hashes.size());
+
+    int last_height{0};
+    for (const auto& [hash, index] : map) {
+        BOOST_CHECK(index.phashBlock == &hash);
+        BOOST_CHECK(index.nHeight >= last_height);
+        last_height = index.nHeight;
+    }
+    for (size_t i = 0; i < hashes.size(); ++i) {
+        const CBlockIndex& index{map.find(hashes[i])->second};
+        BOOST_CHECK_EQUAL(index.nHeight, height(i));
+        if (i == 0) {
+            BOOST_CHECK(index.pprev == nullptr);
+            continue;
+        }
+        BOOST_CHECK(index.pprev == &map.find(hashes[parent(i)])->second);
+        BOOST_REQUIRE(index.pskip != nullptr);
+        BOOST_CHECK(index.pskip == index.GetAncestor(index.pskip->nHeight));
+        BOOST_CHECK(map.count(index.pskip->GetBlockHash()));
+        BOOST_CHECK(index.pskip == &map.find(index.pskip->GetBlockHash())->second);
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
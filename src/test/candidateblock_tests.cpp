@@ -0,0 +1,113 @@
+// Copyright (c) 2022 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <chainparams.h>
+#include <coins.h>
+#include <consensus/validation.h>
+#include <node/candidateblock.h>
+#include <node/miner.h>
+#include <primitives/transaction.h>
+#include <script/sign.h>
+#include <script/signingprovider.h>
+#include <script/standard.h>
+#include <test/util/setup_common.h>
+#include <txmempool.h>
+#include <validation.h>
+#include <validationinterface.h>
+
+#include <boost/test/unit_test.hpp>
+
+using node::BlockAssembler;
+using node::CandidateBlock;
+using node::CBlockTemplate;
+
+BOOST_AUTO_TEST_SUITE(candidateblock_tests)
+
+static CAmount TemplateFees(const CBlockTemplate& block_template)
+{
+    CAmount fees{0};
+    for (size_t i = 1; i < block_template.vTxFees.size(); ++i) fees += block_template.vTxFees[i];
+    return fees;
+}
+
+BOOST_FIXTURE_TEST_CASE(candidateblock_fee_bound, TestChain100Setup)
+{
+    const CScript script{GetScriptForRawPubKey(coinbaseKey.GetPubKey())};
+    CTxMemPool& mempool{*m_node.mempool};
+
+    // Fan a mature coinbase out into many outputs to spend independently.
+    static constexpr int NUM_OUTPUTS{200};
+    CMutableTransaction fan_out;
+    fan_out.vin.emplace_back(COutPoint{m_coinbase_txns[0]->GetHash(), 0});
+    fan_out.vout.assign(NUM_OUTPUTS, CTxOut{20 * CENT, script});
+    {
+        FillableSigningProvider keystore;
+        keystore.AddKey(coinbaseKey);
+        std::map<COutPoint, Coin> input_coins{{fan_out.vin[0].prevout, Coin{m_coinbase_txns[0]->vout[0], 1, /*fCoinBaseIn=*/true}}};
+        std::map<int, bilingual_str> input_errors;
+        BOOST_REQUIRE(SignTransaction(fan_out, &keystore, input_coins, SIGHASH_ALL, input_errors));
+    }
+    const CTransactionRef fan_out_tx{CreateAndProcessBlock({fan_out}, script).vtx[1]};
+
+    // A small block, so that the mempool holds more than fits.
+    BlockAssembler::Options options;
+    options.nBlockMaxWeight = 40000;
+    CandidateBlock candidate{*m_node.chainman, mempool, Params(), options};
+    RegisterValidationInterface(&candidate);
+
+    const auto check_candidate = [&] {
+        SyncWithValidationInterfaceQueue();
+        LOCK(::cs_main);
+        std::unique_ptr<CBlockTemplate> incremental{candidate.CreateNewBlock(script)};
+        const std::unique_ptr<CBlockTemplate> fresh{BlockAssembler{m_node.chainman->ActiveChainstate(), mempool, Params(), options}.CreateNewBlock(script)};
+        BOOST_CHECK_EQUAL(incremental->block.hashPrevBlock, m_node.chainman->ActiveChain().Tip()->GetBlockHash());
+        BOOST_CHECK(GetBlockWeight(incremental->block) <= options.nBlockMaxWeight);
+        BOOST_CHECK(TemplateFees(*fresh) * 100 <= TemplateFees(*incremental) * (100 + CandidateBlock::MAX_FEE_SHORTFALL_PERCENT));
+        BlockValidationState state;
+        BOOST_CHECK(TestBlockValidity(state, Params(), m_node.chainman->ActiveChainstate(), incremental->block, m_node.chainman->ActiveChain().Tip(), /*fCheckPOW=*/false, /*fCheckMerkleRoot=*/false));
+        BOOST_CHECK_MESSAGE(state.IsValid(), state.ToString());
+        return incremental;
+    };
+    check_candidate();
+
+    // Independent transactions with random fees, more than fit in the block.
+    std::vector<CTransactionRef> parents;
+    for (int i = 0; i < NUM_OUTPUTS / 2; ++i) {
+        const CAmount fee{1000 + InsecureRandRange(50000)};
+        parents.push_back(MakeTransactionRef(CreateValidMempoolTransaction(fan_out_tx, i, 101, coinbaseKey, script, 20 * CENT - fee)));
+    }
+    check_candidate();
+
+    // Children, some paying enough to pull in a parent that was left out.
+    for (int i = 0; i < 30; ++i) {
+        const CAmount fee{1000 + InsecureRandRange(100000)};
+        CreateValidMempoolTransaction(parents[i], 0, 102, coinbaseKey, script, parents[i]->vout[0].nValue - fee);
+    }
+    check_candidate();
+
+    // Removals of transactions with and without descendants.
+    {
+        LOCK2(::cs_main, mempool.cs);
+        for (int i = 0; i < 40; i += 2) mempool.removeRecursive(*parents[i], MemPoolRemovalReason::CONFLICT);
+    }
+    check_candidate();
+
+    // More transactions after the removals.
+    for (int i = NUM_OUTPUTS / 2; i < NUM_OUTPUTS; ++i) {
+        const CAmount fee{1000 + InsecureRandRange(50000)};
+        CreateValidMempoolTransaction(fan_out_tx, i, 101, coinbaseKey, script, 20 * CENT - fee);
+    }
+    const std::unique_ptr<CBlockTemplate> block_template{check_candidate()};
+
+    // Mining the candidate moves it onto the new tip.
+    std::vector<CMutableTransaction> block_txs;
+    for (size_t i = 1; i < block_template->block.vtx.size(); ++i) block_txs.emplace_back(*block_template->block.vtx[i]);
+    CreateAndProcessBlock(block_txs, script);
+    check_candidate();
+
+    UnregisterValidationInterface(&candidate);
+    SyncWithValidationInterfaceQueue();
+}
+
+BOOST_AUTO_TEST_SUITE_END()
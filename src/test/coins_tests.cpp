@@ -878,4 +878,54 @@ BOOST_AUTO_TEST_CASE(ccoins_write)
                     CheckWriteCoins(parent_value, child_value, parent_value, parent_flags, child_flags, parent_flags);
 }
 
+BOOST_AUTO_TEST_CASE(ccoins_reset)
+{
+    CCoinsView root;
+    CCoinsViewCacheTest base{&root};
+    std::vector<COutPoint> outpoints;
+    for (uint32_t i{0}; i < 10; ++i) {
+        outpoints.emplace_back(InsecureRand256(), i);
+        // Give some coins scripts too large to be stored inline.
+        const CScript script{CScript{} << std::vector<unsigned char>(i % 2 ? 100 : 10, 0)};
+        base.AddCoin(outpoints.back(), Coin{CTxOut{i + 1, script}, /*nHeightIn=*/1, /*fCoinBaseIn=*/false}, /*possible_overwrite=*/false);
+    }
+    base.SetBestBlock(InsecureRand256());
+
+    CCoinsViewCacheTest cache{&base};
+    for (const COutPoint& outpoint : outpoints) {
+        BOOST_CHECK(cache.HaveCoin(outpoint));
+    }
+    BOOST_CHECK(cache.GetBestBlock() == base.GetBestBlock());
+    BOOST_CHECK_EQUAL(cache.GetCacheSize(), outpoints.size());
+    const size_t bucket_count{cache.map().bucket_count()};
+
+    cache.Reset();
+    BOOST_CHECK_EQUAL(cache.GetCacheSize(), 0U);
+    BOOST_CHECK_EQUAL(cache.usage(), 0U);
+    BOOST_CHECK_EQUAL(cache.map().bucket_count(), bucket_count);
+    // The dropped entries are still accounted for until they are reused.
+    BOOST_CHECK_GT(cache.DynamicMemoryUsage(), memusage::DynamicUsage(cache.map()));
+
+    // After a reset the cache reads through to its (new) backend like a new one.
+    CCoinsViewCacheTest other_base{&base};
+    const COutPoint other{InsecureRand256(), 0};
+    other_base.AddCoin(other, Coin{CTxOut{1, CScript{}}, /*nHeightIn=*/1, /*fCoinBaseIn=*/false}, /*possible_overwrite=*/false);
+    other_base.SetBestBlock(InsecureRand256());
+    cache.SetBackend(other_base);
+    BOOST_CHECK(cache.GetBestBlock() == other_base.GetBestBlock());
+    for (const COutPoint& outpoint : outpoints) {
+        BOOST_CHECK(cache.AccessCoin(outpoint) == base.AccessCoin(outpoint));
+        BOOST_CHECK_EQUAL(cache.map().at(outpoint).flags, 0);
+    }
+    BOOST_CHECK(cache.SpendCoin(other));
+    BOOST_CHECK_EQUAL(cache.map().at(other).flags, CCoinsCacheEntry::DIRTY);
+    BOOST_CHECK(!cache.HaveCoin(other));
+    BOOST_CHECK_EQUAL(cache.GetCacheSize(), outpoints.size() + 1);
+    size_t coins_usage{0};
+    for (const auto& entry : cache.map()) {
+        coins_usage += entry.second.coin.DynamicMemoryUsage();
+    }
+    BOOST_CHECK_EQUAL(cache.usage(), coins_usage);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
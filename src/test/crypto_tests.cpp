@@ -20,6 +20,7 @@
 #include <test/util/setup_common.h>
 #include <util/strencodings.h>
 
+#include <limits>
 #include <vector>
 
 #include <boost/test/unit_test.hpp>
@@ -753,6 +754,27 @@ BOOST_AUTO_TEST_CASE(sha256d64)
     }
 }
 
+BOOST_AUTO_TEST_CASE(sha256d_multi)
+{
+    for (int i = 0; i <= 40; ++i) {
+        // Messages of random lengths, including ones whose padding spills into an extra chunk.
+        std::vector<std::vector<unsigned char>> in(i);
+        std::vector<const unsigned char*> inputs;
+        std::vector<size_t> lengths;
+        for (auto& msg : in) {
+            msg = g_insecure_rand_ctx.randbytes(InsecureRandRange(300));
+            inputs.push_back(msg.data());
+            lengths.push_back(msg.size());
+        }
+        std::vector<unsigned char> out1(32 * i), out2(32 * i);
+        for (int j = 0; j < i; ++j) {
+            CHash256().Write(in[j]).Finalize({out1.data() + 32 * j, 32});
+        }
+        SHA256DMulti(out2.data(), inputs.data(), lengths.data(), i);
+        BOOST_CHECK(out1 == out2);
+    }
+}
+
 static void TestSHA3_256(const std::string& input, const std::string& output)
 {
     const auto in_bytes = ParseHex(input);
@@ -945,6 +967,38 @@ BOOST_AUTO_TEST_CASE(muhash_tests)
     uint256 out4;
     overflowchk.Finalize(out4);
     BOOST_CHECK_EQUAL(HexStr(out4), "3a31e6903aff0de9f62f9a9f7f8b861de76ce2cda09822b90014319ae5dc2271");
+
+    // Test Num3072 arithmetic on inputs with all limbs maximal, which exercise every carry.
+    Num3072 minus_one; // p - 1
+    for (auto& limb : minus_one.limbs) limb = std::numeric_limits<Num3072::limb_t>::max();
+    minus_one.limbs[0] -= 1103718 - 1;
+    Num3072 sq = minus_one;
+    sq.Square();
+    Num3072 prod = minus_one;
+    prod.Multiply(minus_one);
+    for (const Num3072& one : {sq, prod}) {
+        BOOST_CHECK_EQUAL(one.limbs[0], 1U);
+        for (int i = 1; i < Num3072::LIMBS; ++i) BOOST_CHECK_EQUAL(one.limbs[i], 0U);
+    }
+    Num3072 max; // 2^3072 - 1 = 1103716 (mod p)
+    for (auto& limb : max.limbs) limb = std::numeric_limits<Num3072::limb_t>::max();
+    max.Multiply(max);
+    const uint64_t max_sq{uint64_t{1103716} * 1103716};
+    BOOST_CHECK_EQUAL(max.limbs[0], Num3072::limb_t(max_sq));
+    BOOST_CHECK_EQUAL(max.limbs[1], Num3072::limb_t(Num3072::LIMB_SIZE == 64 ? 0 : max_sq >> 32));
+    for (int i = 2; i < Num3072::LIMBS; ++i) BOOST_CHECK_EQUAL(max.limbs[i], 0U);
+
+    // Test that a batch insertion matches inserting the elements one by one.
+    std::vector<std::vector<unsigned char>> elements;
+    for (int i = 0; i < 10; ++i) elements.push_back(g_insecure_rand_ctx.randbytes(1 + g_insecure_rand_ctx.randrange(100)));
+    MuHash3072 single = FromInt(3), batch = FromInt(3);
+    for (const auto& element : elements) single.Insert(element);
+    const std::vector<Span<const unsigned char>> spans(elements.begin(), elements.end());
+    batch.InsertBatch(spans);
+    uint256 out5;
+    single.Finalize(out);
+    batch.Finalize(out5);
+    BOOST_CHECK_EQUAL(out, out5);
 }
 
 BOOST_AUTO_TEST_SUITE_END()
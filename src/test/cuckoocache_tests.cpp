@@ -8,6 +8,7 @@
 
 #include <boost/test/unit_test.hpp>
 
+#include <atomic>
 #include <deque>
 #include <mutex>
 #include <shared_mutex>
@@ -368,4 +369,56 @@ BOOST_AUTO_TEST_CASE(cuckoocache_generations)
     test_cache_generations<CuckooCache::cache<uint256, SignatureCacheHasher>>();
 }
 
+BOOST_AUTO_TEST_CASE(cuckoocache_concurrent_single_threaded)
+{
+    test_cache_erase_parallel<CuckooCache::concurrent_cache<uint256, SignatureCacheHasher>>(4);
+    test_cache_generations<CuckooCache::concurrent_cache<uint256, SignatureCacheHasher>>();
+}
+
+/** Check that inserts and lookups from several threads at once neither lose
+ * elements nor return elements that were never inserted.
+ */
+BOOST_AUTO_TEST_CASE(cuckoocache_concurrent_insert_contains)
+{
+    SeedInsecureRand(SeedRand::ZEROS);
+    CuckooCache::concurrent_cache<uint256, SignatureCacheHasher> set{};
+    const uint32_t size = set.setup(1 << 16);
+    constexpr int N_THREADS = 4;
+    // Fill the cache to half its size, well below the load at which elements
+    // get evicted.
+    const uint32_t per_thread = size / 2 / N_THREADS;
+    std::vector<std::vector<uint256>> hashes(N_THREADS);
+    for (auto& thread_hashes : hashes) {
+        for (uint32_t i = 0; i < per_thread; ++i)
+            thread_hashes.push_back(InsecureRand256());
+    }
+    std::vector<uint256> absent;
+    for (uint32_t i = 0; i < per_thread; ++i)
+        absent.push_back(InsecureRand256());
+
+    std::atomic<uint32_t> false_positives{0};
+    std::vector<std::thread> threads;
+    for (int t = 0; t < N_THREADS; ++t) {
+        threads.emplace_back([&, t] {
+            for (uint32_t i = 0; i < per_thread; ++i) {
+                set.insert(hashes[t][i]);
+                // Look up elements that other threads are inserting, and ones
+                // that nobody inserts.
+                set.contains(hashes[(t + 1) % N_THREADS][i], false);
+                false_positives += set.contains(absent[i], false);
+            }
+        });
+    }
+    for (std::thread& t : threads)
+        t.join();
+
+    BOOST_CHECK_EQUAL(false_positives, 0U);
+    uint32_t count = 0;
+    for (const auto& thread_hashes : hashes) {
+        for (const uint256& h : thread_hashes)
+            count += set.contains(h, false);
+    }
+    BOOST_CHECK_EQUAL(count, per_thread * N_THREADS);
+}
+
 BOOST_AUTO_TEST_SUITE_END();
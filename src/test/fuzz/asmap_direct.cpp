@@ -6,6 +6,7 @@
 #include <util/asmap.h>
 #include <test/fuzz/fuzz.h>
 
+#include <array>
 #include <cstdint>
 #include <optional>
 #include <vector>
@@ -44,6 +45,13 @@ FUZZ_TARGET(asmap_direct)
         }
         // No address input should trigger assertions in interpreter
         std::vector<bool> addr(buffer.begin() + sep_pos + 1, buffer.end());
-        (void)Interpret(asmap, addr);
+        const uint32_t asn{Interpret(asmap, addr)};
+        // The compiled asmap must agree with the interpreter. Input bits past
+        // the end of addr are never looked at, so they can be left zero.
+        std::array<uint8_t, 16> ip{};
+        for (size_t i = 0; i < addr.size(); ++i) {
+            ip[i / 8] |= addr[i] << (7 - i % 8);
+        }
+        assert(CompiledASMap{asmap}.Lookup(ip) == asn);
     }
 }
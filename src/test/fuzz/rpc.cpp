@@ -129,6 +129,7 @@ const std::vector<std::string> RPC_COMMANDS_SAFE_FOR_FUZZING{
     "getmempooldescendants",
     "getmempoolentry",
     "getmempoolinfo",
+    "getmempoolsnapshot",
     "getmininginfo",
     "getnettotals",
     "getnetworkhashps",
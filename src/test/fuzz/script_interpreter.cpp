@@ -2,20 +2,51 @@
 // Distributed under the MIT software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
+#include <crypto/sha256.h>
+#include <hash.h>
 #include <primitives/transaction.h>
+#include <pubkey.h>
 #include <script/interpreter.h>
+#include <script/standard.h>
 #include <test/fuzz/FuzzedDataProvider.h>
 #include <test/fuzz/fuzz.h>
 #include <test/fuzz/util.h>
+#include <test/util/script.h>
 
+#include <cassert>
 #include <cstdint>
+#include <memory>
 #include <optional>
 #include <string>
 #include <vector>
 
 bool CastToBool(const std::vector<unsigned char>& vch);
 
-FUZZ_TARGET(script_interpreter)
+void initialize_script_interpreter()
+{
+    static const auto verify_handle = std::make_unique<ECCVerifyHandle>();
+}
+
+namespace {
+/** Signature checker whose answers only depend on what it is asked, so that two ways of verifying a script get the same ones. */
+class DeterministicSignatureChecker : public BaseSignatureChecker
+{
+public:
+    bool CheckECDSASignature(const std::vector<unsigned char>& sig, const std::vector<unsigned char>& pubkey, const CScript& script_code, SigVersion sigversion) const override
+    {
+        return (CHashWriter{SER_GETHASH, 0} << sig << pubkey << script_code << int(sigversion)).GetHash().GetUint64(0) & 1;
+    }
+
+    bool CheckSchnorrSignature(Span<const unsigned char> sig, Span<const unsigned char> pubkey, SigVersion sigversion, ScriptExecutionData& execdata, ScriptError* serror = nullptr) const override
+    {
+        if ((CHashWriter{SER_GETHASH, 0} << sig << pubkey << int(sigversion)).GetHash().GetUint64(0) & 1) return true;
+        if (serror) *serror = SCRIPT_ERR_SCHNORR_SIG;
+        return false;
+    }
+};
+} // namespace
+
+FUZZ_TARGET_INIT(script_interpreter, initialize_script_interpreter)
 {
     FuzzedDataProvider fuzzed_data_provider(buffer.data(), buffer.size());
     {
@@ -38,4 +69,46 @@ FUZZ_TARGET(script_interpreter)
     {
         (void)CastToBool(ConsumeRandomLengthByteVector(fuzzed_data_provider));
     }
+    {
+        // Witness programs take a fast path through VerifyScript, which must
+        // agree with the generic evaluation.
+        const unsigned int flags = fuzzed_data_provider.ConsumeIntegral<unsigned int>();
+        if (!IsValidFlagCombination(flags)) return;
+        CScriptWitness witness{ConsumeScriptWitness(fuzzed_data_provider)};
+        CScript script_sig, script_pubkey;
+        if (fuzzed_data_provider.ConsumeBool()) {
+            std::vector<unsigned char> program;
+            if (!witness.stack.empty() && fuzzed_data_provider.ConsumeBool()) {
+                // A program committing to the last witness element, as P2WPKH and P2WSH do.
+                const std::vector<unsigned char>& elem{witness.stack.back()};
+                if (fuzzed_data_provider.ConsumeBool()) {
+                    const uint160 hash{Hash160(elem)};
+                    program.assign(hash.begin(), hash.end());
+                } else {
+                    program.resize(CSHA256::OUTPUT_SIZE);
+                    CSHA256().Write(elem.data(), elem.size()).Finalize(program.data());
+                }
+            } else {
+                program = ConsumeRandomLengthByteVector(fuzzed_data_provider, 42);
+            }
+            const int version{fuzzed_data_provider.ConsumeIntegralInRange<int>(0, 16)};
+            const CScript witness_script{CScript() << CScript::EncodeOP_N(version) << program};
+            if (fuzzed_data_provider.ConsumeBool()) {
+                script_pubkey = GetScriptForDestination(ScriptHash(witness_script));
+                script_sig << std::vector<unsigned char>(witness_script.begin(), witness_script.end());
+            } else {
+                script_pubkey = witness_script;
+            }
+            if (fuzzed_data_provider.ConsumeBool()) script_sig = ConsumeScript(fuzzed_data_provider);
+        } else {
+            script_sig = ConsumeScript(fuzzed_data_provider);
+            script_pubkey = ConsumeScript(fuzzed_data_provider, /*maybe_p2wsh=*/true);
+        }
+        const DeterministicSignatureChecker checker;
+        ScriptError error, error_generic;
+        const bool ret{VerifyScript(script_sig, script_pubkey, &witness, flags, checker, &error)};
+        const bool ret_generic{VerifyScriptGeneric(script_sig, script_pubkey, &witness, flags, checker, &error_generic)};
+        assert(ret == ret_generic);
+        assert(error == error_generic);
+    }
 }
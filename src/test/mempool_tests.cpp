@@ -3,13 +3,19 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include <policy/policy.h>
+#include <streams.h>
 #include <txmempool.h>
 #include <util/system.h>
 #include <util/time.h>
+#include <version.h>
 
 #include <test/util/setup_common.h>
 
 #include <boost/test/unit_test.hpp>
+
+#include <algorithm>
+#include <map>
+#include <optional>
 #include <vector>
 
 BOOST_FIXTURE_TEST_SUITE(mempool_tests, TestingSetup)
@@ -119,6 +125,19 @@ static void CheckSort(CTxMemPool &pool, std::vector<std::string> &sortedOrder) E
     }
 }
 
+/** Check the order of the mempool by ancestor feerate, which is not indexed by mapTx. */
+static void CheckAncestorFeeSort(CTxMemPool& pool, std::vector<std::string>& sortedOrder) EXCLUSIVE_LOCKS_REQUIRED(pool.cs)
+{
+    BOOST_CHECK_EQUAL(pool.size(), sortedOrder.size());
+    std::vector<std::reference_wrapper<const CTxMemPoolEntry>> entries(pool.mapTx.begin(), pool.mapTx.end());
+    std::sort(entries.begin(), entries.end(), [](const CTxMemPoolEntry& a, const CTxMemPoolEntry& b) {
+        return CompareTxMemPoolEntryByAncestorFee{}(a, b);
+    });
+    for (size_t i{0}; i < entries.size(); ++i) {
+        BOOST_CHECK_EQUAL(entries[i].get().GetTx().GetHash().ToString(), sortedOrder[i]);
+    }
+}
+
 BOOST_AUTO_TEST_CASE(MempoolIndexingTest)
 {
     CTxMemPool pool;
@@ -351,7 +370,7 @@ BOOST_AUTO_TEST_CASE(MempoolAncestorIndexingTest)
     }
     sortedOrder[4] = tx3.GetHash().ToString(); // 0
 
-    CheckSort<ancestor_score>(pool, sortedOrder);
+    CheckAncestorFeeSort(pool, sortedOrder);
 
     /* low fee parent with high fee child */
     /* tx6 (0) -> tx7 (high) */
@@ -369,7 +388,7 @@ BOOST_AUTO_TEST_CASE(MempoolAncestorIndexingTest)
     else
         sortedOrder.insert(sortedOrder.end()-1,tx6.GetHash().ToString());
 
-    CheckSort<ancestor_score>(pool, sortedOrder);
+    CheckAncestorFeeSort(pool, sortedOrder);
 
     CMutableTransaction tx7 = CMutableTransaction();
     tx7.vin.resize(1);
@@ -386,7 +405,7 @@ BOOST_AUTO_TEST_CASE(MempoolAncestorIndexingTest)
     pool.addUnchecked(entry.Fee(fee).FromTx(tx7));
     BOOST_CHECK_EQUAL(pool.size(), 7U);
     sortedOrder.insert(sortedOrder.begin()+1, tx7.GetHash().ToString());
-    CheckSort<ancestor_score>(pool, sortedOrder);
+    CheckAncestorFeeSort(pool, sortedOrder);
 
     /* after tx6 is mined, tx7 should move up in the sort */
     std::vector<CTransactionRef> vtx;
@@ -400,7 +419,7 @@ BOOST_AUTO_TEST_CASE(MempoolAncestorIndexingTest)
     else
         sortedOrder.erase(sortedOrder.end()-2);
     sortedOrder.insert(sortedOrder.begin(), tx7.GetHash().ToString());
-    CheckSort<ancestor_score>(pool, sortedOrder);
+    CheckAncestorFeeSort(pool, sortedOrder);
 
     // High-fee parent, low-fee child
     // tx7 -> tx8
@@ -417,7 +436,7 @@ BOOST_AUTO_TEST_CASE(MempoolAncestorIndexingTest)
     // but the transaction's own feerate is lower
     pool.addUnchecked(entry.Fee(5000LL).FromTx(tx8));
     sortedOrder.insert(sortedOrder.end()-1, tx8.GetHash().ToString());
-    CheckSort<ancestor_score>(pool, sortedOrder);
+    CheckAncestorFeeSort(pool, sortedOrder);
 }
 
 
@@ -786,4 +805,180 @@ BOOST_AUTO_TEST_CASE(MempoolAncestryTests)
     BOOST_CHECK_EQUAL(descendants, 4ULL);
 }
 
+BOOST_AUTO_TEST_CASE(MempoolClusterTest)
+{
+    CTxMemPool pool;
+    LOCK2(cs_main, pool.cs);
+    TestMemPoolEntryHelper entry;
+
+    // [parent].0 <- [child1]
+    //         .1 <- [child2]
+    CTransactionRef parent = make_tx(/*output_values=*/{10 * COIN, 10 * COIN});
+    CTransactionRef child1 = make_tx(/*output_values=*/{10 * COIN, 10 * COIN}, /*inputs=*/{parent}, /*input_indices=*/{0});
+    CTransactionRef child2 = make_tx(/*output_values=*/{10 * COIN, 10 * COIN}, /*inputs=*/{parent}, /*input_indices=*/{1});
+    pool.addUnchecked(entry.Fee(1000LL).FromTx(parent));
+
+    // A lone transaction is a cluster of one chunk.
+    auto cluster = pool.GetCluster(*pool.GetIter(parent->GetHash()));
+    BOOST_REQUIRE_EQUAL(cluster->chunks.size(), 1U);
+    BOOST_CHECK_EQUAL(cluster->chunks[0].txs.size(), 1U);
+    BOOST_CHECK_EQUAL(cluster->chunks[0].fee, 1000);
+
+    // child1 pays for the parent; child2 pays less than both together.
+    pool.addUnchecked(entry.Fee(50000LL).FromTx(child1));
+    pool.addUnchecked(entry.Fee(2000LL).FromTx(child2));
+    cluster = pool.GetCluster(*pool.GetIter(child2->GetHash()));
+    BOOST_CHECK(pool.GetCluster(*pool.GetIter(parent->GetHash())) == cluster);
+    BOOST_CHECK(pool.GetCluster(*pool.GetIter(child1->GetHash())) == cluster);
+    BOOST_REQUIRE_EQUAL(cluster->chunks.size(), 2U);
+    BOOST_REQUIRE_EQUAL(cluster->chunks[0].txs.size(), 2U);
+    BOOST_CHECK(cluster->chunks[0].txs[0]->GetTx().GetHash() == parent->GetHash());
+    BOOST_CHECK(cluster->chunks[0].txs[1]->GetTx().GetHash() == child1->GetHash());
+    BOOST_CHECK_EQUAL(cluster->chunks[0].fee, 51000);
+    BOOST_REQUIRE_EQUAL(cluster->chunks[1].txs.size(), 1U);
+    BOOST_CHECK(cluster->chunks[1].txs[0]->GetTx().GetHash() == child2->GetHash());
+
+    // A fee delta changes the linearization.
+    pool.PrioritiseTransaction(child2->GetHash(), 100000LL);
+    BOOST_CHECK(cluster->stale);
+    cluster = pool.GetCluster(*pool.GetIter(parent->GetHash()));
+    BOOST_REQUIRE_EQUAL(cluster->chunks.size(), 2U);
+    BOOST_CHECK(cluster->chunks[0].txs[1]->GetTx().GetHash() == child2->GetHash());
+    BOOST_CHECK(cluster->chunks[1].txs[0]->GetTx().GetHash() == child1->GetHash());
+    pool.PrioritiseTransaction(child2->GetHash(), -100000LL);
+
+    // Once child1 has paid for the parent, child2 pays more than both
+    // together, so the two picks merge into one chunk.
+    pool.PrioritiseTransaction(child1->GetHash(), -40000LL);
+    pool.PrioritiseTransaction(child2->GetHash(), 8000LL);
+    cluster = pool.GetCluster(*pool.GetIter(child1->GetHash()));
+    BOOST_REQUIRE_EQUAL(cluster->chunks.size(), 1U);
+    BOOST_CHECK_EQUAL(cluster->chunks[0].txs.size(), 3U);
+    BOOST_CHECK(cluster->chunks[0].txs[0]->GetTx().GetHash() == parent->GetHash());
+    BOOST_CHECK_EQUAL(cluster->chunks[0].fee, 21000);
+
+    // Removing a transaction splits the cluster.
+    pool.removeRecursive(*child1, MemPoolRemovalReason::REPLACED);
+    BOOST_CHECK(cluster->stale);
+    cluster = pool.GetCluster(*pool.GetIter(child2->GetHash()));
+    BOOST_REQUIRE_EQUAL(cluster->chunks.size(), 1U);
+    BOOST_CHECK_EQUAL(cluster->chunks[0].txs.size(), 2U);
+    pool.removeRecursive(*parent, MemPoolRemovalReason::REPLACED);
+    BOOST_CHECK(cluster->stale);
+    BOOST_CHECK_EQUAL(pool.size(), 0U);
+}
+
+static const MempoolSnapshotEntry* FindSnapshotEntry(const MempoolSnapshot& snapshot, const CTransactionRef& tx)
+{
+    const uint256 txid{tx->GetHash()};
+    const auto it{std::find_if(snapshot.entries.begin(), snapshot.entries.end(), [&](const MempoolSnapshotEntry& e) { return e.txid == txid; })};
+    return it == snapshot.entries.end() ? nullptr : &*it;
+}
+
+BOOST_AUTO_TEST_CASE(MempoolSnapshotTest)
+{
+    CTxMemPool pool;
+    LOCK2(cs_main, pool.cs);
+    TestMemPoolEntryHelper entry;
+    // Add a transaction as validation does, announcing it with a new sequence number
+    const auto add{[&](const CTransactionRef& tx, CAmount fee) EXCLUSIVE_LOCKS_REQUIRED(pool.cs) {
+        pool.addUnchecked(entry.Fee(fee).FromTx(tx));
+        pool.GetAndIncrementSequence();
+    }};
+
+    const CTransactionRef parent = make_tx(/*output_values=*/{10 * COIN, 10 * COIN});
+    const CTransactionRef child = make_tx(/*output_values=*/{COIN}, /*inputs=*/{parent}, /*input_indices=*/{0});
+    const CTransactionRef grandchild = make_tx(/*output_values=*/{COIN}, /*inputs=*/{child});
+    const CTransactionRef other = make_tx(/*output_values=*/{COIN});
+    add(parent, 1000);
+    add(child, 2000);
+
+    const std::optional<MempoolSnapshot> full{pool.GetSnapshot()};
+    BOOST_REQUIRE(full);
+    BOOST_CHECK_EQUAL(full->sequence, pool.GetSequence());
+    BOOST_CHECK_EQUAL(full->entries.size(), 2U);
+    BOOST_CHECK(full->removed.empty());
+    const MempoolSnapshotEntry* parent_entry{FindSnapshotEntry(*full, parent)};
+    BOOST_REQUIRE(parent_entry);
+    BOOST_CHECK_EQUAL(parent_entry->fee, 1000);
+    BOOST_CHECK_EQUAL(parent_entry->count_with_ancestors, 1U);
+    BOOST_CHECK_EQUAL(parent_entry->count_with_descendants, 2U);
+    BOOST_CHECK_EQUAL(parent_entry->mod_fees_with_descendants, 3000);
+    const MempoolSnapshotEntry* child_entry{FindSnapshotEntry(*full, child)};
+    BOOST_REQUIRE(child_entry);
+    BOOST_CHECK_EQUAL(child_entry->vsize, GetVirtualTransactionSize(*child));
+    BOOST_CHECK_EQUAL(child_entry->count_with_ancestors, 2U);
+    BOOST_CHECK_EQUAL(child_entry->size_with_ancestors, parent_entry->vsize + child_entry->vsize);
+
+    // Nothing changed since the full snapshot
+    std::optional<MempoolSnapshot> delta{pool.GetSnapshot(full->sequence)};
+    BOOST_REQUIRE(delta);
+    BOOST_CHECK(delta->entries.empty() && delta->removed.empty());
+
+    // An unrelated transaction only changes itself, a grandchild changes its ancestors too
+    add(other, 1000);
+    delta = pool.GetSnapshot(full->sequence);
+    BOOST_REQUIRE(delta);
+    BOOST_CHECK_EQUAL(delta->entries.size(), 1U);
+    BOOST_CHECK(FindSnapshotEntry(*delta, other));
+    const uint64_t before_grandchild{delta->sequence};
+    add(grandchild, 1000);
+    delta = pool.GetSnapshot(before_grandchild);
+    BOOST_REQUIRE(delta);
+    BOOST_CHECK_EQUAL(delta->entries.size(), 3U);
+    BOOST_CHECK_EQUAL(FindSnapshotEntry(*delta, parent)->count_with_descendants, 3U);
+    BOOST_CHECK(!FindSnapshotEntry(*delta, other));
+
+    // Prioritisation changes modified fees of the transaction and its ancestors and descendants
+    const uint64_t before_prioritise{pool.GetSequence()};
+    pool.PrioritiseTransaction(child->GetHash(), 500);
+    delta = pool.GetSnapshot(before_prioritise);
+    BOOST_REQUIRE(delta);
+    BOOST_CHECK_EQUAL(delta->entries.size(), 3U);
+    BOOST_CHECK_EQUAL(FindSnapshotEntry(*delta, child)->modified_fee, 2500);
+    BOOST_CHECK_EQUAL(FindSnapshotEntry(*delta, child)->fee, 2000);
+    BOOST_CHECK_EQUAL(FindSnapshotEntry(*delta, parent)->mod_fees_with_descendants, 4500);
+
+    // Removing the child removes its descendants too, and changes its ancestors
+    const uint64_t before_remove{pool.GetSequence()};
+    pool.removeRecursive(*child, REMOVAL_REASON_DUMMY);
+    delta = pool.GetSnapshot(before_remove);
+    BOOST_REQUIRE(delta);
+    BOOST_CHECK_EQUAL(delta->removed.size(), 2U);
+    BOOST_CHECK(std::count(delta->removed.begin(), delta->removed.end(), child->GetHash()));
+    BOOST_CHECK(std::count(delta->removed.begin(), delta->removed.end(), grandchild->GetHash()));
+    BOOST_CHECK_EQUAL(delta->entries.size(), 1U);
+    BOOST_CHECK_EQUAL(FindSnapshotEntry(*delta, parent)->count_with_descendants, 1U);
+
+    // Applying the changes since the first snapshot results in the current mempool
+    delta = pool.GetSnapshot(full->sequence);
+    BOOST_REQUIRE(delta);
+    std::map<uint256, CAmount> applied;
+    for (const MempoolSnapshotEntry& e : full->entries) applied[e.txid] = e.mod_fees_with_descendants;
+    for (const uint256& txid : delta->removed) applied.erase(txid);
+    for (const MempoolSnapshotEntry& e : delta->entries) applied[e.txid] = e.mod_fees_with_descendants;
+    const std::optional<MempoolSnapshot> current{pool.GetSnapshot()};
+    BOOST_REQUIRE(current);
+    std::map<uint256, CAmount> expected;
+    for (const MempoolSnapshotEntry& e : current->entries) expected[e.txid] = e.mod_fees_with_descendants;
+    BOOST_CHECK(applied == expected);
+
+    // Snapshots round-trip through serialization
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    ss << *delta;
+    MempoolSnapshot deserialized;
+    ss >> deserialized;
+    BOOST_CHECK_EQUAL(deserialized.sequence, delta->sequence);
+    BOOST_CHECK(deserialized.removed == delta->removed);
+    BOOST_REQUIRE_EQUAL(deserialized.entries.size(), delta->entries.size());
+    BOOST_CHECK(deserialized.entries[0].txid == delta->entries[0].txid);
+    BOOST_CHECK_EQUAL(deserialized.entries[0].size_with_ancestors, delta->entries[0].size_with_ancestors);
+
+    // Sequence numbers from the future, or from before the mempool was cleared, are rejected
+    BOOST_CHECK(!pool.GetSnapshot(pool.GetSequence() + 1));
+    pool.clear();
+    BOOST_CHECK(!pool.GetSnapshot(full->sequence));
+    BOOST_CHECK(pool.GetSnapshot(pool.GetSequence()));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -180,4 +180,66 @@ BOOST_AUTO_TEST_CASE(BlockPolicyEstimates)
     }
 }
 
+static void CheckSameSmartFeeEstimates(const CBlockPolicyEstimator& cached, const CBlockPolicyEstimator& uncached)
+{
+    for (const bool conservative : {false, true}) {
+        for (int target = 0; target <= 50; ++target) {
+            FeeCalculation calc, expected_calc;
+            BOOST_CHECK(cached.estimateSmartFee(target, &calc, conservative) == uncached.estimateSmartFee(target, &expected_calc, conservative));
+            BOOST_CHECK_EQUAL(calc.desiredTarget, expected_calc.desiredTarget);
+            BOOST_CHECK_EQUAL(calc.returnedTarget, expected_calc.returnedTarget);
+            BOOST_CHECK(calc.reason == expected_calc.reason);
+            BOOST_CHECK_EQUAL(calc.est.pass.withinTarget, expected_calc.est.pass.withinTarget);
+            BOOST_CHECK_EQUAL(calc.est.pass.inMempool, expected_calc.est.pass.inMempool);
+            BOOST_CHECK_EQUAL(calc.est.fail.leftMempool, expected_calc.est.fail.leftMempool);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(SmartFeeEstimateCache)
+{
+    // Feed two estimators the same transactions and blocks, and only query the
+    // first one in between, so that it serves cached estimates which must
+    // match the ones calculated by the second one.
+    CBlockPolicyEstimator cachedEst, freshEst;
+    CTxMemPool cachedPool(&cachedEst), freshPool(&freshEst);
+    LOCK(cs_main);
+    LOCK2(cachedPool.cs, freshPool.cs);
+    TestMemPoolEntryHelper entry;
+
+    CMutableTransaction tx;
+    tx.vin.resize(1);
+    tx.vout.resize(1);
+    std::vector<CTransactionRef> unconfirmed;
+    for (int blocknum = 0; blocknum < 30;) {
+        std::vector<CTransactionRef> block;
+        for (int j = 0; j < 10; j++) {
+            for (int k = 0; k < 4; k++) {
+                tx.vin[0].prevout.n = 10000 * blocknum + 100 * j + k;
+                const CTransactionRef ptx = MakeTransactionRef(tx);
+                cachedPool.addUnchecked(entry.Fee(2000 * (j + 1)).Height(blocknum).FromTx(ptx));
+                freshPool.addUnchecked(entry.Fee(2000 * (j + 1)).Height(blocknum).FromTx(ptx));
+                // Leave the lowest feerate transactions unconfirmed
+                (j < 3 ? unconfirmed : block).push_back(ptx);
+            }
+        }
+        cachedPool.removeForBlock(block, ++blocknum);
+        freshPool.removeForBlock(block, blocknum);
+        CheckSameSmartFeeEstimates(cachedEst, freshEst);
+    }
+
+    // Removing a transaction that entered the mempool before the last block
+    // changes the estimation data, so cached estimates must not be served.
+    FeeCalculation before;
+    cachedEst.estimateSmartFee(2, &before, false);
+    for (const CTransactionRef& ptx : unconfirmed) {
+        BOOST_CHECK(cachedEst.removeTx(ptx->GetHash(), /*inBlock=*/false));
+        BOOST_CHECK(freshEst.removeTx(ptx->GetHash(), /*inBlock=*/false));
+    }
+    CheckSameSmartFeeEstimates(cachedEst, freshEst);
+    FeeCalculation after;
+    cachedEst.estimateSmartFee(2, &after, false);
+    BOOST_CHECK(after.est.fail.inMempool != before.est.fail.inMempool || after.est.pass.inMempool != before.est.pass.inMempool);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
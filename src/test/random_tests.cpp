@@ -10,6 +10,9 @@
 
 #include <algorithm>
 #include <random>
+#include <set>
+#include <thread>
+#include <vector>
 
 BOOST_FIXTURE_TEST_SUITE(random_tests, BasicTestingSetup)
 
@@ -66,6 +69,33 @@ BOOST_AUTO_TEST_CASE(fastrandom_tests)
     }
 }
 
+BOOST_AUTO_TEST_CASE(getrandbytes_threads)
+{
+    // Draw enough values on each thread to cross several refills and rekeys of its stream,
+    // and check that no value repeats, within or across threads.
+    constexpr int N_THREADS{4};
+    constexpr int DRAWS{1000};
+    std::vector<std::vector<uint256>> drawn(N_THREADS);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < N_THREADS; ++t) {
+        threads.emplace_back([&drawn, t] {
+            for (int i = 0; i < DRAWS; ++i) drawn[t].push_back(GetRandHash());
+        });
+    }
+    for (std::thread& thread : threads) thread.join();
+
+    std::set<uint256> all;
+    for (const auto& values : drawn) all.insert(values.begin(), values.end());
+    BOOST_CHECK_EQUAL(all.size(), size_t{N_THREADS * DRAWS});
+
+    // Requests of every size up to 32 bytes are served, including ones that straddle a refill.
+    for (int num = 0; num <= 32; ++num) {
+        unsigned char buf[33] = {0};
+        for (int i = 0; i < 20; ++i) GetRandBytes(buf, num);
+        BOOST_CHECK_EQUAL(buf[32], 0);
+    }
+}
+
 BOOST_AUTO_TEST_CASE(fastrandom_randbits)
 {
     FastRandomContext ctx1;
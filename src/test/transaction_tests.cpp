@@ -15,6 +15,7 @@
 #include <key.h>
 #include <policy/policy.h>
 #include <policy/settings.h>
+#include <primitives/block.h>
 #include <script/script.h>
 #include <script/script_error.h>
 #include <script/sign.h>
@@ -30,6 +31,7 @@
 #include <functional>
 #include <map>
 #include <string>
+#include <thread>
 
 #include <boost/algorithm/string/classification.hpp>
 #include <boost/algorithm/string/split.hpp>
@@ -383,6 +385,99 @@ BOOST_AUTO_TEST_CASE(basic_transaction_tests)
     BOOST_CHECK_MESSAGE(!CheckTransaction(CTransaction(tx), state) || !state.IsValid(), "Transaction with duplicate txins should be invalid.");
 }
 
+/** Random transactions of varying size, every other one with a witness. */
+static std::vector<CMutableTransaction> RandomTransactions(int count)
+{
+    const auto random_script{[](size_t max_len) {
+        const auto bytes{g_insecure_rand_ctx.randbytes(InsecureRandRange(max_len))};
+        return CScript(bytes.begin(), bytes.end());
+    }};
+    std::vector<CMutableTransaction> txs;
+    for (int i = 0; i < count; ++i) {
+        CMutableTransaction tx;
+        tx.nVersion = InsecureRand32();
+        tx.nLockTime = InsecureRand32();
+        for (int j = InsecureRandRange(5); j >= 0; --j) {
+            tx.vin.emplace_back(InsecureRand256(), InsecureRand32(), random_script(200));
+            if (i % 2) tx.vin.back().scriptWitness.stack.push_back(g_insecure_rand_ctx.randbytes(InsecureRandRange(100)));
+        }
+        for (int j = InsecureRandRange(5); j >= 0; --j) {
+            tx.vout.emplace_back(InsecureRandRange(COIN), random_script(50));
+        }
+        txs.push_back(tx);
+    }
+    return txs;
+}
+
+BOOST_AUTO_TEST_CASE(make_transaction_refs)
+{
+    const std::vector<CMutableTransaction> txs{RandomTransactions(50)};
+    const std::vector<CTransactionRef> refs{MakeTransactionRefs(std::vector<CMutableTransaction>{txs})};
+    BOOST_REQUIRE_EQUAL(refs.size(), txs.size());
+    for (size_t i = 0; i < txs.size(); ++i) {
+        const CTransaction tx{txs[i]};
+        BOOST_CHECK_EQUAL(refs[i]->GetHash(), tx.GetHash());
+        BOOST_CHECK_EQUAL(refs[i]->GetWitnessHash(), tx.GetWitnessHash());
+        BOOST_CHECK(refs[i]->vin == tx.vin);
+        BOOST_CHECK(refs[i]->vout == tx.vout);
+    }
+    BOOST_CHECK(MakeTransactionRefs({}).empty());
+}
+
+BOOST_AUTO_TEST_CASE(lazy_transaction_hashes)
+{
+    CBlock block;
+    for (const CMutableTransaction& tx : RandomTransactions(50)) {
+        block.vtx.push_back(MakeTransactionRef(tx));
+    }
+    CDataStream stream{SER_NETWORK, PROTOCOL_VERSION};
+    stream << block;
+
+    CBlock lazy_block;
+    CDataStream lazy_stream{SER_NETWORK, PROTOCOL_VERSION | SERIALIZE_TRANSACTION_LAZY_HASH};
+    lazy_stream << block;
+    lazy_stream >> lazy_block;
+    BOOST_REQUIRE_EQUAL(lazy_block.vtx.size(), block.vtx.size());
+    for (size_t i = 0; i < block.vtx.size(); ++i) {
+        // Alternate which hash is computed first, as the wtxid of a transaction
+        // without witness is its txid.
+        if (i % 4 < 2) {
+            BOOST_CHECK_EQUAL(lazy_block.vtx[i]->GetHash(), block.vtx[i]->GetHash());
+            BOOST_CHECK_EQUAL(lazy_block.vtx[i]->GetWitnessHash(), block.vtx[i]->GetWitnessHash());
+        } else {
+            BOOST_CHECK_EQUAL(lazy_block.vtx[i]->GetWitnessHash(), block.vtx[i]->GetWitnessHash());
+            BOOST_CHECK_EQUAL(lazy_block.vtx[i]->GetHash(), block.vtx[i]->GetHash());
+        }
+    }
+    BOOST_CHECK(lazy_block.GetHash() == block.GetHash());
+
+    // Serializing a lazily hashed block does not depend on its hashes.
+    CDataStream reserialized{SER_NETWORK, PROTOCOL_VERSION};
+    lazy_stream << block;
+    lazy_stream >> lazy_block;
+    reserialized << lazy_block;
+    BOOST_CHECK(reserialized.str() == stream.str());
+
+    // Several threads may ask for the hashes of the same transaction at once.
+    lazy_stream << block;
+    lazy_stream >> lazy_block;
+    std::vector<std::thread> threads;
+    std::vector<std::pair<uint256, uint256>> results(4 * lazy_block.vtx.size());
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&, t] {
+            for (size_t i = 0; i < lazy_block.vtx.size(); ++i) {
+                results[t * lazy_block.vtx.size() + i] = {lazy_block.vtx[i]->GetHash(), lazy_block.vtx[i]->GetWitnessHash()};
+            }
+        });
+    }
+    for (std::thread& thread : threads) thread.join();
+    for (size_t i = 0; i < results.size(); ++i) {
+        const CTransaction& tx{*block.vtx[i % block.vtx.size()]};
+        BOOST_CHECK_EQUAL(results[i].first, tx.GetHash());
+        BOOST_CHECK_EQUAL(results[i].second, tx.GetWitnessHash());
+    }
+}
+
 BOOST_AUTO_TEST_CASE(test_Get)
 {
     FillableSigningProvider keystore;
@@ -2,12 +2,15 @@
 // Distributed under the MIT software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
+#include <coins.h>
 #include <consensus/validation.h>
 #include <key_io.h>
 #include <policy/packages.h>
 #include <policy/policy.h>
 #include <primitives/transaction.h>
 #include <script/script.h>
+#include <script/sign.h>
+#include <script/signingprovider.h>
 #include <script/standard.h>
 #include <test/util/setup_common.h>
 #include <validation.h>
@@ -49,4 +52,109 @@ BOOST_FIXTURE_TEST_CASE(tx_mempool_reject_coinbase, TestChain100Setup)
     BOOST_CHECK_EQUAL(result.m_state.GetRejectReason(), "coinbase");
     BOOST_CHECK(result.m_state.GetResult() == TxValidationResult::TX_CONSENSUS);
 }
+
+/**
+ * Ensure that a batch of transactions gets the results of accepting them one by one.
+ */
+BOOST_FIXTURE_TEST_CASE(tx_mempool_batch, TestChain100Setup)
+{
+    const CScript script{GetScriptForRawPubKey(coinbaseKey.GetPubKey())};
+
+    // Fan a mature coinbase out into outputs to spend independently.
+    CMutableTransaction fan_out;
+    fan_out.vin.emplace_back(COutPoint{m_coinbase_txns[0]->GetHash(), 0});
+    fan_out.vout.assign(5, CTxOut{10 * CENT, script});
+    {
+        FillableSigningProvider keystore;
+        keystore.AddKey(coinbaseKey);
+        std::map<COutPoint, Coin> input_coins{{fan_out.vin[0].prevout, Coin{m_coinbase_txns[0]->vout[0], 1, /*fCoinBaseIn=*/true}}};
+        std::map<int, bilingual_str> input_errors;
+        BOOST_REQUIRE(SignTransaction(fan_out, &keystore, input_coins, SIGHASH_ALL, input_errors));
+    }
+    const CTransactionRef fan_out_tx{CreateAndProcessBlock({fan_out}, script).vtx[1]};
+    const auto spend = [&](int vout, CAmount fee) {
+        return MakeTransactionRef(CreateValidMempoolTransaction(fan_out_tx, vout, 101, coinbaseKey, script, 10 * CENT - fee, /*submit=*/false));
+    };
+
+    const CTransactionRef in_mempool{spend(0, 1000)};
+    BOOST_CHECK(WITH_LOCK(cs_main, return m_node.chainman->ProcessTransaction(in_mempool)).m_result_type == MempoolAcceptResult::ResultType::VALID);
+
+    const CTransactionRef parent{spend(1, 1000)};
+    const CTransactionRef child{MakeTransactionRef(CreateValidMempoolTransaction(parent, 0, 102, coinbaseKey, script, parent->vout[0].nValue - 1000, /*submit=*/false))};
+    const CTransactionRef independent{spend(2, 1000)};
+    const CTransactionRef conflicting{spend(2, 2000)};
+    // Changing an output after signing invalidates the signature.
+    CMutableTransaction bad_signature{*spend(3, 1000)};
+    bad_signature.vout[0].nValue -= 1;
+
+    const std::vector<MempoolAcceptResult> results{m_node.chainman->ProcessTransactions({in_mempool, parent, child, independent, conflicting, MakeTransactionRef(bad_signature)})};
+    BOOST_REQUIRE_EQUAL(results.size(), 6U);
+    BOOST_CHECK_EQUAL(results[0].m_state.GetRejectReason(), "txn-already-in-mempool");
+    BOOST_CHECK(results[1].m_result_type == MempoolAcceptResult::ResultType::VALID);
+    BOOST_CHECK(results[2].m_result_type == MempoolAcceptResult::ResultType::VALID);
+    BOOST_CHECK(results[3].m_result_type == MempoolAcceptResult::ResultType::VALID);
+    BOOST_CHECK_EQUAL(results[4].m_state.GetRejectReason(), "txn-mempool-conflict");
+    BOOST_CHECK(results[5].m_result_type == MempoolAcceptResult::ResultType::INVALID);
+    BOOST_CHECK(results[5].m_state.GetResult() == TxValidationResult::TX_CONSENSUS);
+    BOOST_CHECK_EQUAL(m_node.mempool->size(), 4U);
+    BOOST_CHECK(m_node.mempool->exists(GenTxid::Txid(child->GetHash())));
+
+    // Test accepting a batch leaves the mempool alone.
+    const CTransactionRef test_only{spend(4, 1000)};
+    const std::vector<MempoolAcceptResult> test_results{m_node.chainman->ProcessTransactions({test_only}, /*test_accept=*/true)};
+    BOOST_REQUIRE_EQUAL(test_results.size(), 1U);
+    BOOST_CHECK(test_results[0].m_result_type == MempoolAcceptResult::ResultType::VALID);
+    BOOST_CHECK_EQUAL(m_node.mempool->size(), 4U);
+}
+BOOST_FIXTURE_TEST_CASE(tx_mempool_reorg, TestChain100Setup)
+{
+    const CScript script{GetScriptForRawPubKey(coinbaseKey.GetPubKey())};
+    FillableSigningProvider keystore;
+    keystore.AddKey(coinbaseKey);
+
+    CMutableTransaction fan_out;
+    fan_out.vin.emplace_back(COutPoint{m_coinbase_txns[0]->GetHash(), 0});
+    fan_out.vout.assign(2, CTxOut{10 * CENT, script});
+    {
+        std::map<COutPoint, Coin> input_coins{{fan_out.vin[0].prevout, Coin{m_coinbase_txns[0]->vout[0], 1, /*fCoinBaseIn=*/true}}};
+        std::map<int, bilingual_str> input_errors;
+        BOOST_REQUIRE(SignTransaction(fan_out, &keystore, input_coins, SIGHASH_ALL, input_errors));
+    }
+    const CTransactionRef fan_out_tx{CreateAndProcessBlock({fan_out}, script).vtx[1]};
+
+    // Confirm a chain of two transactions, and a nonstandard transaction with a child.
+    const CTransactionRef parent{MakeTransactionRef(CreateValidMempoolTransaction(fan_out_tx, 0, 101, coinbaseKey, script, 10 * CENT - 1000, /*submit=*/false))};
+    const CTransactionRef child{MakeTransactionRef(CreateValidMempoolTransaction(parent, 0, 102, coinbaseKey, script, parent->vout[0].nValue - 1000, /*submit=*/false))};
+    CMutableTransaction nonstandard;
+    nonstandard.nVersion = TX_MAX_STANDARD_VERSION + 1;
+    nonstandard.vin.emplace_back(COutPoint{fan_out_tx->GetHash(), 1});
+    nonstandard.vout.emplace_back(10 * CENT - 1000, script);
+    {
+        std::map<COutPoint, Coin> input_coins{{nonstandard.vin[0].prevout, Coin{fan_out_tx->vout[1], 101, /*fCoinBaseIn=*/false}}};
+        std::map<int, bilingual_str> input_errors;
+        BOOST_REQUIRE(SignTransaction(nonstandard, &keystore, input_coins, SIGHASH_ALL, input_errors));
+    }
+    const CTransactionRef nonstandard_tx{MakeTransactionRef(nonstandard)};
+    const CTransactionRef orphan{MakeTransactionRef(CreateValidMempoolTransaction(nonstandard_tx, 0, 102, coinbaseKey, script, nonstandard.vout[0].nValue - 1000, /*submit=*/false))};
+    CreateAndProcessBlock({CMutableTransaction{*parent}, CMutableTransaction{*child}, nonstandard, CMutableTransaction{*orphan}}, script);
+    BOOST_CHECK_EQUAL(m_node.mempool->size(), 0U);
+
+    // A mempool transaction spending the confirmed chain becomes their descendant on the reorg.
+    const CTransactionRef grandchild{MakeTransactionRef(CreateValidMempoolTransaction(child, 0, 103, coinbaseKey, script, child->vout[0].nValue - 1000, /*submit=*/true))};
+    BOOST_CHECK_EQUAL(m_node.mempool->size(), 1U);
+
+    BlockValidationState state;
+    CBlockIndex* tip{WITH_LOCK(cs_main, return m_node.chainman->ActiveChain().Tip())};
+    BOOST_REQUIRE(m_node.chainman->ActiveChainstate().InvalidateBlock(state, tip));
+
+    LOCK(m_node.mempool->cs);
+    BOOST_CHECK_EQUAL(m_node.mempool->size(), 3U);
+    BOOST_CHECK(!m_node.mempool->exists(GenTxid::Txid(nonstandard_tx->GetHash())));
+    BOOST_CHECK(!m_node.mempool->exists(GenTxid::Txid(orphan->GetHash())));
+    const auto parent_it{m_node.mempool->GetIter(parent->GetHash())};
+    const auto grandchild_it{m_node.mempool->GetIter(grandchild->GetHash())};
+    BOOST_REQUIRE(parent_it && grandchild_it && m_node.mempool->exists(GenTxid::Txid(child->GetHash())));
+    BOOST_CHECK_EQUAL((*parent_it)->GetCountWithDescendants(), 3U);
+    BOOST_CHECK_EQUAL((*grandchild_it)->GetCountWithAncestors(), 3U);
+}
 BOOST_AUTO_TEST_SUITE_END()
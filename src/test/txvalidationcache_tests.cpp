@@ -383,4 +383,42 @@ BOOST_FIXTURE_TEST_CASE(checkinputs_test, Dersig100Setup)
     }
 }
 
+BOOST_FIXTURE_TEST_CASE(mempool_precomputed_txdata, TestChain100Setup)
+{
+    const CScript p2pk_scriptPubKey = CScript() << ToByteVector(coinbaseKey.GetPubKey()) << OP_CHECKSIG;
+    const CScript p2wpkh_scriptPubKey = GetScriptForDestination(WitnessV0KeyHash(coinbaseKey.GetPubKey()));
+
+    // A transaction with only legacy inputs has no sighash midstates to keep.
+    const CMutableTransaction funding_tx = CreateValidMempoolTransaction(m_coinbase_txns[0], 0, 0, coinbaseKey, p2wpkh_scriptPubKey, 49 * COIN);
+    WITH_LOCK(m_node.mempool->cs, BOOST_CHECK(!m_node.mempool->GetPrecomputedTxData(funding_tx.GetHash())));
+    CreateAndProcessBlock({funding_tx}, p2pk_scriptPubKey);
+
+    // A segwit spend keeps them, without the spent outputs.
+    const CTransaction spend_tx{CreateValidMempoolTransaction(MakeTransactionRef(funding_tx), 0, 101, coinbaseKey, p2pk_scriptPubKey, 48 * COIN)};
+    {
+        LOCK(m_node.mempool->cs);
+        const auto txdata = m_node.mempool->GetPrecomputedTxData(spend_tx.GetHash());
+        BOOST_REQUIRE(txdata);
+        BOOST_CHECK(txdata->m_bip143_segwit_ready);
+        BOOST_CHECK(!txdata->m_spent_outputs_ready);
+        BOOST_CHECK(txdata->m_spent_outputs.empty());
+        const PrecomputedTransactionData expected{spend_tx};
+        BOOST_CHECK_EQUAL(txdata->hashPrevouts, expected.hashPrevouts);
+        BOOST_CHECK_EQUAL(txdata->hashSequence, expected.hashSequence);
+        BOOST_CHECK_EQUAL(txdata->hashOutputs, expected.hashOutputs);
+
+        // Initializing a copy with the spent outputs keeps the midstates.
+        PrecomputedTransactionData copy{*txdata};
+        copy.Init(spend_tx, {CTxOut{49 * COIN, p2wpkh_scriptPubKey}});
+        BOOST_CHECK(copy.m_spent_outputs_ready);
+        BOOST_CHECK_EQUAL(copy.hashPrevouts, expected.hashPrevouts);
+        BOOST_CHECK_EQUAL(copy.hashOutputs, expected.hashOutputs);
+    }
+
+    // A block with the transaction is connected using them.
+    const CBlock block = CreateAndProcessBlock({CMutableTransaction{spend_tx}}, p2pk_scriptPubKey);
+    BOOST_CHECK_EQUAL(WITH_LOCK(cs_main, return m_node.chainman->ActiveChain().Tip()->GetBlockHash()), block.GetHash());
+    BOOST_CHECK_EQUAL(m_node.mempool->size(), 0U);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
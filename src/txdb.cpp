@@ -15,7 +15,12 @@
 #include <util/translation.h>
 #include <util/vector.h>
 
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
 #include <stdint.h>
+#include <thread>
 
 static constexpr uint8_t DB_COIN{'C'};
 static constexpr uint8_t DB_COINS{'c'};
@@ -28,6 +33,15 @@ static constexpr uint8_t DB_FLAG{'F'};
 static constexpr uint8_t DB_REINDEX_FLAG{'R'};
 static constexpr uint8_t DB_LAST_BLOCK{'l'};
 
+//! Maximum number of threads reading the block index from disk on startup.
+static constexpr int MAX_BLOCK_INDEX_LOAD_THREADS{8};
+//! Number of entries handed over by a block index loader thread at once.
+static constexpr size_t BLOCK_INDEX_LOAD_BATCH_SIZE{1024};
+//! Maximum number of loaded batches waiting to be added to the block index.
+static constexpr size_t MAX_BLOCK_INDEX_LOAD_BATCHES{32};
+//! Size of a serialized block header, which is the last part of a serialized CDiskBlockIndex.
+static constexpr size_t BLOCK_HEADER_SIZE{80};
+
 // Keys used in previous version that might still be found in the DB:
 static constexpr uint8_t DB_TXINDEX_BLOCK{'T'};
 //               uint8_t DB_TXINDEX{'t'}
@@ -294,21 +308,109 @@ bool CBlockTreeDB::ReadFlag(const std::string &name, bool &fValue) {
     return true;
 }
 
+namespace {
+
+/** A block index entry read from the database by a loader thread, before it is added to the block index. */
+struct LoadedBlockIndexEntry {
+    //! Serialized CDiskBlockIndex, with the database obfuscation removed.
+    std::vector<unsigned char> data;
+    //! Hash of the block header that ends the serialized entry.
+    uint256 hash;
+    bool valid_pow{false};
+
+    template <typename Stream>
+    void Unserialize(Stream& s)
+    {
+        data.resize(s.size());
+        s.read(MakeWritableByteSpan(data));
+    }
+};
+
+} // namespace
+
 bool CBlockTreeDB::LoadBlockIndexGuts(const Consensus::Params& consensusParams, std::function<CBlockIndex*(const uint256&)> insertBlockIndex)
 {
     AssertLockHeld(::cs_main);
-    std::unique_ptr<CDBIterator> pcursor(NewIterator());
-    pcursor->Seek(std::make_pair(DB_BLOCK_INDEX, uint256()));
 
-    // Load m_block_index
-    while (pcursor->Valid()) {
-        if (ShutdownRequested()) return false;
-        std::pair<uint8_t, uint256> key;
-        if (pcursor->GetKey(key) && key.first == DB_BLOCK_INDEX) {
-            CDiskBlockIndex diskindex;
-            if (pcursor->GetValue(diskindex)) {
+    // Reading entries from leveldb and hashing their headers is done by
+    // several threads, each iterating over its own range of block hashes.
+    // Deserializing a CDiskBlockIndex requires cs_main, which is held by this
+    // thread, so the loader threads only hash the header (the last
+    // BLOCK_HEADER_SIZE bytes of the serialized entry) and hand over the raw
+    // entries in batches. They are then added to the block index here.
+    const int num_threads{std::clamp(GetNumCores(), 1, MAX_BLOCK_INDEX_LOAD_THREADS)};
+
+    Mutex mutex;
+    std::condition_variable cond;
+    std::deque<std::vector<LoadedBlockIndexEntry>> batches;
+    int running{num_threads};
+    bool read_error{false};
+    std::atomic<bool> interrupt{false};
+
+    const auto load_range = [&](uint8_t begin, uint8_t last) {
+        std::unique_ptr<CDBIterator> pcursor(NewIterator());
+        uint256 start;
+        *start.begin() = begin;
+        pcursor->Seek(std::make_pair(DB_BLOCK_INDEX, start));
+
+        std::vector<LoadedBlockIndexEntry> batch;
+        const auto flush = [&] {
+            WAIT_LOCK(mutex, lock);
+            cond.wait(lock, [&] { return batches.size() < MAX_BLOCK_INDEX_LOAD_BATCHES || interrupt; });
+            batches.push_back(std::move(batch));
+            batch.clear();
+            cond.notify_all();
+        };
+        while (pcursor->Valid() && !interrupt) {
+            std::pair<uint8_t, uint256> key;
+            if (!pcursor->GetKey(key) || key.first != DB_BLOCK_INDEX || *key.second.begin() > last) break;
+            LoadedBlockIndexEntry& entry{batch.emplace_back()};
+            if (!pcursor->GetValue(entry) || entry.data.size() < BLOCK_HEADER_SIZE) {
+                LOCK(mutex);
+                read_error = true;
+                break;
+            }
+            CBlockHeader header;
+            SpanReader{SER_DISK, CLIENT_VERSION, Span{entry.data}.last(BLOCK_HEADER_SIZE)} >> header;
+            entry.hash = header.GetHash();
+            entry.valid_pow = CheckProofOfWork(entry.hash, header.nBits, consensusParams);
+            if (batch.size() == BLOCK_INDEX_LOAD_BATCH_SIZE) flush();
+            pcursor->Next();
+        }
+        if (!batch.empty()) flush();
+        LOCK(mutex);
+        --running;
+        cond.notify_all();
+    };
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < num_threads; ++i) {
+        threads.emplace_back(load_range, 256 * i / num_threads, 256 * (i + 1) / num_threads - 1);
+    }
+
+    const auto load_entries = [&]() EXCLUSIVE_LOCKS_REQUIRED(::cs_main) {
+        while (true) {
+            std::vector<LoadedBlockIndexEntry> batch;
+            {
+                WAIT_LOCK(mutex, lock);
+                cond.wait(lock, [&] { return !batches.empty() || running == 0 || read_error; });
+                if (read_error) return error("%s: failed to read value", __func__);
+                if (batches.empty()) return true;
+                batch = std::move(batches.front());
+                batches.pop_front();
+                cond.notify_all();
+            }
+            for (const LoadedBlockIndexEntry& entry : batch) {
+                if (ShutdownRequested()) return false;
+                CDiskBlockIndex diskindex;
+                try {
+                    SpanReader{SER_DISK, CLIENT_VERSION, entry.data} >> diskindex;
+                } catch (const std::exception&) {
+                    return error("%s: failed to read value", __func__);
+                }
+
                 // Construct block index object
-                CBlockIndex* pindexNew = insertBlockIndex(diskindex.GetBlockHash());
+                CBlockIndex* pindexNew = insertBlockIndex(entry.hash);
                 pindexNew->pprev          = insertBlockIndex(diskindex.hashPrev);
                 pindexNew->nHeight        = diskindex.nHeight;
                 pindexNew->nFile          = diskindex.nFile;
@@ -322,20 +424,18 @@ bool CBlockTreeDB::LoadBlockIndexGuts(const Consensus::Params& consensusParams,
                 pindexNew->nStatus        = diskindex.nStatus;
                 pindexNew->nTx            = diskindex.nTx;
 
-                if (!CheckProofOfWork(pindexNew->GetBlockHash(), pindexNew->nBits, consensusParams)) {
+                if (!entry.valid_pow) {
                     return error("%s: CheckProofOfWork failed: %s", __func__, pindexNew->ToString());
                 }
-
-                pcursor->Next();
-            } else {
-                return error("%s: failed to read value", __func__);
             }
-        } else {
-            break;
         }
-    }
+    };
 
-    return true;
+    const bool ret{load_entries()};
+    interrupt = true;
+    WITH_LOCK(mutex, cond.notify_all());
+    for (std::thread& thread : threads) thread.join();
+    return ret;
 }
 
 namespace {
@@ -14,13 +14,16 @@
 #include <policy/policy.h>
 #include <policy/settings.h>
 #include <reverse_iterator.h>
+#include <script/interpreter.h>
 #include <util/moneystr.h>
 #include <util/system.h>
 #include <util/time.h>
 #include <validationinterface.h>
 
+#include <algorithm>
 #include <cmath>
 #include <optional>
+#include <unordered_map>
 
 // Helpers for modifying CTxMemPool::mapTx, which is a boost multi_index.
 struct update_descendant_state
@@ -81,6 +84,27 @@ bool TestLockPointValidity(CChain& active_chain, const LockPoints& lp)
     return true;
 }
 
+std::pair<CTxMemPoolEntryRefs::const_iterator, bool> CTxMemPoolEntryRefs::insert(const CTxMemPoolEntry& entry)
+{
+    const auto it{std::lower_bound(m_entries.begin(), m_entries.end(), std::cref(entry), CompareIteratorByHash{})};
+    if (it != m_entries.end() && &it->get() == &entry) return {it, false};
+    return {m_entries.insert(it, entry), true};
+}
+
+size_t CTxMemPoolEntryRefs::erase(const CTxMemPoolEntry& entry)
+{
+    const auto it{std::lower_bound(m_entries.begin(), m_entries.end(), std::cref(entry), CompareIteratorByHash{})};
+    if (it == m_entries.end() || &it->get() != &entry) return 0;
+    m_entries.erase(it);
+    return 1;
+}
+
+size_t CTxMemPoolEntryRefs::count(const CTxMemPoolEntry& entry) const
+{
+    const auto it{std::lower_bound(m_entries.begin(), m_entries.end(), std::cref(entry), CompareIteratorByHash{})};
+    return it != m_entries.end() && &it->get() == &entry;
+}
+
 CTxMemPoolEntry::CTxMemPoolEntry(const CTransactionRef& tx, CAmount fee,
                                  int64_t time, unsigned int entry_height,
                                  bool spends_coinbase, int64_t sigops_cost, LockPoints lp)
@@ -99,6 +123,14 @@ CTxMemPoolEntry::CTxMemPoolEntry(const CTransactionRef& tx, CAmount fee,
       nModFeesWithAncestors{nFee},
       nSigOpCostWithAncestors{sigOpCost} {}
 
+void CTxMemPoolEntry::SetPrecomputedTxData(std::shared_ptr<const PrecomputedTransactionData> txdata)
+{
+    assert(!txdata->m_spent_outputs_ready && !txdata->m_legacy_ready);
+    nUsageSize -= memusage::DynamicUsage(m_precomputed_txdata);
+    m_precomputed_txdata = std::move(txdata);
+    nUsageSize += memusage::DynamicUsage(m_precomputed_txdata);
+}
+
 void CTxMemPoolEntry::UpdateFeeDelta(int64_t newFeeDelta)
 {
     nModFeesWithDescendants += newFeeDelta - feeDelta;
@@ -155,6 +187,7 @@ void CTxMemPool::UpdateForDescendants(txiter updateIt, cacheMap& cachedDescendan
             cachedDescendants[updateIt].insert(mapTx.iterator_to(descendant));
             // Update ancestor state for each descendant
             mapTx.modify(mapTx.iterator_to(descendant), update_ancestor_state(updateIt->GetTxSize(), updateIt->GetModifiedFee(), 1, updateIt->GetSigOpCost()));
+            MarkChanged(descendant);
             // Don't directly remove the transaction here -- doing so would
             // invalidate iterators in cachedDescendants. Mark it for removal
             // by inserting into descendants_to_remove.
@@ -164,6 +197,7 @@ void CTxMemPool::UpdateForDescendants(txiter updateIt, cacheMap& cachedDescendan
         }
     }
     mapTx.modify(updateIt, update_descendant_state(modifySize, modifyFee, modifyCount));
+    MarkChanged(*updateIt);
 }
 
 void CTxMemPool::UpdateTransactionsFromBlock(const std::vector<uint256> &vHashesToUpdate, uint64_t ancestor_size_limit, uint64_t ancestor_count_limit)
@@ -356,6 +390,7 @@ void CTxMemPool::UpdateAncestorsOf(bool add, txiter it, setEntries &setAncestors
     const CAmount updateFee = updateCount * it->GetModifiedFee();
     for (txiter ancestorIt : setAncestors) {
         mapTx.modify(ancestorIt, update_descendant_state(updateSize, updateFee, updateCount));
+        MarkChanged(*ancestorIt);
     }
 }
 
@@ -371,6 +406,7 @@ void CTxMemPool::UpdateEntryForAncestors(txiter it, const setEntries &setAncesto
         updateSigOpsCost += ancestorIt->GetSigOpCost();
     }
     mapTx.modify(it, update_ancestor_state(updateSize, updateFee, updateCount, updateSigOpsCost));
+    MarkChanged(*it);
 }
 
 void CTxMemPool::UpdateChildrenForRemoval(txiter it)
@@ -402,6 +438,7 @@ void CTxMemPool::UpdateForRemoveFromMempool(const setEntries &entriesToRemove, b
             int modifySigOps = -removeIt->GetSigOpCost();
             for (txiter dit : setDescendants) {
                 mapTx.modify(dit, update_ancestor_state(modifySize, modifyFee, -1, modifySigOps));
+                MarkChanged(*dit);
             }
         }
     }
@@ -503,6 +540,7 @@ void CTxMemPool::addUnchecked(const CTxMemPoolEntry &entry, setEntries &setAnces
     // (When we update the entry for in-mempool parents, memory usage will be
     // further updated.)
     cachedInnerUsage += entry.DynamicMemoryUsage();
+    m_total_tx_usage += RecursiveDynamicUsage(entry.GetSharedTx());
 
     const CTransaction& tx = newit->GetTx();
     std::set<uint256> setParentTransactions;
@@ -555,6 +593,12 @@ void CTxMemPool::removeUnchecked(txiter it, MemPoolRemovalReason reason)
 
     RemoveUnbroadcastTx(hash, true /* add logging because unchecked */ );
 
+    m_snapshot_removals.emplace_back(mempool_sequence, hash);
+    if (m_snapshot_removals.size() > MAX_SNAPSHOT_REMOVALS) {
+        m_snapshot_removals_pruned = m_snapshot_removals.front().first;
+        m_snapshot_removals.pop_front();
+    }
+
     if (vTxHashes.size() > 1) {
         vTxHashes[it->vTxHashesIdx] = std::move(vTxHashes.back());
         vTxHashes[it->vTxHashesIdx].second->vTxHashesIdx = it->vTxHashesIdx;
@@ -567,7 +611,9 @@ void CTxMemPool::removeUnchecked(txiter it, MemPoolRemovalReason reason)
     totalTxSize -= it->GetTxSize();
     m_total_fee -= it->GetFee();
     cachedInnerUsage -= it->DynamicMemoryUsage();
-    cachedInnerUsage -= memusage::DynamicUsage(it->GetMemPoolParentsConst()) + memusage::DynamicUsage(it->GetMemPoolChildrenConst());
+    m_total_tx_usage -= RecursiveDynamicUsage(it->GetSharedTx());
+    cachedInnerUsage -= it->GetMemPoolParentsConst().DynamicMemoryUsage() + it->GetMemPoolChildrenConst().DynamicMemoryUsage();
+    InvalidateCluster(it);
     mapTx.erase(it);
     nTransactionsUpdated++;
     if (minerPolicyEstimator) {minerPolicyEstimator->removeTx(hash, false);}
@@ -709,6 +755,10 @@ void CTxMemPool::_clear()
     totalTxSize = 0;
     m_total_fee = 0;
     cachedInnerUsage = 0;
+    m_total_tx_usage = 0;
+    // Entries are dropped without recording their removal.
+    m_snapshot_removals.clear();
+    m_snapshot_removals_pruned = m_sequence_number - 1;
     lastRollingFeeUpdate = GetTime();
     blockSinceLastRollingFeeBump = false;
     rollingMinimumFeeRate = 0;
@@ -734,6 +784,7 @@ void CTxMemPool::check(const CCoinsViewCache& active_coins_tip, int64_t spendhei
     uint64_t checkTotal = 0;
     CAmount check_total_fee{0};
     uint64_t innerUsage = 0;
+    uint64_t tx_usage{0};
     uint64_t prev_ancestor_count{0};
 
     CCoinsViewCache mempoolDuplicate(const_cast<CCoinsViewCache*>(&active_coins_tip));
@@ -742,8 +793,9 @@ void CTxMemPool::check(const CCoinsViewCache& active_coins_tip, int64_t spendhei
         checkTotal += it->GetTxSize();
         check_total_fee += it->GetFee();
         innerUsage += it->DynamicMemoryUsage();
+        tx_usage += RecursiveDynamicUsage(it->GetSharedTx());
         const CTransaction& tx = it->GetTx();
-        innerUsage += memusage::DynamicUsage(it->GetMemPoolParentsConst()) + memusage::DynamicUsage(it->GetMemPoolChildrenConst());
+        innerUsage += it->GetMemPoolParentsConst().DynamicMemoryUsage() + it->GetMemPoolChildrenConst().DynamicMemoryUsage();
         CTxMemPoolEntry::Parents setParentCheck;
         for (const CTxIn &txin : tx.vin) {
             // Check that every mempool transaction's inputs refer to available coins, or other mempool tx's.
@@ -827,6 +879,7 @@ void CTxMemPool::check(const CCoinsViewCache& active_coins_tip, int64_t spendhei
     assert(totalTxSize == checkTotal);
     assert(m_total_fee == check_total_fee);
     assert(innerUsage == cachedInnerUsage);
+    assert(tx_usage == m_total_tx_usage);
 }
 
 bool CTxMemPool::CompareDepthAndScore(const uint256& hasha, const uint256& hashb, bool wtxid)
@@ -905,6 +958,39 @@ std::vector<TxMempoolInfo> CTxMemPool::infoAll() const
     return ret;
 }
 
+std::optional<MempoolSnapshot> CTxMemPool::GetSnapshot(std::optional<uint64_t> since) const
+{
+    MempoolSnapshot snapshot;
+    LOCK(cs);
+    snapshot.sequence = m_sequence_number;
+    if (since) {
+        if (*since <= m_snapshot_removals_pruned || *since > m_sequence_number) return std::nullopt;
+        // Removals are recorded in sequence order.
+        auto removal{std::lower_bound(m_snapshot_removals.begin(), m_snapshot_removals.end(), *since,
+                                      [](const auto& removal, uint64_t sequence) { return removal.first < sequence; })};
+        for (; removal != m_snapshot_removals.end(); ++removal) {
+            snapshot.removed.push_back(removal->second);
+        }
+    }
+    snapshot.entries.reserve(since ? 0 : mapTx.size());
+    for (const CTxMemPoolEntry& entry : mapTx) {
+        if (since && entry.m_changed_sequence < *since) continue;
+        snapshot.entries.push_back(MempoolSnapshotEntry{
+            entry.GetTx().GetHash(),
+            entry.GetFee(),
+            entry.GetModifiedFee(),
+            static_cast<uint32_t>(entry.GetTxSize()),
+            entry.GetCountWithAncestors(),
+            entry.GetSizeWithAncestors(),
+            entry.GetModFeesWithAncestors(),
+            entry.GetCountWithDescendants(),
+            entry.GetSizeWithDescendants(),
+            entry.GetModFeesWithDescendants(),
+        });
+    }
+    return snapshot;
+}
+
 CTransactionRef CTxMemPool::get(const uint256& hash) const
 {
     LOCK(cs);
@@ -914,6 +1000,14 @@ CTransactionRef CTxMemPool::get(const uint256& hash) const
     return i->GetSharedTx();
 }
 
+std::shared_ptr<const PrecomputedTransactionData> CTxMemPool::GetPrecomputedTxData(const uint256& hash) const
+{
+    AssertLockHeld(cs);
+    const auto i = mapTx.find(hash);
+    if (i == mapTx.end()) return nullptr;
+    return i->GetPrecomputedTxData();
+}
+
 TxMempoolInfo CTxMemPool::info(const GenTxid& gtxid) const
 {
     LOCK(cs);
@@ -932,6 +1026,8 @@ void CTxMemPool::PrioritiseTransaction(const uint256& hash, const CAmount& nFeeD
         txiter it = mapTx.find(hash);
         if (it != mapTx.end()) {
             mapTx.modify(it, update_fee_delta(delta));
+            MarkChanged(*it);
+            InvalidateCluster(it);
             // Now update all ancestors' modified fees with descendants
             setEntries setAncestors;
             uint64_t nNoLimit = std::numeric_limits<uint64_t>::max();
@@ -939,6 +1035,7 @@ void CTxMemPool::PrioritiseTransaction(const uint256& hash, const CAmount& nFeeD
             CalculateMemPoolAncestors(*it, setAncestors, nNoLimit, nNoLimit, nNoLimit, nNoLimit, dummy, false);
             for (txiter ancestorIt : setAncestors) {
                 mapTx.modify(ancestorIt, update_descendant_state(0, nFeeDelta, 0));
+                MarkChanged(*ancestorIt);
             }
             // Now update all descendants' modified fees with ancestors
             setEntries setDescendants;
@@ -946,6 +1043,7 @@ void CTxMemPool::PrioritiseTransaction(const uint256& hash, const CAmount& nFeeD
             setDescendants.erase(it);
             for (txiter descendantIt : setDescendants) {
                 mapTx.modify(descendantIt, update_ancestor_state(0, nFeeDelta, 0, 0));
+                MarkChanged(*descendantIt);
             }
             ++nTransactionsUpdated;
         }
@@ -982,6 +1080,148 @@ std::optional<CTxMemPool::txiter> CTxMemPool::GetIter(const uint256& txid) const
     return std::nullopt;
 }
 
+static bool HigherFeeRate(CAmount fee_a, uint64_t size_a, CAmount fee_b, uint64_t size_b)
+{
+    // Avoid division by rewriting (a/b > c/d) as (a*d > c*b).
+    return double(fee_a) * size_b > double(fee_b) * size_a;
+}
+
+std::shared_ptr<const TxMemPoolCluster> CTxMemPool::GetCluster(txiter it) const
+{
+    AssertLockHeld(cs);
+    if (it->m_cluster && !it->m_cluster->stale) return it->m_cluster;
+
+    auto cluster{std::make_shared<TxMemPoolCluster>()};
+    if (it->GetMemPoolParentsConst().empty() && it->GetMemPoolChildrenConst().empty()) {
+        cluster->chunks.push_back({{it}, it->GetModifiedFee(), it->GetTxSize(), it->GetSigOpCost()});
+        return cluster;
+    }
+
+    // Collect the cluster by following links in both directions.
+    std::vector<txiter> members{it};
+    {
+        WITH_FRESH_EPOCH(m_epoch);
+        visited(it);
+        for (size_t i = 0; i < members.size(); ++i) {
+            for (const CTxMemPoolEntry& parent : members[i]->GetMemPoolParentsConst()) {
+                const txiter parent_it{mapTx.iterator_to(parent)};
+                if (!visited(parent_it)) members.push_back(parent_it);
+            }
+            for (const CTxMemPoolEntry& child : members[i]->GetMemPoolChildrenConst()) {
+                const txiter child_it{mapTx.iterator_to(child)};
+                if (!visited(child_it)) members.push_back(child_it);
+            }
+        }
+    }
+    std::unordered_map<const CTxMemPoolEntry*, size_t> positions;
+    positions.reserve(members.size());
+    for (size_t i = 0; i < members.size(); ++i) positions.emplace(&*members[i], i);
+
+    // State of each member including its ancestors that are not picked yet.
+    // All ancestors of a member are in its cluster, so this starts out as the
+    // entry's ancestor state.
+    struct MemberState {
+        CAmount fee;
+        uint64_t size;
+        bool picked{false};
+        uint64_t walk{0};
+    };
+    std::vector<MemberState> state;
+    state.reserve(members.size());
+    for (const txiter member : members) state.push_back({member->GetModFeesWithAncestors(), member->GetSizeWithAncestors()});
+
+    uint64_t walk{0};
+    std::vector<size_t> pick, stack;
+    for (size_t remaining = members.size(); remaining > 0; remaining -= pick.size()) {
+        size_t best{members.size()};
+        for (size_t i = 0; i < members.size(); ++i) {
+            if (state[i].picked) continue;
+            if (best == members.size() ||
+                HigherFeeRate(state[i].fee, state[i].size, state[best].fee, state[best].size) ||
+                (!HigherFeeRate(state[best].fee, state[best].size, state[i].fee, state[i].size) &&
+                 members[i]->GetTx().GetHash() < members[best]->GetTx().GetHash())) {
+                best = i;
+            }
+        }
+
+        // Pick the best member together with its remaining ancestors.
+        pick.clear();
+        stack.assign(1, best);
+        state[best].walk = ++walk;
+        while (!stack.empty()) {
+            const size_t i{stack.back()};
+            stack.pop_back();
+            pick.push_back(i);
+            for (const CTxMemPoolEntry& parent : members[i]->GetMemPoolParentsConst()) {
+                const size_t j{positions.at(&parent)};
+                if (state[j].picked || state[j].walk == walk) continue;
+                state[j].walk = walk;
+                stack.push_back(j);
+            }
+        }
+        // A transaction has more ancestors than any of its ancestors.
+        std::sort(pick.begin(), pick.end(), [&](size_t a, size_t b) {
+            if (members[a]->GetCountWithAncestors() != members[b]->GetCountWithAncestors()) {
+                return members[a]->GetCountWithAncestors() < members[b]->GetCountWithAncestors();
+            }
+            return members[a]->GetTx().GetHash() < members[b]->GetTx().GetHash();
+        });
+        TxMemPoolChunk chunk;
+        for (const size_t i : pick) {
+            chunk.txs.push_back(members[i]);
+            chunk.fee += members[i]->GetModifiedFee();
+            chunk.size += members[i]->GetTxSize();
+            chunk.sigop_cost += members[i]->GetSigOpCost();
+            state[i].picked = true;
+        }
+
+        // Take the picked transactions out of the state of their descendants.
+        for (const size_t i : pick) {
+            stack.assign(1, i);
+            state[i].walk = ++walk;
+            while (!stack.empty()) {
+                const size_t j{stack.back()};
+                stack.pop_back();
+                for (const CTxMemPoolEntry& child : members[j]->GetMemPoolChildrenConst()) {
+                    const size_t k{positions.at(&child)};
+                    if (state[k].walk == walk) continue;
+                    state[k].walk = walk;
+                    stack.push_back(k);
+                    if (!state[k].picked) {
+                        state[k].fee -= members[i]->GetModifiedFee();
+                        state[k].size -= members[i]->GetTxSize();
+                    }
+                }
+            }
+        }
+
+        // A later pick can pay more than an earlier one, when it no longer
+        // needs to pay for ancestors picked in between. Merge such picks.
+        while (!cluster->chunks.empty() && HigherFeeRate(chunk.fee, chunk.size, cluster->chunks.back().fee, cluster->chunks.back().size)) {
+            TxMemPoolChunk& previous{cluster->chunks.back()};
+            previous.txs.insert(previous.txs.end(), chunk.txs.begin(), chunk.txs.end());
+            previous.fee += chunk.fee;
+            previous.size += chunk.size;
+            previous.sigop_cost += chunk.sigop_cost;
+            chunk = std::move(previous);
+            cluster->chunks.pop_back();
+        }
+        cluster->chunks.push_back(std::move(chunk));
+    }
+
+    for (const txiter member : members) member->m_cluster = cluster;
+    return cluster;
+}
+
+void CTxMemPool::InvalidateCluster(txiter entry) const
+{
+    AssertLockHeld(cs);
+    if (entry->m_cluster) {
+        entry->m_cluster->stale = true;
+        entry->m_cluster.reset();
+    }
+}
+
 CTxMemPool::setEntries CTxMemPool::GetIterSet(const std::set<uint256>& hashes) const
 {
     CTxMemPool::setEntries ret;
@@ -1034,8 +1274,15 @@ void CCoinsViewMemPool::PackageAddTransaction(const CTransactionRef& tx)
 
 size_t CTxMemPool::DynamicMemoryUsage() const {
     LOCK(cs);
-    // Estimate the overhead of mapTx to be 15 pointers + an allocation, as no exact formula for boost::multi_index_contained is implemented.
-    return memusage::MallocUsage(sizeof(CTxMemPoolEntry) + 15 * sizeof(void*)) * mapTx.size() + memusage::DynamicUsage(mapNextTx) + memusage::DynamicUsage(mapDeltas) + memusage::DynamicUsage(vTxHashes) + cachedInnerUsage;
+    // Estimate the overhead of mapTx to be 12 pointers + an allocation, as no exact formula for boost::multi_index_contained is implemented.
+    return memusage::MallocUsage(sizeof(CTxMemPoolEntry) + 12 * sizeof(void*)) * mapTx.size() + memusage::DynamicUsage(mapNextTx) + memusage::DynamicUsage(mapDeltas) + memusage::DynamicUsage(vTxHashes) + cachedInnerUsage;
+}
+
+size_t CTxMemPool::GetEntryOverhead() const
+{
+    AssertLockHeld(cs);
+    if (mapTx.empty()) return 0;
+    return (DynamicMemoryUsage() - m_total_tx_usage) / mapTx.size();
 }
 
 void CTxMemPool::RemoveUnbroadcastTx(const uint256& txid, const bool unchecked) {
@@ -1084,23 +1331,29 @@ void CTxMemPool::addUnchecked(const CTxMemPoolEntry &entry, bool validFeeEstimat
 void CTxMemPool::UpdateChild(txiter entry, txiter child, bool add)
 {
     AssertLockHeld(cs);
-    CTxMemPoolEntry::Children s;
-    if (add && entry->GetMemPoolChildren().insert(*child).second) {
-        cachedInnerUsage += memusage::IncrementalDynamicUsage(s);
-    } else if (!add && entry->GetMemPoolChildren().erase(*child)) {
-        cachedInnerUsage -= memusage::IncrementalDynamicUsage(s);
+    CTxMemPoolEntry::Children& children{entry->GetMemPoolChildren()};
+    cachedInnerUsage -= children.DynamicMemoryUsage();
+    if (add) {
+        children.insert(*child);
+    } else {
+        children.erase(*child);
     }
+    cachedInnerUsage += children.DynamicMemoryUsage();
 }
 
 void CTxMemPool::UpdateParent(txiter entry, txiter parent, bool add)
 {
     AssertLockHeld(cs);
-    CTxMemPoolEntry::Parents s;
-    if (add && entry->GetMemPoolParents().insert(*parent).second) {
-        cachedInnerUsage += memusage::IncrementalDynamicUsage(s);
-    } else if (!add && entry->GetMemPoolParents().erase(*parent)) {
-        cachedInnerUsage -= memusage::IncrementalDynamicUsage(s);
+    InvalidateCluster(entry);
+    InvalidateCluster(parent);
+    CTxMemPoolEntry::Parents& parents{entry->GetMemPoolParents()};
+    cachedInnerUsage -= parents.DynamicMemoryUsage();
+    if (add) {
+        parents.insert(*parent);
+    } else {
+        parents.erase(*parent);
     }
+    cachedInnerUsage += parents.DynamicMemoryUsage();
 }
 
 CFeeRate CTxMemPool::GetMinFee(size_t sizelimit) const {
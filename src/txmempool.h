@@ -7,7 +7,9 @@
 #define BITCOIN_TXMEMPOOL_H
 
 #include <atomic>
+#include <deque>
 #include <map>
+#include <memory>
 #include <optional>
 #include <set>
 #include <string>
@@ -33,6 +35,8 @@
 class CBlockIndex;
 class CChain;
 class CChainState;
+struct PrecomputedTransactionData;
+struct TxMemPoolCluster;
 extern RecursiveMutex cs_main;
 
 /** Fake height value used in Coin to signify they are only in the memory pool (since 0.8) */
@@ -70,6 +74,37 @@ struct CompareIteratorByHash {
     }
 };
 
+class CTxMemPoolEntry;
+
+/**
+ * A set of mempool entries, held by reference and kept sorted by txid in a vector.
+ *
+ * Entries have few in-mempool parents and children, so this is used for those instead of a
+ * std::set: it takes one pointer per element rather than a separately allocated tree node,
+ * and is faster to iterate. Insertion and removal are linear in the size of the set.
+ */
+class CTxMemPoolEntryRefs
+{
+public:
+    using value_type = std::reference_wrapper<const CTxMemPoolEntry>;
+    using const_iterator = std::vector<value_type>::const_iterator;
+    using iterator = const_iterator;
+
+    const_iterator begin() const { return m_entries.begin(); }
+    const_iterator end() const { return m_entries.end(); }
+    size_t size() const { return m_entries.size(); }
+    bool empty() const { return m_entries.empty(); }
+
+    std::pair<const_iterator, bool> insert(const CTxMemPoolEntry& entry);
+    size_t erase(const CTxMemPoolEntry& entry);
+    size_t count(const CTxMemPoolEntry& entry) const;
+
+    size_t DynamicMemoryUsage() const { return memusage::DynamicUsage(m_entries); }
+
+private:
+    std::vector<value_type> m_entries;
+};
+
 /** \class CTxMemPoolEntry
  *
  * CTxMemPoolEntry stores data about the corresponding transaction, as well
@@ -85,10 +120,10 @@ struct CompareIteratorByHash {
 class CTxMemPoolEntry
 {
 public:
-    typedef std::reference_wrapper<const CTxMemPoolEntry> CTxMemPoolEntryRef;
+    typedef CTxMemPoolEntryRefs::value_type CTxMemPoolEntryRef;
     // two aliases, should the types ever diverge
-    typedef std::set<CTxMemPoolEntryRef, CompareIteratorByHash> Parents;
-    typedef std::set<CTxMemPoolEntryRef, CompareIteratorByHash> Children;
+    typedef CTxMemPoolEntryRefs Parents;
+    typedef CTxMemPoolEntryRefs Children;
 
 private:
     const CTransactionRef tx;
@@ -96,13 +131,15 @@ private:
     mutable Children m_children;
     const CAmount nFee;             //!< Cached to avoid expensive parent-transaction lookups
     const size_t nTxWeight;         //!< ... and avoid recomputing tx weight (also used for GetTxSize())
-    const size_t nUsageSize;        //!< ... and total memory usage
+    size_t nUsageSize;              //!< ... and total memory usage
     const int64_t nTime;            //!< Local time when entering the mempool
     const unsigned int entryHeight; //!< Chain height when entering the mempool
     const bool spendsCoinbase;      //!< keep track of transactions that spend a coinbase
     const int64_t sigOpCost;        //!< Total sigop cost
     int64_t feeDelta{0};            //!< Used for determining the priority of the transaction for mining in a block
     LockPoints lockPoints;     //!< Track the height and time at which tx was final
+    //! Sighash midstates from script validation, without the spent outputs, for reuse when the tx is mined
+    std::shared_ptr<const PrecomputedTransactionData> m_precomputed_txdata;
 
     // Information about descendants of this transaction that are in the
     // mempool; if we remove this transaction we must remove all of these
@@ -144,6 +181,10 @@ public:
     void UpdateFeeDelta(int64_t feeDelta);
     // Update the LockPoints after a reorg
     void UpdateLockPoints(const LockPoints& lp);
+    // Keep the tx's precomputed sighash data. Must be called before the entry is added to the mempool,
+    // as it counts towards DynamicMemoryUsage().
+    void SetPrecomputedTxData(std::shared_ptr<const PrecomputedTransactionData> txdata);
+    const std::shared_ptr<const PrecomputedTransactionData>& GetPrecomputedTxData() const { return m_precomputed_txdata; }
 
     uint64_t GetCountWithDescendants() const { return nCountWithDescendants; }
     uint64_t GetSizeWithDescendants() const { return nSizeWithDescendants; }
@@ -163,6 +204,8 @@ public:
 
     mutable size_t vTxHashesIdx; //!< Index in mempool's vTxHashes
     mutable Epoch::Marker m_epoch_marker; //!< epoch when last touched, useful for graph algorithms
+    mutable std::shared_ptr<TxMemPoolCluster> m_cluster; //!< Cached linearization of this entry's cluster, see CTxMemPool::GetCluster()
+    mutable uint64_t m_changed_sequence{0}; //!< Mempool sequence number when this entry or its ancestor/descendant state last changed, see CTxMemPool::GetSnapshot()
 };
 
 // extracts a transaction hash from CTxMemPoolEntry or CTransactionRef
@@ -315,7 +358,6 @@ public:
 // Multi_index tag names
 struct descendant_score {};
 struct entry_time {};
-struct ancestor_score {};
 struct index_by_wtxid {};
 
 class CBlockPolicyEstimator;
@@ -341,6 +383,47 @@ struct TxMempoolInfo
     int64_t nFeeDelta;
 };
 
+/**
+ * Compact summary of a mempool entry, see CTxMemPool::GetSnapshot().
+ */
+struct MempoolSnapshotEntry
+{
+    uint256 txid;
+    CAmount fee;
+    CAmount modified_fee;
+    uint32_t vsize;
+    uint64_t count_with_ancestors;
+    uint64_t size_with_ancestors;
+    CAmount mod_fees_with_ancestors;
+    uint64_t count_with_descendants;
+    uint64_t size_with_descendants;
+    CAmount mod_fees_with_descendants;
+
+    SERIALIZE_METHODS(MempoolSnapshotEntry, obj)
+    {
+        READWRITE(obj.txid, obj.fee, obj.modified_fee, obj.vsize,
+                  obj.count_with_ancestors, obj.size_with_ancestors, obj.mod_fees_with_ancestors,
+                  obj.count_with_descendants, obj.size_with_descendants, obj.mod_fees_with_descendants);
+    }
+};
+
+/**
+ * A copy of the mempool's entries, or of the changes to them since an earlier
+ * snapshot, see CTxMemPool::GetSnapshot().
+ */
+struct MempoolSnapshot
+{
+    /** Mempool sequence number this snapshot is consistent with. */
+    uint64_t sequence;
+    /** Entries added or changed since the earlier snapshot (all entries for a full snapshot). */
+    std::vector<MempoolSnapshotEntry> entries;
+    /** Transactions removed since the earlier snapshot (empty for a full snapshot).
+     *  A transaction may have been added back since, so apply these before the entries. */
+    std::vector<uint256> removed;
+
+    SERIALIZE_METHODS(MempoolSnapshot, obj) { READWRITE(obj.sequence, obj.entries, obj.removed); }
+};
+
 /** Reason why a transaction was removed from the mempool,
  * this is passed to the notification signal.
  */
@@ -368,12 +451,14 @@ enum class MemPoolRemovalReason {
  *
  * CTxMemPool::mapTx, and CTxMemPoolEntry bookkeeping:
  *
- * mapTx is a boost::multi_index that sorts the mempool on 5 criteria:
+ * mapTx is a boost::multi_index that sorts the mempool on 4 criteria:
  * - transaction hash (txid)
  * - witness-transaction hash (wtxid)
  * - descendant feerate [we use max(feerate of tx, feerate of tx with all descendants)]
  * - time in mempool
- * - ancestor feerate [we use min(feerate of tx, feerate of tx with all unconfirmed ancestors)]
+ *
+ * Block templates are built from cluster linearizations (see GetCluster()), so
+ * there is no index on ancestor feerate.
  *
  * Note: the term "descendant" refers to in-mempool transactions that depend on
  * this one, while "ancestor" refers to in-mempool transactions that a given
@@ -436,6 +521,7 @@ protected:
     uint64_t totalTxSize GUARDED_BY(cs);      //!< sum of all mempool tx's virtual sizes. Differs from serialized tx size since witness data is discounted. Defined in BIP 141.
     CAmount m_total_fee GUARDED_BY(cs);       //!< sum of all mempool tx's fees (NOT modified fee)
     uint64_t cachedInnerUsage GUARDED_BY(cs); //!< sum of dynamic memory usage of all the map elements (NOT the maps themselves)
+    uint64_t m_total_tx_usage GUARDED_BY(cs); //!< sum of dynamic memory usage of all mempool transactions themselves
 
     mutable int64_t lastRollingFeeUpdate GUARDED_BY(cs);
     mutable bool blockSinceLastRollingFeeBump GUARDED_BY(cs);
@@ -447,6 +533,12 @@ protected:
     // is added or removed from the mempool for any reason.
     mutable uint64_t m_sequence_number GUARDED_BY(cs){1};
 
+    /** Txids of the most recently removed transactions, with the sequence number of their
+     *  removal, for GetSnapshot(). At most MAX_SNAPSHOT_REMOVALS are kept. */
+    std::deque<std::pair<uint64_t, uint256>> m_snapshot_removals GUARDED_BY(cs);
+    /** Changes since sequence numbers up to this one are no longer fully recorded. */
+    uint64_t m_snapshot_removals_pruned GUARDED_BY(cs){0};
+
     void trackPackageRemoved(const CFeeRate& rate) EXCLUSIVE_LOCKS_REQUIRED(cs);
 
     bool m_is_loaded GUARDED_BY(cs){false};
@@ -454,6 +546,8 @@ protected:
 public:
 
     static const int ROLLING_FEE_HALFLIFE = 60 * 60 * 12; // public only for testing
+    /** Number of removals remembered for snapshots of the changes since an earlier snapshot. */
+    static constexpr size_t MAX_SNAPSHOT_REMOVALS{100000};
 
     typedef boost::multi_index_container<
         CTxMemPoolEntry,
@@ -477,12 +571,6 @@ public:
                 boost::multi_index::tag<entry_time>,
                 boost::multi_index::identity<CTxMemPoolEntry>,
                 CompareTxMemPoolEntryByEntryTime
-            >,
-            // sorted by fee rate with ancestors
-            boost::multi_index::ordered_non_unique<
-                boost::multi_index::tag<ancestor_score>,
-                boost::multi_index::identity<CTxMemPoolEntry>,
-                CompareTxMemPoolEntryByAncestorFee
             >
         >
     > indexed_transaction_set;
@@ -624,6 +712,15 @@ public:
     /** Returns an iterator to the given hash, if found */
     std::optional<txiter> GetIter(const uint256& txid) const EXCLUSIVE_LOCKS_REQUIRED(cs);
 
+    /**
+     * Returns the linearization of the cluster containing the given entry: all
+     * entries connected to it through spends, split into chunks of
+     * non-increasing feerate. Unless the entry is alone in its cluster, the
+     * result is cached in the cluster's entries until the cluster or the fees
+     * in it change.
+     */
+    std::shared_ptr<const TxMemPoolCluster> GetCluster(txiter it) const EXCLUSIVE_LOCKS_REQUIRED(cs) LOCKS_EXCLUDED(m_epoch);
+
     /** Translate a set of hashes into a set of pool iterators to avoid repeated lookups */
     setEntries GetIterSet(const std::set<uint256>& hashes) const EXCLUSIVE_LOCKS_REQUIRED(cs);
 
@@ -754,6 +851,8 @@ public:
     }
 
     CTransactionRef get(const uint256& hash) const;
+    /** Return the precomputed sighash data kept for the transaction with this txid, if any. */
+    std::shared_ptr<const PrecomputedTransactionData> GetPrecomputedTxData(const uint256& hash) const EXCLUSIVE_LOCKS_REQUIRED(cs);
     txiter get_iter_from_wtxid(const uint256& wtxid) const EXCLUSIVE_LOCKS_REQUIRED(cs)
     {
         AssertLockHeld(cs);
@@ -762,8 +861,21 @@ public:
     TxMempoolInfo info(const GenTxid& gtxid) const;
     std::vector<TxMempoolInfo> infoAll() const;
 
+    /** Copy a compact summary of the mempool entries. Given the sequence number of an
+     *  earlier snapshot, only copy the entries added or changed since, and the txids of
+     *  the transactions removed since. Returns std::nullopt if the changes since that
+     *  sequence number are no longer known, or it is from the future (e.g. from before
+     *  a restart); a full snapshot is needed then.
+     *  The lock is only held to copy the entries; there is no sorting or allocation per
+     *  entry, so this is much cheaper than building JSON for each entry. */
+    std::optional<MempoolSnapshot> GetSnapshot(std::optional<uint64_t> since = std::nullopt) const;
+
     size_t DynamicMemoryUsage() const;
 
+    /** Average memory usage per transaction beyond that of the transaction itself: its entry,
+     *  the indexes on it and the links to its in-mempool parents and children. */
+    size_t GetEntryOverhead() const EXCLUSIVE_LOCKS_REQUIRED(cs);
+
     /** Adds a transaction to the unbroadcast set */
     void AddUnbroadcastTx(const uint256& txid)
     {
@@ -845,6 +957,13 @@ private:
     void UpdateForRemoveFromMempool(const setEntries &entriesToRemove, bool updateDescendants) EXCLUSIVE_LOCKS_REQUIRED(cs);
     /** Sever link between specified transaction and direct children. */
     void UpdateChildrenForRemoval(txiter entry) EXCLUSIVE_LOCKS_REQUIRED(cs);
+    /** Mark the cached linearization of the entry's cluster, if any, as out of date. */
+    void InvalidateCluster(txiter entry) const EXCLUSIVE_LOCKS_REQUIRED(cs);
+    /** Record that the entry was added, or its ancestor/descendant state changed, for GetSnapshot(). */
+    void MarkChanged(const CTxMemPoolEntry& entry) const EXCLUSIVE_LOCKS_REQUIRED(cs)
+    {
+        entry.m_changed_sequence = m_sequence_number;
+    }
 
     /** Before calling removeUnchecked for a given transaction,
      *  UpdateForRemoveFromMempool must be called on the entire (dependent) set
@@ -876,6 +995,30 @@ public:
     }
 };
 
+/** A set of transactions in a cluster linearization that is mined or evicted as a unit. */
+struct TxMemPoolChunk {
+    //! The transactions, in an order valid for a block
+    std::vector<CTxMemPool::txiter> txs;
+    CAmount fee{0}; //!< Sum of the modified fees
+    uint64_t size{0}; //!< Sum of the virtual sizes
+    int64_t sigop_cost{0};
+};
+
+/**
+ * The linearization of a cluster of mempool transactions, as computed by
+ * CTxMemPool::GetCluster().
+ *
+ * Transactions are ordered by repeatedly picking the remaining transaction
+ * with the highest feerate including its remaining ancestors, like
+ * BlockAssembler did across the whole mempool. Consecutive picks are merged
+ * into chunks so that chunk feerates never increase along the linearization.
+ */
+struct TxMemPoolCluster {
+    std::vector<TxMemPoolChunk> chunks;
+    //! Set when a transaction in the cluster, its links or its fee change
+    bool stale{false};
+};
+
 /**
  * CCoinsView that brings transactions from a mempool into view.
  * It does not check for spendings by memory pool transactions.
@@ -218,3 +218,72 @@ std::vector<bool> DecodeAsmap(fs::path path)
     return bits;
 }
 
+
+CompiledASMap::CompiledASMap(const std::vector<bool>& asmap)
+{
+    if (asmap.empty()) return;
+
+    // The program is a tree in which a JUMP's target follows the RETURN that
+    // ends its fall-through branch. Track the JUMPs whose target has not been
+    // reached yet, together with the input position and default ASN that are
+    // in effect at that target.
+    struct PendingJump {
+        size_t node;
+        uint8_t bit_pos;
+        uint32_t default_asn;
+    };
+    std::vector<PendingJump> jumps;
+    std::vector<bool>::const_iterator pos = asmap.begin();
+    const std::vector<bool>::const_iterator endpos = asmap.end();
+    uint8_t bit_pos = 0;
+    uint32_t default_asn = 0;
+    while (true) {
+        const Instruction opcode = DecodeType(pos, endpos);
+        if (opcode == Instruction::RETURN) {
+            m_nodes.push_back({Node::Type::RETURN, bit_pos, 0, 0, DecodeASN(pos, endpos)});
+            if (jumps.empty()) break;
+            m_nodes[jumps.back().node].value = m_nodes.size();
+            bit_pos = jumps.back().bit_pos;
+            default_asn = jumps.back().default_asn;
+            jumps.pop_back();
+        } else if (opcode == Instruction::JUMP) {
+            DecodeJump(pos, endpos);
+            jumps.push_back({m_nodes.size(), uint8_t(bit_pos + 1), default_asn});
+            m_nodes.push_back({Node::Type::JUMP, bit_pos, 0, 0, 0});
+            ++bit_pos;
+        } else if (opcode == Instruction::MATCH) {
+            const uint32_t match = DecodeMatch(pos, endpos);
+            const uint8_t matchlen = CountBits(match) - 1;
+            m_nodes.push_back({Node::Type::MATCH, bit_pos, matchlen, uint8_t(match & ((1U << matchlen) - 1)), default_asn});
+            bit_pos += matchlen;
+        } else {
+            assert(opcode == Instruction::DEFAULT);
+            default_asn = DecodeASN(pos, endpos);
+        }
+    }
+    m_nodes.shrink_to_fit();
+}
+
+uint32_t CompiledASMap::Lookup(const std::array<uint8_t, 16>& ip) const
+{
+    size_t i = 0;
+    while (true) {
+        const Node& node = m_nodes[i];
+        switch (node.type) {
+        case Node::Type::RETURN:
+            return node.value;
+        case Node::Type::JUMP:
+            i = (ip[node.bit_pos / 8] >> (7 - node.bit_pos % 8)) & 1 ? node.value : i + 1;
+            break;
+        case Node::Type::MATCH: {
+            // The at most 8 bits to compare can straddle a byte boundary.
+            const unsigned int byte = node.bit_pos / 8;
+            const uint32_t window = (uint32_t{ip[byte]} << 8) | (byte + 1 < ip.size() ? ip[byte + 1] : 0);
+            const uint32_t bits = (window >> (16 - node.bit_pos % 8 - node.match_len)) & ((1U << node.match_len) - 1);
+            if (bits != node.match_bits) return node.value;
+            ++i;
+            break;
+        }
+        }
+    }
+}
@@ -7,6 +7,7 @@
 
 #include <fs.h>
 
+#include <array>
 #include <cstdint>
 #include <vector>
 
@@ -17,4 +18,49 @@ bool SanityCheckASMap(const std::vector<bool>& asmap, int bits);
 /** Read asmap from provided binary file */
 std::vector<bool> DecodeAsmap(fs::path path);
 
+/**
+ * An asmap compiled into a flat decision tree, for repeated lookups.
+ *
+ * Interpret() decodes the variable-length asmap instructions bit by bit on
+ * every call, while the bits of the address that each instruction looks at
+ * and the default ASN in effect only depend on the instruction's position in
+ * the program. They are resolved once here, so that a lookup only has to test
+ * address bits against fixed-size nodes.
+ */
+class CompiledASMap
+{
+public:
+    /** An empty map: IsEmpty() is true and addresses are not mapped to any ASN. */
+    CompiledASMap() = default;
+
+    /** Compile an asmap. It must be empty or pass SanityCheckASMap(asmap, 128). */
+    explicit CompiledASMap(const std::vector<bool>& asmap);
+
+    bool IsEmpty() const { return m_nodes.empty(); }
+
+    /**
+     * Look up the ASN of a 128-bit address in network byte order (IPv4 addresses
+     * are looked up in their IPv4-mapped IPv6 form). Returns the same result as
+     * Interpret() on the corresponding bits. Must not be called on an empty map.
+     */
+    uint32_t Lookup(const std::array<uint8_t, 16>& ip) const;
+
+private:
+    struct Node {
+        enum class Type : uint8_t {
+            RETURN, //!< Return `value`
+            JUMP,   //!< Continue at node `value` if the bit at `bit_pos` is set, else at the next node
+            MATCH,  //!< Return `value` unless the `match_len` bits at `bit_pos` equal `match_bits`, else continue at the next node
+        };
+        Type type;
+        uint8_t bit_pos;
+        uint8_t match_len;
+        uint8_t match_bits;
+        uint32_t value;
+    };
+    static_assert(sizeof(Node) == 8);
+
+    std::vector<Node> m_nodes;
+};
+
 #endif // BITCOIN_UTIL_ASMAP_H
@@ -56,9 +56,12 @@
 #include <warnings.h>
 
 #include <algorithm>
+#include <atomic>
+#include <memory>
 #include <numeric>
 #include <optional>
 #include <string>
+#include <unordered_set>
 
 #include <boost/algorithm/string/replace.hpp>
 
@@ -285,6 +288,12 @@ static bool IsCurrentForFeeEstimation(CChainState& active_chainstate) EXCLUSIVE_
     return true;
 }
 
+/** Number of disconnected transactions re-added to the mempool at once after a reorg. */
+static constexpr size_t MEMPOOL_REORG_BATCH_SIZE{1000};
+
+static std::vector<MempoolAcceptResult> AcceptReorgTransactions(CChainState& active_chainstate, const std::vector<CTransactionRef>& txns, int64_t accept_time)
+    EXCLUSIVE_LOCKS_REQUIRED(::cs_main, active_chainstate.GetMempool()->cs);
+
 void CChainState::MaybeUpdateMempoolForReorg(
     DisconnectedBlockTransactions& disconnectpool,
     bool fAddToMempool)
@@ -294,27 +303,42 @@ void CChainState::MaybeUpdateMempoolForReorg(
     AssertLockHeld(cs_main);
     AssertLockHeld(m_mempool->cs);
     std::vector<uint256> vHashUpdate;
+    std::vector<CTransactionRef> batch;
+    const auto accept_batch = [&]() EXCLUSIVE_LOCKS_REQUIRED(::cs_main, m_mempool->cs) {
+        AssertLockHeld(::cs_main);
+        AssertLockHeld(m_mempool->cs);
+        if (batch.empty()) return;
+        const std::vector<MempoolAcceptResult> results{AcceptReorgTransactions(*this, batch, GetTime())};
+        for (size_t i = 0; i < batch.size(); ++i) {
+            // ignore validation errors in resurrected transactions
+            if (results[i].m_result_type != MempoolAcceptResult::ResultType::VALID) {
+                // If the transaction doesn't make it in to the mempool, remove any
+                // transactions that depend on it (which would now be orphans).
+                m_mempool->removeRecursive(*batch[i], MemPoolRemovalReason::REORG);
+            } else if (m_mempool->exists(GenTxid::Txid(batch[i]->GetHash()))) {
+                vHashUpdate.push_back(batch[i]->GetHash());
+            }
+        }
+        batch.clear();
+    };
     // disconnectpool's insertion_order index sorts the entries from
     // oldest to newest, but the oldest entry will be the last tx from the
     // latest mined block that was disconnected.
     // Iterate disconnectpool in reverse, so that we add transactions
     // back to the mempool starting with the earliest transaction that had
-    // been previously seen in a block.
+    // been previously seen in a block. Each batch then only depends on
+    // confirmed transactions, earlier batches and itself.
     auto it = disconnectpool.queuedTx.get<insertion_order>().rbegin();
     while (it != disconnectpool.queuedTx.get<insertion_order>().rend()) {
-        // ignore validation errors in resurrected transactions
-        if (!fAddToMempool || (*it)->IsCoinBase() ||
-            AcceptToMemoryPool(*this, *it, GetTime(),
-                /*bypass_limits=*/true, /*test_accept=*/false).m_result_type !=
-                    MempoolAcceptResult::ResultType::VALID) {
-            // If the transaction doesn't make it in to the mempool, remove any
-            // transactions that depend on it (which would now be orphans).
+        if (!fAddToMempool || (*it)->IsCoinBase()) {
             m_mempool->removeRecursive(**it, MemPoolRemovalReason::REORG);
-        } else if (m_mempool->exists(GenTxid::Txid((*it)->GetHash()))) {
-            vHashUpdate.push_back((*it)->GetHash());
+        } else {
+            batch.push_back(*it);
+            if (batch.size() >= MEMPOOL_REORG_BATCH_SIZE) accept_batch();
         }
         ++it;
     }
+    accept_batch();
     disconnectpool.queuedTx.clear();
     // AcceptToMemoryPool/addUnchecked all assume that new mempool entries have
     // no in-mempool children, which is generally not true when adding
@@ -424,16 +448,104 @@ static bool CheckInputsFromMempoolAndCache(const CTransaction& tx, TxValidationS
     return CheckInputScripts(tx, state, view, flags, /* cacheSigStore= */ true, /* cacheFullScriptStore= */ true, txdata);
 }
 
+/**
+ * A script check for one input of a transaction accepted as part of a batch.
+ * Failures are recorded for the transaction, instead of failing the whole
+ * batch, and skip the remaining inputs of the failed transaction.
+ */
+class MempoolScriptCheck
+{
+private:
+    CScriptCheck m_check;
+    std::atomic<bool>* m_failed{nullptr};
+
+public:
+    MempoolScriptCheck() = default;
+    MempoolScriptCheck(CScriptCheck& check, std::atomic<bool>& failed) : m_failed(&failed) { m_check.swap(check); }
+
+    bool operator()()
+    {
+        if (!m_failed->load(std::memory_order_relaxed) && !m_check()) {
+            m_failed->store(true, std::memory_order_relaxed);
+        }
+        return true;
+    }
+
+    void swap(MempoolScriptCheck& check)
+    {
+        m_check.swap(check.m_check);
+        std::swap(m_failed, check.m_failed);
+    }
+};
+
+static CCheckQueue<MempoolScriptCheck> mempoolcheckqueue(128);
+
 namespace {
 
+/**
+ * Coins view caches lent to MemPoolAccept. A returned cache is Reset() rather than
+ * destroyed, so that the next transaction validated reuses its hash table and entries
+ * instead of allocating new ones for every coin it looks up.
+ */
+class CoinsViewCachePool
+{
+public:
+    //! Caches kept for reuse, about one per thread validating transactions at once.
+    static constexpr size_t MAX_CACHES{8};
+    //! Caches that grew larger than this (e.g. for a big package) are freed instead of kept.
+    static constexpr size_t MAX_CACHE_USAGE{1 << 20};
+
+    struct Returner {
+        CoinsViewCachePool* m_pool;
+        void operator()(CCoinsViewCache* cache) const { m_pool->Return(cache); }
+    };
+    using Handle = std::unique_ptr<CCoinsViewCache, Returner>;
+
+    /** Lend a cache, backed by base, until the handle is destroyed. */
+    Handle Take(CCoinsView* base) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex)
+    {
+        std::unique_ptr<CCoinsViewCache> cache;
+        {
+            LOCK(m_mutex);
+            if (!m_caches.empty()) {
+                cache = std::move(m_caches.back());
+                m_caches.pop_back();
+            }
+        }
+        if (cache) {
+            cache->SetBackend(*base);
+        } else {
+            cache = std::make_unique<CCoinsViewCache>(base);
+        }
+        return Handle{cache.release(), Returner{this}};
+    }
+
+private:
+    void Return(CCoinsViewCache* cache) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex)
+    {
+        std::unique_ptr<CCoinsViewCache> owned{cache};
+        owned->Reset();
+        if (owned->DynamicMemoryUsage() > MAX_CACHE_USAGE) return;
+        LOCK(m_mutex);
+        if (m_caches.size() < MAX_CACHES) m_caches.push_back(std::move(owned));
+    }
+
+    Mutex m_mutex;
+    std::vector<std::unique_ptr<CCoinsViewCache>> m_caches GUARDED_BY(m_mutex);
+};
+
+CoinsViewCachePool g_coins_view_cache_pool;
+
 class MemPoolAccept
 {
 public:
-    explicit MemPoolAccept(CTxMemPool& mempool, CChainState& active_chainstate) : m_pool(mempool), m_view(&m_dummy), m_viewmempool(&active_chainstate.CoinsTip(), m_pool), m_active_chainstate(active_chainstate),
+    explicit MemPoolAccept(CTxMemPool& mempool, CChainState& active_chainstate) : m_pool(mempool), m_pooled_view(g_coins_view_cache_pool.Take(&m_dummy)), m_view(*m_pooled_view), m_viewmempool(&active_chainstate.CoinsTip(), m_pool), m_active_chainstate(active_chainstate),
         m_limit_ancestors(gArgs.GetIntArg("-limitancestorcount", DEFAULT_ANCESTOR_LIMIT)),
         m_limit_ancestor_size(gArgs.GetIntArg("-limitancestorsize", DEFAULT_ANCESTOR_SIZE_LIMIT)*1000),
         m_limit_descendants(gArgs.GetIntArg("-limitdescendantcount", DEFAULT_DESCENDANT_LIMIT)),
-        m_limit_descendant_size(gArgs.GetIntArg("-limitdescendantsize", DEFAULT_DESCENDANT_SIZE_LIMIT)*1000) {
+        m_limit_descendant_size(gArgs.GetIntArg("-limitdescendantsize", DEFAULT_DESCENDANT_SIZE_LIMIT)*1000),
+        m_configured_limit_descendants(m_limit_descendants),
+        m_configured_limit_descendant_size(m_limit_descendant_size) {
     }
 
     // We put the arguments we're handed into a struct, so we can pass them
@@ -538,6 +650,23 @@ public:
      */
     PackageMempoolAcceptResult AcceptPackage(const Package& package, ATMPArgs& args) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
 
+    /**
+     * Batch acceptance. Each transaction is accepted as by AcceptSingleTransaction(), but the
+     * policy script checks of the transactions that neither spend nor conflict with an earlier
+     * one in the batch run in parallel, without holding cs_main or the mempool lock. Results are
+     * in the order of txns; accept_times holds the acceptance time of each transaction.
+     */
+    std::vector<MempoolAcceptResult> AcceptTransactionBatch(const std::vector<CTransactionRef>& txns, const std::vector<int64_t>& accept_times, bool test_accept) LOCKS_EXCLUDED(cs_main, m_pool.cs);
+
+    /**
+     * Re-add the transactions of disconnected blocks, given in the order they were confirmed in,
+     * as by AcceptSingleTransaction() with bypass_limits. Each transaction is checked against the
+     * mempool and the transactions before it in txns, and the policy script checks of all of them
+     * run in parallel. The locks stay held throughout, so that the mempool is consistent with the
+     * new tip once this returns. Results are in the order of txns.
+     */
+    std::vector<MempoolAcceptResult> AcceptReorgTransactions(const std::vector<CTransactionRef>& txns, int64_t accept_time) EXCLUSIVE_LOCKS_REQUIRED(cs_main, m_pool.cs);
+
 private:
     // All the intermediate state that gets passed between the various levels
     // of checking a given transaction.
@@ -581,6 +710,35 @@ private:
         PrecomputedTransactionData m_precomputed_txdata;
     };
 
+    // The state of one transaction between the stages of AcceptTransactionBatch() and
+    // AcceptReorgTransactions().
+    struct BatchEntry {
+        std::optional<Workspace> m_ws;
+        std::vector<COutPoint> m_coins_to_uncache;
+        /** The descendant limits PreChecks() settled on for this transaction. */
+        size_t m_limit_descendants{0};
+        size_t m_limit_descendant_size{0};
+        /** Set by the script check workers if any of the policy script checks failed. */
+        std::atomic<bool> m_script_failed{false};
+        /** Spends or conflicts with an earlier transaction of the batch, so is accepted on its own after it. */
+        bool m_deferred{false};
+        std::optional<MempoolAcceptResult> m_result;
+    };
+
+    // Run PreChecks() and, if needed, ReplacementChecks() for a transaction of a batch, starting
+    // from a fresh Workspace and the configured descendant limits.
+    bool BatchPreChecks(ATMPArgs& args, BatchEntry& entry, const CTransactionRef& ptx) EXCLUSIVE_LOCKS_REQUIRED(cs_main, m_pool.cs);
+
+    // Run BatchPreChecks() for a transaction of a batch and queue its policy script checks, which
+    // set entry.m_script_failed should any fail. Sets entry.m_result if the transaction fails.
+    void BatchQueueChecks(ATMPArgs& args, BatchEntry& entry, const CTransactionRef& ptx, std::vector<MempoolScriptCheck>& checks) EXCLUSIVE_LOCKS_REQUIRED(cs_main, m_pool.cs);
+
+    // Finish a transaction of a batch once its policy script checks have run: check it against
+    // the mempool again if recheck is set, then run the remaining checks, add it and set
+    // entry.m_result. sequence is the mempool sequence the next transactions were checked
+    // against, and advances past this one if adding it changed nothing else.
+    void BatchFinish(ATMPArgs& args, BatchEntry& entry, const CTransactionRef& ptx, bool recheck, uint64_t& sequence) EXCLUSIVE_LOCKS_REQUIRED(cs_main, m_pool.cs);
+
     // Run the policy checks on a given transaction, excluding any script checks.
     // Looks up inputs, calculates feerate, considers replacement, evaluates
     // package limits, etc. As this function can be invoked for "free" by a peer,
@@ -636,7 +794,9 @@ private:
 
 private:
     CTxMemPool& m_pool;
-    CCoinsViewCache m_view;
+    // Borrowed from g_coins_view_cache_pool rather than built for each MemPoolAccept.
+    CoinsViewCachePool::Handle m_pooled_view;
+    CCoinsViewCache& m_view;
     CCoinsViewMemPool m_viewmempool;
     CCoinsView m_dummy;
 
@@ -649,6 +809,9 @@ private:
     // in-mempool conflicts; see below).
     size_t m_limit_descendants;
     size_t m_limit_descendant_size;
+    // The descendant limits before any such modification, for batches of transactions.
+    const size_t m_configured_limit_descendants;
+    const size_t m_configured_limit_descendant_size;
 
     /** Whether the transaction(s) would replace any mempool transactions. If so, RBF rules apply. */
     bool m_rbf{false};
@@ -1054,6 +1217,22 @@ bool MemPoolAccept::Finalize(const ATMPArgs& args, Workspace& ws)
     // transaction has not necessarily been accepted to miners' mempools.
     bool validForFeeEstimation = !bypass_limits && !args.m_package_submission && IsCurrentForFeeEstimation(m_active_chainstate) && m_pool.HasNoInputsOf(tx);
 
+    // Keep the segwit sighash midstates for when the transaction is mined, so
+    // that ConnectBlock does not compute them again if the transaction's
+    // script checks miss the script execution cache. The spent outputs and
+    // legacy sighash data, which grow with the transaction, are dropped to
+    // bound the memory used: ConnectBlock recomputes them from its view.
+    const PrecomputedTransactionData& txdata = ws.m_precomputed_txdata;
+    if (txdata.m_bip143_segwit_ready || txdata.m_bip341_taproot_ready) {
+        auto kept = std::make_shared<PrecomputedTransactionData>(txdata);
+        kept->m_spent_outputs = {};
+        kept->m_spent_outputs_ready = false;
+        kept->m_legacy_prefixes = {};
+        kept->m_legacy_suffix = {};
+        kept->m_legacy_ready = false;
+        entry->SetPrecomputedTxData(std::move(kept));
+    }
+
     // Store transaction in memory
     m_pool.addUnchecked(*entry, ws.m_ancestors, validForFeeEstimation);
 
@@ -1344,6 +1523,228 @@ PackageMempoolAcceptResult MemPoolAccept::AcceptPackage(const Package& package,
     return submission_result;
 }
 
+bool MemPoolAccept::BatchPreChecks(ATMPArgs& args, BatchEntry& entry, const CTransactionRef& ptx)
+{
+    AssertLockHeld(cs_main);
+    AssertLockHeld(m_pool.cs);
+
+    // Coins cached by an earlier attempt may have been spent or left the mempool since.
+    for (const CTxIn& txin : ptx->vin) {
+        m_view.Uncache(txin.prevout);
+    }
+    // The precomputed data only depends on the transaction and the outputs it spends, so it
+    // carries over.
+    PrecomputedTransactionData txdata;
+    if (entry.m_ws) txdata = std::move(entry.m_ws->m_precomputed_txdata);
+    entry.m_ws.emplace(ptx);
+    Workspace& ws{*entry.m_ws};
+    ws.m_precomputed_txdata = std::move(txdata);
+
+    m_limit_descendants = m_configured_limit_descendants;
+    m_limit_descendant_size = m_configured_limit_descendant_size;
+    if (!PreChecks(args, ws)) return false;
+    if (m_rbf && !ReplacementChecks(ws)) return false;
+    entry.m_limit_descendants = m_limit_descendants;
+    entry.m_limit_descendant_size = m_limit_descendant_size;
+    return true;
+}
+
+void MemPoolAccept::BatchQueueChecks(ATMPArgs& args, BatchEntry& entry, const CTransactionRef& ptx, std::vector<MempoolScriptCheck>& checks)
+{
+    AssertLockHeld(cs_main);
+    AssertLockHeld(m_pool.cs);
+
+    if (!BatchPreChecks(args, entry, ptx)) {
+        entry.m_result.emplace(MempoolAcceptResult::Failure(entry.m_ws->m_state));
+        return;
+    }
+    // Queue the policy script checks that miss the script execution cache. Should any fail,
+    // PolicyScriptChecks() fills in the state in BatchFinish().
+    Workspace& ws{*entry.m_ws};
+    std::vector<CScriptCheck> tx_checks;
+    CheckInputScripts(*ptx, ws.m_state, m_view, STANDARD_SCRIPT_VERIFY_FLAGS, /*cacheSigStore=*/true, /*cacheFullScriptStore=*/false, ws.m_precomputed_txdata, &tx_checks);
+    for (CScriptCheck& check : tx_checks) {
+        checks.emplace_back(check, entry.m_script_failed);
+    }
+}
+
+void MemPoolAccept::BatchFinish(ATMPArgs& args, BatchEntry& entry, const CTransactionRef& ptx, bool recheck, uint64_t& sequence)
+{
+    AssertLockHeld(cs_main);
+    AssertLockHeld(m_pool.cs);
+
+    // Transactions submitted in between may spend the same outputs or have replaced or evicted
+    // the ones this one spends, so check it again. The script checks still hold, as they only
+    // depend on the outputs spent.
+    if (recheck) {
+        if (!BatchPreChecks(args, entry, ptx)) {
+            entry.m_result.emplace(MempoolAcceptResult::Failure(entry.m_ws->m_state));
+            return;
+        }
+    } else {
+        // Transactions submitted earlier in the batch may share ancestors with this one, and
+        // bring them over the descendant limits.
+        Workspace& ws{*entry.m_ws};
+        std::string err_string;
+        if (!m_pool.CalculateMemPoolAncestors(*ws.m_entry, ws.m_ancestors, m_limit_ancestors, m_limit_ancestor_size,
+                                              entry.m_limit_descendants, entry.m_limit_descendant_size, err_string)) {
+            ws.m_state.Invalid(TxValidationResult::TX_MEMPOOL_POLICY, "too-long-mempool-chain", err_string);
+            entry.m_result.emplace(MempoolAcceptResult::Failure(ws.m_state));
+            return;
+        }
+    }
+    Workspace& ws{*entry.m_ws};
+
+    if ((entry.m_script_failed && !PolicyScriptChecks(args, ws)) || !ConsensusScriptChecks(args, ws)) {
+        entry.m_result.emplace(MempoolAcceptResult::Failure(ws.m_state));
+        return;
+    }
+    if (args.m_test_accept) {
+        entry.m_result.emplace(MempoolAcceptResult::Success(std::move(ws.m_replaced_transactions), ws.m_vsize, ws.m_base_fees));
+        return;
+    }
+
+    const uint64_t sequence_before{m_pool.GetSequence()};
+    if (!Finalize(args, ws)) {
+        entry.m_result.emplace(MempoolAcceptResult::Failure(ws.m_state));
+        return;
+    }
+    GetMainSignals().TransactionAddedToMempool(ptx, m_pool.GetAndIncrementSequence());
+    entry.m_result.emplace(MempoolAcceptResult::Success(std::move(ws.m_replaced_transactions), ws.m_vsize, ws.m_base_fees));
+    // The transactions after this one were checked against a mempool without it. Adding it
+    // leaves those checks valid, but replacing or evicting transactions does not.
+    if (sequence_before == sequence && m_pool.GetSequence() == sequence + 1) {
+        sequence = m_pool.GetSequence();
+    }
+}
+
+std::vector<MempoolAcceptResult> MemPoolAccept::AcceptTransactionBatch(const std::vector<CTransactionRef>& txns, const std::vector<int64_t>& accept_times, bool test_accept)
+{
+    AssertLockNotHeld(cs_main);
+    assert(accept_times.size() == txns.size());
+    const CChainParams& chainparams{m_active_chainstate.m_params};
+    std::vector<BatchEntry> entries(txns.size());
+    std::vector<MempoolScriptCheck> checks;
+    uint64_t sequence;
+    uint256 tip;
+
+    {
+        LOCK2(cs_main, m_pool.cs);
+        // Outpoints spent and transactions created by the batch so far.
+        std::unordered_set<COutPoint, SaltedOutpointHasher> spent;
+        std::unordered_set<uint256, SaltedTxidHasher> created;
+        for (size_t i = 0; i < txns.size(); ++i) {
+            const CTransaction& tx{*txns[i]};
+            BatchEntry& entry{entries[i]};
+            entry.m_deferred = created.count(tx.GetHash()) > 0 ||
+                               std::any_of(tx.vin.begin(), tx.vin.end(), [&](const CTxIn& txin) {
+                                   return spent.count(txin.prevout) > 0 || created.count(txin.prevout.hash) > 0;
+                               });
+            for (const CTxIn& txin : tx.vin) spent.insert(txin.prevout);
+            created.insert(tx.GetHash());
+            if (entry.m_deferred) continue;
+
+            auto args{ATMPArgs::SingleAccept(chainparams, accept_times[i], /*bypass_limits=*/false, entry.m_coins_to_uncache, test_accept)};
+            BatchQueueChecks(args, entry, txns[i], checks);
+        }
+        sequence = m_pool.GetSequence();
+        tip = m_active_chainstate.m_chain.Tip()->GetBlockHash();
+    }
+
+    // The script checks only read the transactions, the outputs they spend (copied into the
+    // checks) and the signature cache, so they run without the locks.
+    {
+        CCheckQueueControl<MempoolScriptCheck> control(&mempoolcheckqueue);
+        control.Add(checks);
+        control.Wait();
+    }
+
+    LOCK2(cs_main, m_pool.cs);
+    const bool tip_changed{m_active_chainstate.m_chain.Tip()->GetBlockHash() != tip};
+    for (size_t i = 0; i < txns.size(); ++i) {
+        BatchEntry& entry{entries[i]};
+        if (entry.m_deferred || entry.m_result) continue;
+        auto args{ATMPArgs::SingleAccept(chainparams, accept_times[i], /*bypass_limits=*/false, entry.m_coins_to_uncache, test_accept)};
+        BatchFinish(args, entry, txns[i], /*recheck=*/tip_changed || m_pool.GetSequence() != sequence, sequence);
+    }
+
+    std::vector<MempoolAcceptResult> results;
+    results.reserve(txns.size());
+    for (size_t i = 0; i < txns.size(); ++i) {
+        BatchEntry& entry{entries[i]};
+        if (entry.m_deferred) {
+            auto args{ATMPArgs::SingleAccept(chainparams, accept_times[i], /*bypass_limits=*/false, entry.m_coins_to_uncache, test_accept)};
+            entry.m_result.emplace(MemPoolAccept(m_pool, m_active_chainstate).AcceptSingleTransaction(txns[i], args));
+        }
+        // As in AcceptToMemoryPool(), do not keep the coins brought into the cache for a
+        // transaction that was not accepted.
+        if (entry.m_result->m_result_type != MempoolAcceptResult::ResultType::VALID) {
+            for (const COutPoint& outpoint : entry.m_coins_to_uncache) {
+                m_active_chainstate.CoinsTip().Uncache(outpoint);
+            }
+        }
+        results.push_back(std::move(*entry.m_result));
+    }
+    return results;
+}
+
+std::vector<MempoolAcceptResult> MemPoolAccept::AcceptReorgTransactions(const std::vector<CTransactionRef>& txns, int64_t accept_time)
+{
+    AssertLockHeld(cs_main);
+    AssertLockHeld(m_pool.cs);
+    const CChainParams& chainparams{m_active_chainstate.m_params};
+    std::vector<BatchEntry> entries(txns.size());
+    std::vector<MempoolScriptCheck> checks;
+    std::unordered_set<uint256, SaltedTxidHasher> batch_txids;
+
+    for (size_t i = 0; i < txns.size(); ++i) {
+        BatchEntry& entry{entries[i]};
+        auto args{ATMPArgs::SingleAccept(chainparams, accept_time, /*bypass_limits=*/true, entry.m_coins_to_uncache, /*test_accept=*/false)};
+        BatchQueueChecks(args, entry, txns[i], checks);
+        // Make the outputs available to the transactions after this one, which cannot find it in
+        // the mempool yet.
+        if (!entry.m_result) m_viewmempool.PackageAddTransaction(txns[i]);
+        batch_txids.insert(txns[i]->GetHash());
+    }
+
+    // Unlike AcceptTransactionBatch(), keep holding the locks while the script checks run, so
+    // that the mempool is never seen without the transactions of the disconnected blocks.
+    {
+        CCheckQueueControl<MempoolScriptCheck> control(&mempoolcheckqueue);
+        control.Add(checks);
+        control.Wait();
+    }
+
+    uint64_t sequence{m_pool.GetSequence()};
+    for (size_t i = 0; i < txns.size(); ++i) {
+        BatchEntry& entry{entries[i]};
+        if (entry.m_result) continue;
+        // A parent from the batch that did not make it into the mempool leaves this one orphaned.
+        const bool missing_parent{std::any_of(txns[i]->vin.begin(), txns[i]->vin.end(), [&](const CTxIn& txin) {
+            return batch_txids.count(txin.prevout.hash) > 0 && !m_pool.exists(GenTxid::Txid(txin.prevout.hash));
+        })};
+        if (missing_parent) {
+            entry.m_ws->m_state.Invalid(TxValidationResult::TX_MISSING_INPUTS, "bad-txns-inputs-missingorspent");
+            entry.m_result.emplace(MempoolAcceptResult::Failure(entry.m_ws->m_state));
+            continue;
+        }
+        auto args{ATMPArgs::SingleAccept(chainparams, accept_time, /*bypass_limits=*/true, entry.m_coins_to_uncache, /*test_accept=*/false)};
+        BatchFinish(args, entry, txns[i], /*recheck=*/m_pool.GetSequence() != sequence, sequence);
+    }
+
+    std::vector<MempoolAcceptResult> results;
+    results.reserve(txns.size());
+    for (BatchEntry& entry : entries) {
+        if (entry.m_result->m_result_type != MempoolAcceptResult::ResultType::VALID) {
+            for (const COutPoint& outpoint : entry.m_coins_to_uncache) {
+                m_active_chainstate.CoinsTip().Uncache(outpoint);
+            }
+        }
+        results.push_back(std::move(*entry.m_result));
+    }
+    return results;
+}
+
 } // anon namespace
 
 MempoolAcceptResult AcceptToMemoryPool(CChainState& active_chainstate, const CTransactionRef& tx,
@@ -1373,6 +1774,18 @@ MempoolAcceptResult AcceptToMemoryPool(CChainState& active_chainstate, const CTr
     return result;
 }
 
+static std::vector<MempoolAcceptResult> AcceptReorgTransactions(CChainState& active_chainstate, const std::vector<CTransactionRef>& txns, int64_t accept_time)
+{
+    AssertLockHeld(::cs_main);
+    CTxMemPool& pool{*Assert(active_chainstate.GetMempool())};
+    AssertLockHeld(pool.cs);
+    std::vector<MempoolAcceptResult> results{MemPoolAccept(pool, active_chainstate).AcceptReorgTransactions(txns, accept_time)};
+    // As AcceptToMemoryPool() does, ensure the coins cache is still within its size limits.
+    BlockValidationState state_dummy;
+    active_chainstate.FlushStateToDisk(state_dummy, FlushStateMode::PERIODIC);
+    return results;
+}
+
 PackageMempoolAcceptResult ProcessNewPackage(CChainState& active_chainstate, CTxMemPool& pool,
                                                    const Package& package, bool test_accept)
 {
@@ -1820,11 +2233,13 @@ static CCheckQueue<CScriptCheck> scriptcheckqueue(128);
 void StartScriptCheckWorkerThreads(int threads_num)
 {
     scriptcheckqueue.StartWorkerThreads(threads_num);
+    mempoolcheckqueue.StartWorkerThreads(threads_num);
 }
 
 void StopScriptCheckWorkerThreads()
 {
     scriptcheckqueue.StopWorkerThreads();
+    mempoolcheckqueue.StopWorkerThreads();
 }
 
 /**
@@ -2102,6 +2517,16 @@ bool CChainState::ConnectBlock(const CBlock& block, BlockValidationState& state,
     // for as long as `control`.
     CCheckQueueControl<CScriptCheck> control(fScriptChecks && g_parallel_script_checks ? &scriptcheckqueue : nullptr);
     std::vector<PrecomputedTransactionData> txsdata(block.vtx.size());
+    if (fScriptChecks && m_mempool) {
+        // Start from the sighash midstates that were computed when the
+        // transactions were accepted to the mempool.
+        LOCK(m_mempool->cs);
+        for (size_t i = 1; i < block.vtx.size(); ++i) {
+            if (const auto txdata{m_mempool->GetPrecomputedTxData(block.vtx[i]->GetHash())}) {
+                txsdata[i] = *txdata;
+            }
+        }
+    }
 
     std::vector<int> prevheights;
     CAmount nFees = 0;
@@ -3733,6 +4158,28 @@ MempoolAcceptResult ChainstateManager::ProcessTransaction(const CTransactionRef&
     return result;
 }
 
+std::vector<MempoolAcceptResult> ChainstateManager::ProcessTransactions(const std::vector<CTransactionRef>& txns, bool test_accept)
+{
+    AssertLockNotHeld(cs_main);
+    CChainState& active_chainstate = ActiveChainstate();
+    if (!active_chainstate.GetMempool()) {
+        TxValidationState state;
+        state.Invalid(TxValidationResult::TX_NO_MEMPOOL, "no-mempool");
+        return std::vector<MempoolAcceptResult>(txns.size(), MempoolAcceptResult::Failure(state));
+    }
+    CTxMemPool& pool{*active_chainstate.GetMempool()};
+    std::optional<MemPoolAccept> accept;
+    WITH_LOCK(cs_main, accept.emplace(pool, active_chainstate));
+    auto results = accept->AcceptTransactionBatch(txns, std::vector<int64_t>(txns.size(), GetTime()), test_accept);
+
+    LOCK(cs_main);
+    // Ensure the coins cache is still within limits.
+    BlockValidationState state_dummy;
+    active_chainstate.FlushStateToDisk(state_dummy, FlushStateMode::PERIODIC);
+    pool.check(active_chainstate.CoinsTip(), active_chainstate.m_chain.Height() + 1);
+    return results;
+}
+
 bool TestBlockValidity(BlockValidationState& state,
                        const CChainParams& chainparams,
                        CChainState& chainstate,
@@ -3981,13 +4428,13 @@ bool CChainState::ReplayBlocks()
     if (m_blockman.m_block_index.count(hashHeads[0]) == 0) {
         return error("ReplayBlocks(): reorganization to unknown block requested");
     }
-    pindexNew = &(m_blockman.m_block_index[hashHeads[0]]);
+    pindexNew = &(m_blockman.m_block_index.find(hashHeads[0])->second);
 
     if (!hashHeads[1].IsNull()) { // The old tip is allowed to be 0, indicating it's the first flush.
         if (m_blockman.m_block_index.count(hashHeads[1]) == 0) {
             return error("ReplayBlocks(): reorganization from unknown block requested");
         }
-        pindexOld = &(m_blockman.m_block_index[hashHeads[1]]);
+        pindexOld = &(m_blockman.m_block_index.find(hashHeads[1])->second);
         pindexFork = LastCommonAncestor(pindexOld, pindexNew);
         assert(pindexFork != nullptr);
     }
@@ -4566,9 +5013,12 @@ bool CChainState::ResizeCoinsCaches(size_t coinstip_size, size_t coinsdb_size)
 }
 
 static const uint64_t MEMPOOL_DUMP_VERSION = 1;
+/** Number of transactions LoadMempool() accepts at a time. */
+static constexpr size_t MEMPOOL_LOAD_BATCH_SIZE{1000};
 
 bool LoadMempool(CTxMemPool& pool, CChainState& active_chainstate, FopenFn mockable_fopen_function)
 {
+    int64_t start = GetTimeMicros();
     int64_t nExpiryTimeout = gArgs.GetIntArg("-mempoolexpiry", DEFAULT_MEMPOOL_EXPIRY) * 60 * 60;
     FILE* filestr{mockable_fopen_function(gArgs.GetDataDirNet() / "mempool.dat", "rb")};
     CAutoFile file(filestr, SER_DISK, CLIENT_VERSION);
@@ -4584,6 +5034,37 @@ bool LoadMempool(CTxMemPool& pool, CChainState& active_chainstate, FopenFn mocka
     int64_t unbroadcast = 0;
     int64_t nNow = GetTime();
 
+    // Transactions are accepted in batches, so that their script checks run in parallel.
+    std::vector<CTransactionRef> batch;
+    std::vector<int64_t> batch_times;
+    const auto accept_batch = [&] {
+        if (batch.empty()) return;
+        std::optional<MemPoolAccept> accept;
+        WITH_LOCK(cs_main, accept.emplace(pool, active_chainstate));
+        const std::vector<MempoolAcceptResult> results{accept->AcceptTransactionBatch(batch, batch_times, /*test_accept=*/false)};
+        for (size_t i = 0; i < batch.size(); ++i) {
+            if (results[i].m_result_type == MempoolAcceptResult::ResultType::VALID) {
+                ++count;
+            } else {
+                // mempool may contain the transaction already, e.g. from
+                // wallet(s) having loaded it while we were processing
+                // mempool transactions; consider these as valid, instead of
+                // failed, but mark them as 'already there'
+                if (pool.exists(GenTxid::Txid(batch[i]->GetHash()))) {
+                    ++already_there;
+                } else {
+                    ++failed;
+                }
+            }
+        }
+        batch.clear();
+        batch_times.clear();
+        // Ensure the coins cache is still within limits.
+        LOCK(cs_main);
+        BlockValidationState state_dummy;
+        active_chainstate.FlushStateToDisk(state_dummy, FlushStateMode::PERIODIC);
+    };
+
     try {
         uint64_t version;
         file >> version;
@@ -4606,26 +5087,16 @@ bool LoadMempool(CTxMemPool& pool, CChainState& active_chainstate, FopenFn mocka
                 pool.PrioritiseTransaction(tx->GetHash(), amountdelta);
             }
             if (nTime > nNow - nExpiryTimeout) {
-                LOCK(cs_main);
-                const auto& accepted = AcceptToMemoryPool(active_chainstate, tx, nTime, /*bypass_limits=*/false, /*test_accept=*/false);
-                if (accepted.m_result_type == MempoolAcceptResult::ResultType::VALID) {
-                    ++count;
-                } else {
-                    // mempool may contain the transaction already, e.g. from
-                    // wallet(s) having loaded it while we were processing
-                    // mempool transactions; consider these as valid, instead of
-                    // failed, but mark them as 'already there'
-                    if (pool.exists(GenTxid::Txid(tx->GetHash()))) {
-                        ++already_there;
-                    } else {
-                        ++failed;
-                    }
-                }
+                batch.push_back(std::move(tx));
+                batch_times.push_back(nTime);
             } else {
                 ++expired;
             }
-            if (ShutdownRequested())
-                return false;
+            if (batch.size() >= MEMPOOL_LOAD_BATCH_SIZE || num == 0) {
+                accept_batch();
+                if (ShutdownRequested())
+                    return false;
+            }
         }
         std::map<uint256, CAmount> mapDeltas;
         file >> mapDeltas;
@@ -4644,10 +5115,12 @@ bool LoadMempool(CTxMemPool& pool, CChainState& active_chainstate, FopenFn mocka
         }
     } catch (const std::exception& e) {
         LogPrintf("Failed to deserialize mempool data on disk: %s. Continuing anyway.\n", e.what());
+        // Keep the transactions read before the error, as when accepting them one by one.
+        accept_batch();
         return false;
     }
 
-    LogPrintf("Imported mempool transactions from disk: %i succeeded, %i failed, %i expired, %i already there, %i waiting for initial broadcast\n", count, failed, expired, already_there, unbroadcast);
+    LogPrintf("Imported mempool transactions from disk: %i succeeded, %i failed, %i expired, %i already there, %i waiting for initial broadcast, in %gs\n", count, failed, expired, already_there, unbroadcast, 0.000001 * (GetTimeMicros() - start));
     return true;
 }
 
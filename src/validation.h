@@ -139,7 +139,7 @@ extern const std::vector<std::string> CHECKLEVEL_DOC;
 
 /** Unload database information */
 void UnloadBlockIndex(CTxMemPool* mempool, ChainstateManager& chainman) EXCLUSIVE_LOCKS_REQUIRED(::cs_main);
-/** Run instances of script checking worker threads */
+/** Run instances of script checking worker threads, for blocks and for batches of mempool transactions */
 void StartScriptCheckWorkerThreads(int threads_num);
 /** Stop all of the script checking worker threads */
 void StopScriptCheckWorkerThreads();
@@ -978,6 +978,23 @@ public:
     [[nodiscard]] MempoolAcceptResult ProcessTransaction(const CTransactionRef& tx, bool test_accept=false)
         EXCLUSIVE_LOCKS_REQUIRED(cs_main);
 
+    /**
+     * Try to add a batch of transactions to the memory pool, each as ProcessTransaction() would.
+     *
+     * The checks short of script verification run under cs_main. The locks are then released
+     * while the policy script checks of the transactions that neither spend nor conflict with
+     * an earlier one in the batch run in parallel, on the script check worker threads. The
+     * transactions are submitted in order once the locks are taken again, after checking them
+     * again if the chain tip or the mempool changed in between. Transactions that do depend on
+     * or conflict with an earlier one are processed one by one at the end.
+     *
+     * @param[in]  txns            The transactions to submit for mempool acceptance.
+     * @param[in]  test_accept     When true, run validation checks but don't submit to mempool.
+     * @returns one MempoolAcceptResult per transaction, in the order of txns.
+     */
+    [[nodiscard]] std::vector<MempoolAcceptResult> ProcessTransactions(const std::vector<CTransactionRef>& txns, bool test_accept=false)
+        LOCKS_EXCLUDED(cs_main);
+
     //! Load the block tree and coins database from disk, initializing state if we're running with -reindex
     bool LoadBlockIndex() EXCLUSIVE_LOCKS_REQUIRED(cs_main);
 
@@ -39,6 +39,7 @@ static const int INVALID_CB_NO_BAN_VERSION = 70015;
 static const int WTXID_RELAY_VERSION = 70016;
 
 // Make sure that none of the values above collide with
-// `SERIALIZE_TRANSACTION_NO_WITNESS` or `ADDRV2_FORMAT`.
+// `SERIALIZE_TRANSACTION_NO_WITNESS`, `SERIALIZE_TRANSACTION_LAZY_HASH`
+// or `ADDRV2_FORMAT`.
 
 #endif // BITCOIN_VERSION_H
@@ -9,7 +9,11 @@
 #include <zmq.h>
 
 #include <validation.h>
+#include <util/syscall_sandbox.h>
 #include <util/system.h>
+#include <util/thread.h>
+
+#include <algorithm>
 
 CZMQNotificationInterface::CZMQNotificationInterface() : pcontext(nullptr)
 {
@@ -23,6 +27,7 @@ CZMQNotificationInterface::~CZMQNotificationInterface()
 std::list<const CZMQAbstractNotifier*> CZMQNotificationInterface::GetActiveNotifiers() const
 {
     std::list<const CZMQAbstractNotifier*> result;
+    LOCK(m_notifiers_mutex);
     for (const auto& n : notifiers) {
         result.push_back(n.get());
     }
@@ -55,7 +60,8 @@ CZMQNotificationInterface* CZMQNotificationInterface::Create()
     if (!notifiers.empty())
     {
         std::unique_ptr<CZMQNotificationInterface> notificationInterface(new CZMQNotificationInterface());
-        notificationInterface->notifiers = std::move(notifiers);
+        WITH_LOCK(notificationInterface->m_notifiers_mutex, notificationInterface->notifiers = std::move(notifiers));
+        notificationInterface->m_max_queue_size = static_cast<size_t>(std::max<int64_t>(0, gArgs.GetIntArg("-zmqqueuesize", DEFAULT_ZMQ_QUEUE_SIZE)));
 
         if (notificationInterface->Initialize()) {
             return notificationInterface.release();
@@ -83,15 +89,21 @@ bool CZMQNotificationInterface::Initialize()
         return false;
     }
 
-    for (auto& notifier : notifiers) {
-        if (notifier->Initialize(pcontext)) {
-            LogPrint(BCLog::ZMQ, "zmq: Notifier %s ready (address = %s)\n", notifier->GetType(), notifier->GetAddress());
-        } else {
-            LogPrint(BCLog::ZMQ, "zmq: Notifier %s failed (address = %s)\n", notifier->GetType(), notifier->GetAddress());
-            return false;
+    {
+        LOCK(m_notifiers_mutex);
+        for (auto& notifier : notifiers) {
+            if (notifier->Initialize(pcontext)) {
+                LogPrint(BCLog::ZMQ, "zmq: Notifier %s ready (address = %s)\n", notifier->GetType(), notifier->GetAddress());
+            } else {
+                LogPrint(BCLog::ZMQ, "zmq: Notifier %s failed (address = %s)\n", notifier->GetType(), notifier->GetAddress());
+                return false;
+            }
         }
     }
 
+    LogPrint(BCLog::ZMQ, "zmq: Publisher queue holds up to %u mempool notifications\n", m_max_queue_size);
+    m_publisher_thread = std::thread(&util::TraceThread, "zmqpub", [this] { ThreadPublish(); });
+
     return true;
 }
 
@@ -99,8 +111,15 @@ bool CZMQNotificationInterface::Initialize()
 void CZMQNotificationInterface::Shutdown()
 {
     LogPrint(BCLog::ZMQ, "zmq: Shutdown notification interface\n");
+    if (m_publisher_thread.joinable()) {
+        // Publish what is still queued before closing the sockets
+        WITH_LOCK(m_queue_mutex, m_request_stop = true);
+        m_queue_cv.notify_one();
+        m_publisher_thread.join();
+    }
     if (pcontext)
     {
+        LOCK(m_notifiers_mutex);
         for (auto& notifier : notifiers) {
             LogPrint(BCLog::ZMQ, "zmq: Shutdown notifier %s at %s\n", notifier->GetType(), notifier->GetAddress());
             notifier->Shutdown();
@@ -129,63 +148,124 @@ void TryForEachAndRemoveFailed(std::list<std::unique_ptr<CZMQAbstractNotifier>>&
 
 } // anonymous namespace
 
+bool CZMQNotificationInterface::Enqueue(Notification notification, bool droppable)
+{
+    {
+        WAIT_LOCK(m_queue_mutex, lock);
+        if (m_queue.size() >= m_max_queue_size) {
+            if (droppable) return false;
+            // Hold up validation, as slow subscribers did before notifications were queued
+            m_queue_space_cv.wait(lock, [&]() EXCLUSIVE_LOCKS_REQUIRED(m_queue_mutex) { return m_queue.empty() || m_queue.size() < m_max_queue_size; });
+        }
+        if (m_dropped_acceptances > 0 || m_dropped_removals > 0) {
+            m_queue.emplace_back([acceptances = m_dropped_acceptances, removals = m_dropped_removals](Notifiers& notifiers) {
+                for (const auto& notifier : notifiers) {
+                    notifier->NotifyTransactionsDropped(acceptances, removals);
+                }
+            });
+            m_dropped_acceptances = 0;
+            m_dropped_removals = 0;
+        }
+        m_queue.push_back(std::move(notification));
+    }
+    m_queue_cv.notify_one();
+    return true;
+}
+
+void CZMQNotificationInterface::ThreadPublish()
+{
+    SetSyscallSandboxPolicy(SyscallSandboxPolicy::ZMQ_PUBLISHER);
+    while (true) {
+        Notification notification;
+        {
+            WAIT_LOCK(m_queue_mutex, lock);
+            m_queue_cv.wait(lock, [&]() EXCLUSIVE_LOCKS_REQUIRED(m_queue_mutex) { return m_request_stop || !m_queue.empty(); });
+            if (m_queue.empty()) return;
+            notification = std::move(m_queue.front());
+            m_queue.pop_front();
+        }
+        m_queue_space_cv.notify_one();
+        LOCK(m_notifiers_mutex);
+        notification(notifiers);
+    }
+}
+
 void CZMQNotificationInterface::UpdatedBlockTip(const CBlockIndex *pindexNew, const CBlockIndex *pindexFork, bool fInitialDownload)
 {
+    // The new tip was connected just before, so its block is still in memory
+    std::shared_ptr<const CBlock> block;
+    if (pindexNew == m_last_connected_index) block = std::move(m_last_connected_block);
+    m_last_connected_block.reset();
+    m_last_connected_index = nullptr;
+
     if (fInitialDownload || pindexNew == pindexFork) // In IBD or blocks were disconnected without any new ones
         return;
 
-    TryForEachAndRemoveFailed(notifiers, [pindexNew](CZMQAbstractNotifier* notifier) {
-        return notifier->NotifyBlock(pindexNew);
-    });
+    Enqueue([pindexNew, block](Notifiers& notifiers) {
+        TryForEachAndRemoveFailed(notifiers, [pindexNew, &block](CZMQAbstractNotifier* notifier) {
+            return notifier->NotifyBlock(pindexNew, block);
+        });
+    }, /*droppable=*/false);
 }
 
 void CZMQNotificationInterface::TransactionAddedToMempool(const CTransactionRef& ptx, uint64_t mempool_sequence)
 {
-    const CTransaction& tx = *ptx;
-
-    TryForEachAndRemoveFailed(notifiers, [&tx, mempool_sequence](CZMQAbstractNotifier* notifier) {
-        return notifier->NotifyTransaction(tx) && notifier->NotifyTransactionAcceptance(tx, mempool_sequence);
-    });
+    const bool queued = Enqueue([ptx, mempool_sequence](Notifiers& notifiers) {
+        const CTransaction& tx = *ptx;
+        TryForEachAndRemoveFailed(notifiers, [&tx, mempool_sequence](CZMQAbstractNotifier* notifier) {
+            return notifier->NotifyTransaction(tx) && notifier->NotifyTransactionAcceptance(tx, mempool_sequence);
+        });
+    }, /*droppable=*/true);
+    if (!queued) ++m_dropped_acceptances;
 }
 
 void CZMQNotificationInterface::TransactionRemovedFromMempool(const CTransactionRef& ptx, MemPoolRemovalReason reason, uint64_t mempool_sequence)
 {
     // Called for all non-block inclusion reasons
-    const CTransaction& tx = *ptx;
-
-    TryForEachAndRemoveFailed(notifiers, [&tx, mempool_sequence](CZMQAbstractNotifier* notifier) {
-        return notifier->NotifyTransactionRemoval(tx, mempool_sequence);
-    });
+    const bool queued = Enqueue([ptx, mempool_sequence](Notifiers& notifiers) {
+        const CTransaction& tx = *ptx;
+        TryForEachAndRemoveFailed(notifiers, [&tx, mempool_sequence](CZMQAbstractNotifier* notifier) {
+            return notifier->NotifyTransactionRemoval(tx, mempool_sequence);
+        });
+    }, /*droppable=*/true);
+    if (!queued) ++m_dropped_removals;
 }
 
 void CZMQNotificationInterface::BlockConnected(const std::shared_ptr<const CBlock>& pblock, const CBlockIndex* pindexConnected)
 {
-    for (const CTransactionRef& ptx : pblock->vtx) {
-        const CTransaction& tx = *ptx;
-        TryForEachAndRemoveFailed(notifiers, [&tx](CZMQAbstractNotifier* notifier) {
-            return notifier->NotifyTransaction(tx);
-        });
-    }
+    m_last_connected_block = pblock;
+    m_last_connected_index = pindexConnected;
+
+    Enqueue([pblock, pindexConnected](Notifiers& notifiers) {
+        for (const CTransactionRef& ptx : pblock->vtx) {
+            const CTransaction& tx = *ptx;
+            TryForEachAndRemoveFailed(notifiers, [&tx](CZMQAbstractNotifier* notifier) {
+                return notifier->NotifyTransaction(tx);
+            });
+        }
 
-    // Next we notify BlockConnect listeners for *all* blocks
-    TryForEachAndRemoveFailed(notifiers, [pindexConnected](CZMQAbstractNotifier* notifier) {
-        return notifier->NotifyBlockConnect(pindexConnected);
-    });
+        // Next we notify BlockConnect listeners for *all* blocks
+        TryForEachAndRemoveFailed(notifiers, [pindexConnected](CZMQAbstractNotifier* notifier) {
+            return notifier->NotifyBlockConnect(pindexConnected);
+        });
+    }, /*droppable=*/false);
 }
 
 void CZMQNotificationInterface::BlockDisconnected(const std::shared_ptr<const CBlock>& pblock, const CBlockIndex* pindexDisconnected)
 {
-    for (const CTransactionRef& ptx : pblock->vtx) {
-        const CTransaction& tx = *ptx;
-        TryForEachAndRemoveFailed(notifiers, [&tx](CZMQAbstractNotifier* notifier) {
-            return notifier->NotifyTransaction(tx);
-        });
-    }
+    Enqueue([pblock, pindexDisconnected](Notifiers& notifiers) {
+        for (const CTransactionRef& ptx : pblock->vtx) {
+            const CTransaction& tx = *ptx;
+            TryForEachAndRemoveFailed(notifiers, [&tx](CZMQAbstractNotifier* notifier) {
+                return notifier->NotifyTransaction(tx);
+            });
+        }
 
-    // Next we notify BlockDisconnect listeners for *all* blocks
-    TryForEachAndRemoveFailed(notifiers, [pindexDisconnected](CZMQAbstractNotifier* notifier) {
-        return notifier->NotifyBlockDisconnect(pindexDisconnected);
-    });
+        // Next we notify BlockDisconnect listeners for *all* blocks
+        TryForEachAndRemoveFailed(notifiers, [pindexDisconnected](CZMQAbstractNotifier* notifier) {
+            return notifier->NotifyBlockDisconnect(pindexDisconnected);
+        });
+    }, /*droppable=*/false);
 }
 
 CZMQNotificationInterface* g_zmq_notification_interface = nullptr;
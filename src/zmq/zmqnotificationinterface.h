@@ -5,9 +5,16 @@
 #ifndef BITCOIN_ZMQ_ZMQNOTIFICATIONINTERFACE_H
 #define BITCOIN_ZMQ_ZMQNOTIFICATIONINTERFACE_H
 
+#include <sync.h>
 #include <validationinterface.h>
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
 #include <list>
 #include <memory>
+#include <thread>
 
 class CBlockIndex;
 class CZMQAbstractNotifier;
@@ -15,6 +22,8 @@ class CZMQAbstractNotifier;
 class CZMQNotificationInterface final : public CValidationInterface
 {
 public:
+    static const int DEFAULT_ZMQ_QUEUE_SIZE{10000};
+
     virtual ~CZMQNotificationInterface();
 
     std::list<const CZMQAbstractNotifier*> GetActiveNotifiers() const;
@@ -33,10 +42,45 @@ protected:
     void UpdatedBlockTip(const CBlockIndex *pindexNew, const CBlockIndex *pindexFork, bool fInitialDownload) override;
 
 private:
+    using Notifiers = std::list<std::unique_ptr<CZMQAbstractNotifier>>;
+    using Notification = std::function<void(Notifiers&)>;
+
     CZMQNotificationInterface();
 
+    /**
+     * Queue a notification for the publisher thread, after accounting for the
+     * mempool notifications dropped before it. If the queue is full, droppable
+     * notifications are not queued and false is returned, others wait for room.
+     */
+    bool Enqueue(Notification notification, bool droppable) EXCLUSIVE_LOCKS_REQUIRED(!m_queue_mutex);
+    /** Publish queued notifications until asked to stop and the queue is empty. */
+    void ThreadPublish() EXCLUSIVE_LOCKS_REQUIRED(!m_queue_mutex, !m_notifiers_mutex);
+
     void *pcontext;
-    std::list<std::unique_ptr<CZMQAbstractNotifier>> notifiers;
+    mutable Mutex m_notifiers_mutex;
+    Notifiers notifiers GUARDED_BY(m_notifiers_mutex);
+
+    /**
+     * Notifications are published on a dedicated thread, so that slow
+     * subscribers don't hold up the validation interface queue. Mempool
+     * notifications are dropped while the queue is full, block notifications
+     * wait for room.
+     */
+    Mutex m_queue_mutex;
+    std::condition_variable m_queue_cv;
+    std::condition_variable m_queue_space_cv;
+    std::deque<Notification> m_queue GUARDED_BY(m_queue_mutex);
+    bool m_request_stop GUARDED_BY(m_queue_mutex){false};
+    size_t m_max_queue_size{DEFAULT_ZMQ_QUEUE_SIZE};
+    std::thread m_publisher_thread;
+
+    // Only accessed from the validation interface callbacks, which are serialized.
+    //! Mempool notifications dropped since the last queued notification
+    uint32_t m_dropped_acceptances{0};
+    uint32_t m_dropped_removals{0};
+    //! The last connected block, so that the new tip can be published without reading it from disk
+    std::shared_ptr<const CBlock> m_last_connected_block;
+    const CBlockIndex* m_last_connected_index{nullptr};
 };
 
 extern CZMQNotificationInterface* g_zmq_notification_interface;
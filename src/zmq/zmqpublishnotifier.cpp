@@ -205,7 +205,15 @@ bool CZMQAbstractPublishNotifier::SendZmqMessage(const char *command, const void
     return true;
 }
 
-bool CZMQPublishHashBlockNotifier::NotifyBlock(const CBlockIndex *pindex)
+void CZMQAbstractPublishNotifier::SkipZmqMessages(uint32_t count)
+{
+    if (count == 0) return;
+    LogPrint(BCLog::ZMQ, "zmq: Dropped %u %s messages to %s, publisher queue is full\n", count, type, address);
+    nSequence += count;
+    m_dropped += count;
+}
+
+bool CZMQPublishHashBlockNotifier::NotifyBlock(const CBlockIndex *pindex, const std::shared_ptr<const CBlock>& /*block*/)
 {
     uint256 hash = pindex->GetBlockHash();
     LogPrint(BCLog::ZMQ, "zmq: Publish hashblock %s to %s\n", hash.GetHex(), this->address);
@@ -227,22 +235,29 @@ bool CZMQPublishHashTransactionNotifier::NotifyTransaction(const CTransaction &t
     return SendZmqMessage(MSG_HASHTX, data, 32);
 }
 
-bool CZMQPublishRawBlockNotifier::NotifyBlock(const CBlockIndex *pindex)
+void CZMQPublishHashTransactionNotifier::NotifyTransactionsDropped(uint32_t acceptances, uint32_t /*removals*/)
+{
+    SkipZmqMessages(acceptances);
+}
+
+bool CZMQPublishRawBlockNotifier::NotifyBlock(const CBlockIndex *pindex, const std::shared_ptr<const CBlock>& block)
 {
     LogPrint(BCLog::ZMQ, "zmq: Publish rawblock %s to %s\n", pindex->GetBlockHash().GetHex(), this->address);
 
-    const Consensus::Params& consensusParams = Params().GetConsensus();
     CDataStream ss(SER_NETWORK, PROTOCOL_VERSION | RPCSerializationFlags());
-    {
+    if (block) {
+        ss << *block;
+    } else {
+        const Consensus::Params& consensusParams = Params().GetConsensus();
         LOCK(cs_main);
-        CBlock block;
-        if(!ReadBlockFromDisk(block, pindex, consensusParams))
+        CBlock block_from_disk;
+        if(!ReadBlockFromDisk(block_from_disk, pindex, consensusParams, /*lazy_hashes=*/true))
         {
             zmqError("Can't read block from disk");
             return false;
         }
 
-        ss << block;
+        ss << block_from_disk;
     }
 
     return SendZmqMessage(MSG_RAWBLOCK, &(*ss.begin()), ss.size());
@@ -257,6 +272,11 @@ bool CZMQPublishRawTransactionNotifier::NotifyTransaction(const CTransaction &tr
     return SendZmqMessage(MSG_RAWTX, &(*ss.begin()), ss.size());
 }
 
+void CZMQPublishRawTransactionNotifier::NotifyTransactionsDropped(uint32_t acceptances, uint32_t /*removals*/)
+{
+    SkipZmqMessages(acceptances);
+}
+
 // Helper function to send a 'sequence' topic message with the following structure:
 //    <32-byte hash> | <1-byte label> | <8-byte LE sequence> (optional)
 static bool SendSequenceMsg(CZMQAbstractPublishNotifier& notifier, uint256 hash, char label, std::optional<uint64_t> sequence = {})
@@ -297,3 +317,8 @@ bool CZMQPublishSequenceNotifier::NotifyTransactionRemoval(const CTransaction &t
     LogPrint(BCLog::ZMQ, "zmq: Publish hashtx mempool removal %s to %s\n", hash.GetHex(), this->address);
     return SendSequenceMsg(*this, hash, /* Mempool (R)emoval */ 'R', mempool_sequence);
 }
+
+void CZMQPublishSequenceNotifier::NotifyTransactionsDropped(uint32_t acceptances, uint32_t removals)
+{
+    SkipZmqMessages(acceptances + removals);
+}
@@ -24,6 +24,10 @@ public:
     */
     bool SendZmqMessage(const char *command, const void* data, size_t size);
 
+    /* account for messages that were dropped before being sent, so that
+       subscribers see a gap in the message sequence numbers */
+    void SkipZmqMessages(uint32_t count);
+
     bool Initialize(void *pcontext) override;
     void Shutdown() override;
 };
@@ -31,25 +35,27 @@ public:
 class CZMQPublishHashBlockNotifier : public CZMQAbstractPublishNotifier
 {
 public:
-    bool NotifyBlock(const CBlockIndex *pindex) override;
+    bool NotifyBlock(const CBlockIndex *pindex, const std::shared_ptr<const CBlock>& block) override;
 };
 
 class CZMQPublishHashTransactionNotifier : public CZMQAbstractPublishNotifier
 {
 public:
     bool NotifyTransaction(const CTransaction &transaction) override;
+    void NotifyTransactionsDropped(uint32_t acceptances, uint32_t removals) override;
 };
 
 class CZMQPublishRawBlockNotifier : public CZMQAbstractPublishNotifier
 {
 public:
-    bool NotifyBlock(const CBlockIndex *pindex) override;
+    bool NotifyBlock(const CBlockIndex *pindex, const std::shared_ptr<const CBlock>& block) override;
 };
 
 class CZMQPublishRawTransactionNotifier : public CZMQAbstractPublishNotifier
 {
 public:
     bool NotifyTransaction(const CTransaction &transaction) override;
+    void NotifyTransactionsDropped(uint32_t acceptances, uint32_t removals) override;
 };
 
 class CZMQPublishSequenceNotifier : public CZMQAbstractPublishNotifier
@@ -59,6 +65,7 @@ public:
     bool NotifyBlockDisconnect(const CBlockIndex *pindex) override;
     bool NotifyTransactionAcceptance(const CTransaction &transaction, uint64_t mempool_sequence) override;
     bool NotifyTransactionRemoval(const CTransaction &transaction, uint64_t mempool_sequence) override;
+    void NotifyTransactionsDropped(uint32_t acceptances, uint32_t removals) override;
 };
 
 #endif // BITCOIN_ZMQ_ZMQPUBLISHNOTIFIER_H
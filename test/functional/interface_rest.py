@@ -16,6 +16,8 @@ import urllib.parse
 from test_framework.messages import (
     BLOCK_HEADER_SIZE,
     COIN,
+    deser_compact_size,
+    deser_uint256,
 )
 from test_framework.test_framework import BitcoinTestFramework
 from test_framework.util import (
@@ -33,6 +35,23 @@ INVALID_PARAM = "abc"
 UNKNOWN_PARAM = "0000000000000000000000000000000000000000000000000000000000000000"
 
 
+def deser_mempool_snapshot(data):
+    """Deserialize a snapshot returned by /rest/mempool/snapshot or getmempoolsnapshot."""
+    f = BytesIO(data)
+    sequence, = unpack("<Q", f.read(8))
+    entries = {}
+    for _ in range(deser_compact_size(f)):
+        txid = deser_uint256(f)
+        fee, modified_fee, vsize = unpack("<qqI", f.read(20))
+        ancestors = unpack("<QQq", f.read(24))
+        descendants = unpack("<QQq", f.read(24))
+        entries[f"{txid:064x}"] = {"fee": fee, "modified_fee": modified_fee, "vsize": vsize,
+                                   "ancestors": ancestors, "descendants": descendants}
+    removed = [f"{deser_uint256(f):064x}" for _ in range(deser_compact_size(f))]
+    assert_equal(f.read(), b"")
+    return sequence, entries, removed
+
+
 class ReqType(Enum):
     JSON = 1
     BIN = 2
@@ -321,9 +340,38 @@ class RESTTest (BitcoinTestFramework):
             assert_equal(json_obj[tx]['spentby'], txs[i + 1:i + 2])
             assert_equal(json_obj[tx]['depends'], txs[i - 1:i])
 
+        self.log.info("Test the /mempool/snapshot URI")
+        snapshot_bin = self.test_rest_request("/mempool/snapshot", req_type=ReqType.BIN, ret_type=RetType.BYTES)
+        assert_equal(self.test_rest_request("/mempool/snapshot", req_type=ReqType.HEX, ret_type=RetType.BYTES).decode('utf-8').rstrip(), snapshot_bin.hex())
+        assert_equal(self.nodes[0].getmempoolsnapshot(), snapshot_bin.hex())
+        sequence, entries, removed = deser_mempool_snapshot(snapshot_bin)
+        assert_equal(sequence, self.nodes[0].getrawmempool(mempool_sequence=True)['mempool_sequence'])
+        assert_equal(set(entries), set(txs))
+        assert_equal(removed, [])
+        for txid, entry in entries.items():
+            mempool_entry = json_obj[txid]
+            assert_equal(entry['fee'], int(mempool_entry['fees']['base'] * COIN))
+            assert_equal(entry['modified_fee'], int(mempool_entry['fees']['modified'] * COIN))
+            assert_equal(entry['vsize'], mempool_entry['vsize'])
+            assert_equal(entry['ancestors'], (mempool_entry['ancestorcount'], mempool_entry['ancestorsize'], int(mempool_entry['fees']['ancestor'] * COIN)))
+            assert_equal(entry['descendants'], (mempool_entry['descendantcount'], mempool_entry['descendantsize'], int(mempool_entry['fees']['descendant'] * COIN)))
+
+        # Nothing changed since the snapshot
+        assert_equal(deser_mempool_snapshot(self.test_rest_request(f"/mempool/snapshot/{sequence}", req_type=ReqType.BIN, ret_type=RetType.BYTES)), (sequence, {}, []))
+        # Sequence numbers from the future are rejected, as are invalid ones and JSON
+        self.test_rest_request(f"/mempool/snapshot/{sequence + 1}", req_type=ReqType.BIN, status=404, ret_type=RetType.OBJ)
+        self.test_rest_request(f"/mempool/snapshot/{INVALID_PARAM}", req_type=ReqType.BIN, status=400, ret_type=RetType.OBJ)
+        self.test_rest_request("/mempool/snapshot", status=404, ret_type=RetType.OBJ)
+
         # Now mine the transactions
         newblockhash = self.generate(self.nodes[1], 1)
 
+        # The changes since the snapshot are the mined transactions' removal
+        delta_sequence, delta_entries, delta_removed = deser_mempool_snapshot(bytes.fromhex(self.nodes[0].getmempoolsnapshot(sequence)))
+        assert_equal(delta_sequence, sequence + len(txs))
+        assert_equal(delta_entries, {})
+        assert_equal(set(delta_removed), set(txs))
+
         # Check if the 3 tx show up in the new block
         json_obj = self.test_rest_request(f"/block/{newblockhash[0]}")
         non_coinbase_txs = {tx['txid'] for tx in json_obj['tx']
@@ -10,6 +10,7 @@ from test_framework.address import (
     ADDRESS_BCRT1_UNSPENDABLE,
 )
 from test_framework.blocktools import (
+    COINBASE_MATURITY,
     add_witness_commitment,
     create_block,
     create_coinbase,
@@ -23,6 +24,7 @@ from test_framework.util import (
     assert_equal,
     assert_raises_rpc_error,
 )
+from test_framework.wallet import MiniWallet
 from test_framework.netutil import test_ipv6_local
 from io import BytesIO
 from time import sleep
@@ -119,6 +121,7 @@ class ZMQTest (BitcoinTestFramework):
             self.test_reorg()
             self.test_multiple_interfaces()
             self.test_ipv6()
+            self.test_dropped_notifications()
         finally:
             # Destroy the ZMQ context.
             self.log.debug("Destroying ZMQ context")
@@ -126,7 +129,7 @@ class ZMQTest (BitcoinTestFramework):
 
     # Restart node with the specified zmq notifications enabled, subscribe to
     # all of them and return the corresponding ZMQSubscriber objects.
-    def setup_zmq_test(self, services, *, recv_timeout=60, sync_blocks=True, ipv6=False):
+    def setup_zmq_test(self, services, *, recv_timeout=60, sync_blocks=True, ipv6=False, extra_args=None):
         subscribers = []
         for topic, address in services:
             socket = self.ctx.socket(zmq.SUB)
@@ -135,7 +138,7 @@ class ZMQTest (BitcoinTestFramework):
             subscribers.append(ZMQSubscriber(socket, topic.encode()))
 
         self.restart_node(0, [f"-zmqpub{topic}={address}" for topic, address in services] +
-                             self.extra_args[0])
+                             self.extra_args[0] + (extra_args or []))
 
         for i, sub in enumerate(subscribers):
             sub.socket.connect(services[i][1])
@@ -234,10 +237,10 @@ class ZMQTest (BitcoinTestFramework):
 
         self.log.info("Test the getzmqnotifications RPC")
         assert_equal(self.nodes[0].getzmqnotifications(), [
-            {"type": "pubhashblock", "address": address, "hwm": 1000},
-            {"type": "pubhashtx", "address": address, "hwm": 1000},
-            {"type": "pubrawblock", "address": address, "hwm": 1000},
-            {"type": "pubrawtx", "address": address, "hwm": 1000},
+            {"type": "pubhashblock", "address": address, "hwm": 1000, "dropped": 0},
+            {"type": "pubhashtx", "address": address, "hwm": 1000, "dropped": 0},
+            {"type": "pubrawblock", "address": address, "hwm": 1000, "dropped": 0},
+            {"type": "pubrawtx", "address": address, "hwm": 1000, "dropped": 0},
         ])
 
         assert_equal(self.nodes[1].getzmqnotifications(), [])
@@ -579,5 +582,30 @@ class ZMQTest (BitcoinTestFramework):
         assert_equal(self.nodes[0].getbestblockhash(), subscribers[0].receive().hex())
 
 
+    def test_dropped_notifications(self):
+        self.log.info("Test that mempool notifications are dropped while the publisher queue is full")
+        wallet = MiniWallet(self.nodes[0])
+        self.generate(wallet, COINBASE_MATURITY + 1, sync_fun=self.no_op)
+
+        # Without room in the publisher queue, every mempool notification is
+        # dropped, while block notifications wait to be published.
+        address = 'tcp://127.0.0.1:28332'
+        hashtx, seq = self.setup_zmq_test([("hashtx", address), ("sequence", address)], sync_blocks=False, extra_args=["-zmqqueuesize=0"])
+        dropped_before = [n["dropped"] for n in self.nodes[0].getzmqnotifications()]
+
+        txid = wallet.send_self_transfer(from_node=self.nodes[0])["txid"]
+        block_hash = self.generatetoaddress(self.nodes[0], 1, ADDRESS_BCRT1_UNSPENDABLE, sync_fun=self.no_op)[0]
+
+        # The dropped mempool acceptance leaves a gap in the message sequence numbers
+        hashtx.sequence += 1
+        seq.sequence += 1
+        coinbase_txid, block_txid = self.nodes[0].getblock(block_hash)["tx"]
+        assert_equal(block_txid, txid)
+        assert_equal(hashtx.receive().hex(), coinbase_txid)
+        assert_equal(hashtx.receive().hex(), txid)
+        assert_equal(seq.receive_sequence(), (block_hash, "C", None))
+        assert_equal([n["dropped"] for n in self.nodes[0].getzmqnotifications()], [d + 1 for d in dropped_before])
+
+
 if __name__ == '__main__':
     ZMQTest().main()